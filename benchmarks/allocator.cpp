@@ -0,0 +1,66 @@
+#include "helper/allocator.hpp"
+
+#include <random>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace std;
+
+// The allocations and frees in a run
+#define OPERATIONS 1000000
+
+// The runs of each case
+#define RUNS 5
+
+/* Times allocating and freeing ranges of random sizes. About half of the
+ * ranges stay allocated, so the free lists have many blocks in them
+ * @param name The name of the case
+ * @param maxSize The largest range
+ * @param alignment The alignment of each range
+ */
+static void run(const char *name, size_t maxSize, size_t alignment) {
+  // Sizes are made ahead of time so only the allocator is timed
+  mt19937 random(1);
+  vector<size_t> sizes(OPERATIONS);
+  vector<size_t> picks(OPERATIONS);
+
+  for (int i = 0; i < OPERATIONS; i++) {
+    sizes[i] = 1 + random() % maxSize;
+    picks[i] = random();
+  }
+
+  vector<RangeAllocator::Allocation> live;
+  live.reserve(OPERATIONS);
+
+  double time = timeRuns(RUNS, [&]() {
+    RangeAllocator allocator(maxSize * 8192);
+    live.clear();
+
+    for (int i = 0; i < OPERATIONS; i++) {
+      if (!live.empty() && picks[i] % 2 == 0) {
+        size_t index = picks[i] % live.size();
+
+        allocator.free(live[index]);
+        live[index] = live.back();
+        live.pop_back();
+      } else {
+        RangeAllocator::Allocation allocation;
+
+        if (allocator.allocate(sizes[i], allocation, alignment)) {
+          live.push_back(allocation);
+        }
+      }
+    }
+  });
+
+  report(name, time, OPERATIONS, "ops");
+}
+
+int main() {
+  run("small ranges", 64, 1);
+  run("mesh sized ranges", 65536, 1);
+  run("aligned ranges", 4096, 256);
+
+  return 0;
+}
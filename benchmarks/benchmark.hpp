@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Shared by the programs in benchmarks/. Each program times its cases and
+// prints one line per case
+
+/* Runs a function a number of times and returns the fastest run. The
+ * fastest run is the one least disturbed by the rest of the system
+ * @param runs The number of times to run the function
+ * @param function The function to time
+ * @returns The fastest run in milliseconds
+ */
+template <typename Function> double timeRuns(int runs, Function function) {
+  double best = 0.0;
+
+  for (int i = 0; i < runs; i++) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    double time = std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (i == 0 || time < best) {
+      best = time;
+    }
+  }
+
+  return best;
+}
+
+/* Prints a line of results
+ * @param name The name of the case
+ * @param milliseconds The time of a run
+ * @param items The items handled in a run
+ * @param unit The name of the items
+ */
+inline void report(const char *name, double milliseconds, double items,
+                   const char *unit) {
+  printf("%-32s %10.3f ms %12.2f M%s/s\n", name, milliseconds,
+         items / milliseconds / 1000.0, unit);
+}
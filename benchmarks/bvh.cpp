@@ -0,0 +1,133 @@
+#include "rendering/bvh.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "benchmark.hpp"
+
+using namespace std;
+using namespace glm;
+
+// The rings and segments of the test mesh. It has twice this many triangles
+#define MESH_RINGS 512
+#define MESH_SEGMENTS 1024
+
+// The rays cast in a run
+#define RAYS 200000
+
+// The runs of each case
+#define RUNS 3
+
+// A triangle mesh
+struct Mesh {
+  vector<vec3> positions;
+  vector<uint32_t> indices;
+};
+
+/* Makes a bumpy sphere. The bumps give the triangles different sizes and
+ * the hierarchy overlapping boxes, a little like a scanned model
+ * @returns The mesh
+ */
+static Mesh makeMesh() {
+  Mesh mesh;
+
+  for (int r = 0; r <= MESH_RINGS; r++) {
+    float theta = pi<float>() * r / MESH_RINGS;
+
+    for (int s = 0; s <= MESH_SEGMENTS; s++) {
+      float phi = 2.0f * pi<float>() * s / MESH_SEGMENTS;
+      float radius = 1.0f + 0.1f * sinf(theta * 17.0f) * cosf(phi * 23.0f);
+
+      mesh.positions.push_back(radius * vec3(sinf(theta) * cosf(phi),
+                                             cosf(theta),
+                                             sinf(theta) * sinf(phi)));
+    }
+  }
+
+  for (uint32_t r = 0; r < MESH_RINGS; r++) {
+    for (uint32_t s = 0; s < MESH_SEGMENTS; s++) {
+      uint32_t a = r * (MESH_SEGMENTS + 1) + s;
+      uint32_t b = a + MESH_SEGMENTS + 1;
+
+      mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+    }
+  }
+
+  return mesh;
+}
+
+/* Returns the bounds of each triangle
+ * @param mesh The mesh
+ * @returns The bounds
+ */
+static vector<BoundingBox> getBoxes(const Mesh &mesh) {
+  vector<BoundingBox> boxes(mesh.indices.size() / 3);
+
+  for (size_t t = 0; t < boxes.size(); t++) {
+    for (size_t v = 0; v < 3; v++) {
+      boxes[t].add(mesh.positions[mesh.indices[t * 3 + v]]);
+    }
+  }
+
+  return boxes;
+}
+
+int main() {
+  Mesh mesh = makeMesh();
+  vector<BoundingBox> boxes = getBoxes(mesh);
+  size_t triangles = boxes.size();
+
+  BVH bvh;
+
+  double serial = timeRuns(RUNS, [&]() { bvh.build(boxes); });
+  report("build on one thread", serial, (double)triangles, "triangles");
+
+  auto pool = ThreadPool::create();
+  double parallel = timeRuns(RUNS, [&]() { bvh.build(boxes, 4, pool.get()); });
+  report("build on a pool", parallel, (double)triangles, "triangles");
+
+  // Rays from outside the mesh toward points near its middle, so most of
+  // them hit and some pass through the gaps between the bumps
+  mt19937 random(1);
+  uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  vector<vec3> origins(RAYS), directions(RAYS);
+  for (int i = 0; i < RAYS; i++) {
+    vec3 origin = normalize(vec3(unit(random), unit(random), unit(random)));
+    vec3 target = 0.8f * vec3(unit(random), unit(random), unit(random));
+
+    origins[i] = origin * 3.0f;
+    directions[i] = target - origins[i];
+  }
+
+  auto &order = bvh.getOrder();
+  size_t hits = 0;
+
+  double rays = timeRuns(RUNS, [&]() {
+    hits = 0;
+
+    for (int i = 0; i < RAYS; i++) {
+      float distance = 1.0f;
+
+      hits += bvh.raycast(
+          origins[i], directions[i], distance,
+          [&](uint32_t position, float &closest) {
+            const uint32_t *corners = &mesh.indices[order[position] * 3];
+
+            return hitTriangle(origins[i], directions[i],
+                               mesh.positions[corners[0]],
+                               mesh.positions[corners[1]],
+                               mesh.positions[corners[2]], closest);
+          });
+    }
+  });
+
+  report("closest hit rays", rays, RAYS, "rays");
+  printf("%zu triangles, %zu nodes, %.1f%% of rays hit\n", triangles,
+         bvh.getNodes().size(), 100.0 * hits / RAYS);
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include "helper/mipmap.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace std;
+
+// This file is built once for each instruction set, with the same flags
+// as the mipmap kernels it is linked to
+#if defined(MIPMAP_SCALAR)
+#define KERNELS "scalar"
+#elif defined(__AVX2__)
+#define KERNELS "avx2"
+#else
+#define KERNELS "sse2"
+#endif
+
+// The size of the base level
+#define IMAGE_SIZE 2048
+
+// The runs of each case
+#define RUNS 5
+
+/* Makes a test image of smooth gradients with some detail
+ * @param channels The number of channels
+ * @returns Tightly packed pixels
+ */
+static vector<unsigned char> makeImage(int channels) {
+  vector<unsigned char> pixels((size_t)IMAGE_SIZE * IMAGE_SIZE * channels);
+
+  for (int y = 0; y < IMAGE_SIZE; y++) {
+    for (int x = 0; x < IMAGE_SIZE; x++) {
+      for (int c = 0; c < channels; c++) {
+        float value = 0.5f + 0.25f * sinf(x * 0.01f * (c + 1)) +
+                      0.25f * cosf(y * 0.013f + c);
+
+        pixels[((size_t)y * IMAGE_SIZE + x) * channels + c] =
+            (unsigned char)(value * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  return pixels;
+}
+
+/* Times the mip chain of an image
+ * @param channels The number of channels
+ * @param filter The filter
+ */
+static void run(int channels, MipFilter filter) {
+  vector<unsigned char> pixels = makeImage(channels);
+
+  MipSettings settings;
+  settings.filter = filter;
+  settings.srgb = false;
+
+  double time = timeRuns(RUNS, [&]() {
+    generateMipChain(pixels.data(), IMAGE_SIZE, IMAGE_SIZE, channels,
+                     settings);
+  });
+
+  string name = string(KERNELS) + " " +
+                (filter == MipFilter::Box ? "box" : "kaiser") + " " +
+                to_string(channels) + " channels";
+
+  // The levels below the base are about a third of it
+  report(name.c_str(), time, IMAGE_SIZE * IMAGE_SIZE / 3.0, "pixels");
+}
+
+int main() {
+  for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+    run(1, filter);
+    run(4, filter);
+  }
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+#version 430 core
+
+// Shrinks the opaque depth for the reduced transparent passes. Each pixel
+// keeps the furthest depth of the pixels it covers, so no transparent
+// fragment in front of any of them is lost. The transparent layer is
+// cleared at the same time. Only the render size of the opaque depth is
+// read, since the rest of it is left over from larger frames
+
+uniform sampler2D opaqueDepth;
+uniform uint scale;
+uniform vec2 renderSize;
+
+layout (location = 0) out vec4 gLayer;
+layout (location = 1) out float gDepth;
+
+void main() {
+    ivec2 size = ivec2(renderSize);
+    ivec2 first = ivec2(gl_FragCoord.xy) * int(scale);
+
+    float depth = 0.0;
+
+    for (int y = 0; y < int(scale); y++) {
+        for (int x = 0; x < int(scale); x++) {
+            ivec2 pixel = min(first + ivec2(x, y), size - 1);
+            depth = max(depth, texelFetch(opaqueDepth, pixel, 0).r);
+        }
+    }
+
+    // Nothing composited yet: no color and everything shows through
+    gLayer = vec4(0.0, 0.0, 0.0, 1.0);
+    gDepth = depth;
+    gl_FragDepth = depth;
+}
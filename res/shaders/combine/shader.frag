@@ -4,15 +4,17 @@
 
 out vec4 gFragColor;
 
+#ifdef DEFERRED_SHADING
+#define LIGHTS_ONLY
+#include <res/shaders/common/lighting.frag>
+#endif
+
 #define LINKED_LIST_READONLY
 #include <res/shaders/common/transparancy.frag>
 
-uniform sampler2D opaqueColor;
-uniform sampler2D opaqueZBuffer;
-
 void main() {
     uint headIndex = calculateHead();
-    uint listIndex = tail[headIndex];
+    uint listIndex = readHead(tail[headIndex]);
 
     uint currentIndex = listIndex;
     uint count;
@@ -23,31 +25,66 @@ void main() {
         currentIndex = fragments[currentIndex].next-1;
     }
 
-    float minDepth = 0.0f;
-    float currentDepth;
+    // Each step picks the next fragment in depth order after the last one
+    // composited. The sentinels come before or after every fragment
+    bool forward = frontToBack != 0;
+    float lastDepth = forward ? -1.0 : 2.0;
+    uint lastOrder = 0;
+
+    float bestDepth;
+    uint bestOrder;
     uint closestIndex;
 
-    vec3 color = texelFetch(opaqueColor, ivec2(gl_FragCoord.xy), 0).rgb;
+    // The fragments are composited over black, and the part of the opaque
+    // color that shows through is kept in alpha. It is blended with
+    // glBlendFunc(GL_ONE, GL_SRC_ALPHA), so the opaque color is never read
+    vec3 color = vec3(0.0);
+    float transmittance = 1.0;
 
     for (uint i = 0; i < count; i++) {
-        currentDepth = 10000000.0f;
         closestIndex = 0xffffffff;
         currentIndex = listIndex;
 
         for (uint j = 0; j < count; j++) {
-            if (fragments[currentIndex].depth >= minDepth && fragments[currentIndex].depth < currentDepth) {
-                currentDepth = fragments[currentIndex].depth;
+            float depth = fragments[currentIndex].depth;
+
+            bool isNext = forward ? isBefore(lastDepth, lastOrder, depth, j) :
+                                    isBefore(depth, j, lastDepth, lastOrder);
+            bool isCloser = closestIndex == 0xffffffff ||
+                (forward ? isBefore(depth, j, bestDepth, bestOrder) :
+                           isBefore(bestDepth, bestOrder, depth, j));
+
+            if (isNext && isCloser) {
+                bestDepth = depth;
+                bestOrder = j;
                 closestIndex = currentIndex;
             }
 
             currentIndex = fragments[currentIndex].next-1;
         }
 
-        if (closestIndex != 0xffffffff) {
-            color = fragments[closestIndex].color.rgb * fragments[closestIndex].color.a +
-                (1.0 - fragments[closestIndex].color.a) * color;
+        lastDepth = bestDepth;
+        lastOrder = bestOrder;
+
+        vec4 fragment = fragmentColor(closestIndex, uvec2(gl_FragCoord.xy));
+
+        if (forward) {
+            color += transmittance * fragment.a * fragment.rgb;
+            transmittance *= 1.0 - fragment.a;
+
+            // What is left can change the pixel by less than the epsilon
+            if (transmittance < transmittanceEpsilon) {
+                if (i + 1 < count) {
+                    atomicAdd(skippedFragments, count - i - 1);
+                }
+
+                break;
+            }
+        } else {
+            color = fragment.rgb * fragment.a + (1.0 - fragment.a) * color;
+            transmittance *= 1.0 - fragment.a;
         }
     }
 
-    gFragColor = vec4(color, 1.0);
+    gFragColor = vec4(color, transmittance);
 }
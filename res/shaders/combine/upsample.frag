@@ -0,0 +1,51 @@
+#version 430 core
+
+// Blends the reduced transparent layer over the full opaque color. The
+// four nearest layer pixels are weighted by distance like a bilinear
+// filter, and by how close their depth is to this pixel's, so the layer
+// doesn't bleed across the edges of opaque geometry. The output is blended
+// with glBlendFunc(GL_ONE, GL_SRC_ALPHA). The screen can be larger than
+// the render size, which is stretched over it like the opaque color
+
+out vec4 gFragColor;
+
+uniform sampler2D transparentLayer;
+uniform sampler2D transparentDepth;
+uniform sampler2D opaqueDepth;
+uniform uint scale;
+uniform vec2 renderSize;
+
+// Keeps the depth weight finite when the depths are the same
+#define DEPTH_EPSILON 0.0001
+
+void main() {
+    // The opaque textures have the size of the screen
+    vec2 toRender = renderSize / vec2(textureSize(opaqueDepth, 0));
+    vec2 rendered = gl_FragCoord.xy * toRender;
+
+    ivec2 pixel = min(ivec2(rendered), ivec2(renderSize) - 1);
+    float depth = texelFetch(opaqueDepth, pixel, 0).r;
+
+    ivec2 size = ivec2(ceil(renderSize / float(scale)));
+    vec2 position = rendered / float(scale) - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    vec4 sum = vec4(0.0);
+    float total = 0.0;
+
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), size - 1);
+
+            float bilinear = (x == 1 ? f.x : 1.0 - f.x) * (y == 1 ? f.y : 1.0 - f.y);
+            float difference = abs(texelFetch(transparentDepth, texel, 0).r - depth);
+            float weight = (bilinear + 0.001) / (DEPTH_EPSILON + difference);
+
+            sum += weight * texelFetch(transparentLayer, texel, 0);
+            total += weight;
+        }
+    }
+
+    gFragColor = sum / total;
+}
@@ -1,11 +1,53 @@
+// Resolve shaders only shade stored surfaces, and define LIGHTS_ONLY to
+// leave out the material inputs
+#ifndef LIGHTS_ONLY
 uniform sampler2D matDiffuse;
-uniform vec3 matDiffuseColor;
 uniform sampler2D matSpecular;
-uniform vec3 matSpecularColor;
 uniform sampler2D matAlpha;
+
+// Used instead when the texture is a layer of a texture array
+uniform sampler2DArray matDiffuseArray;
+uniform sampler2DArray matSpecularArray;
+uniform sampler2DArray matAlphaArray;
+
+#ifdef MATERIAL_BUFFER
+// Indirect draws read their material from a buffer (see DrawMaterial)
+struct Material {
+    vec4 diffuseColor;
+    vec4 specularColor;
+    float alphaValue;
+    uint mask;
+    float diffuseLayer;
+    float specularLayer;
+    float alphaLayer;
+};
+
+layout(std430, binding=4) readonly buffer materialBuffer {
+    Material materials[];
+};
+
+flat in uint fMaterial;
+
+#define matDiffuseColor (materials[fMaterial].diffuseColor.rgb)
+#define matSpecularColor (materials[fMaterial].specularColor.rgb)
+#define matAlphaValue (materials[fMaterial].alphaValue)
+#define matMask (materials[fMaterial].mask)
+#define matDiffuseLayer (materials[fMaterial].diffuseLayer)
+#define matSpecularLayer (materials[fMaterial].specularLayer)
+#define matAlphaLayer (materials[fMaterial].alphaLayer)
+#else
+uniform vec3 matDiffuseColor;
+uniform vec3 matSpecularColor;
 uniform float matAlphaValue;
 
+uniform float matDiffuseLayer;
+uniform float matSpecularLayer;
+uniform float matAlphaLayer;
+
 uniform uint matMask;
+#endif
+
+#endif
 
 struct Light {
     vec3 position;
@@ -18,17 +60,59 @@ uniform uint lightCount;
 uniform vec3 globalAmbient;
 uniform vec3 viewPosition;
 
+// Lights a surface point
+vec3 shadeSurface(vec3 position, vec3 normal, vec3 color, vec3 specular) {
+    vec3 finalColor = globalAmbient * color;
+    vec3 viewDirection = normalize(viewPosition - position);
+
+    for (uint i = 0; i < lightCount; i++) {
+        float lightDistance = distance(lights[i].position, position);
+        float lightStrength = lights[i].strength / lightDistance;
+
+        if (lightStrength < 0.01) {
+            continue;
+        }
+        
+        vec3 lightDirection = normalize(lights[i].position - position);
+
+        float diffuseAmount = max(dot(normal, lightDirection), 0.0);
+        vec3 diffuse = diffuseAmount * lights[i].color * color;
+
+        vec3 reflectDirection = reflect(-lightDirection, normal);
+
+        float specularAmount = pow(max(dot(viewDirection, reflectDirection), 0.0), 32.0);
+        vec3 specularColor = specular * specularAmount * lights[i].color;
+
+        finalColor += (diffuse + specularColor) * lightStrength;
+    }
+
+    return finalColor;
+}
+
+#ifndef LIGHTS_ONLY
 #define USE_DIFFUSE_TEXTURE (1<<0)
 #define USE_SPECULAR_TEXTURE (1<<1)
 #define USE_ALPHA_TEXTURE (1<<2)
+#define DIFFUSE_IN_ARRAY (1<<3)
+#define SPECULAR_IN_ARRAY (1<<4)
+#define ALPHA_IN_ARRAY (1<<5)
 
-vec4 calculateLighting(float alphaClip) {
+vec4 sampleMaterial(sampler2D tex, sampler2DArray array, float layer, uint inArray) {
+    if ((matMask & inArray) != 0) {
+        return texture(array, vec3(fUV, layer));
+    }
+
+    return texture(tex, fUV);
+}
+
+// Samples the material's color and alpha at the fragment. Fragments with
+// less alpha than alphaClip are discarded
+vec4 sampleAlbedo(float alphaClip) {
     vec3 color = matDiffuseColor;
-    vec3 specular = matSpecularColor;
     float alpha = matAlphaValue;
 
     if ((matMask & USE_ALPHA_TEXTURE) != 0) {
-        alpha = texture(matAlpha, fUV).r;
+        alpha = sampleMaterial(matAlpha, matAlphaArray, matAlphaLayer, ALPHA_IN_ARRAY).r;
     }
 
     if (alpha < alphaClip) {
@@ -36,37 +120,29 @@ vec4 calculateLighting(float alphaClip) {
     }
 
     if ((matMask & USE_DIFFUSE_TEXTURE) != 0) {
-       color = texture(matDiffuse, fUV).rgb;
+       color = sampleMaterial(matDiffuse, matDiffuseArray, matDiffuseLayer, DIFFUSE_IN_ARRAY).rgb;
     }
 
-    if ((matMask & USE_SPECULAR_TEXTURE) != 0) {
-        specular = texture(matSpecular, fUV).rgb;
-    }
-
-    vec3 finalColor = globalAmbient * color;
-    vec3 normal = normalize(fNormal);
-    vec3 viewDirection = normalize(viewPosition - fPosition);
-
-    for (uint i = 0; i < lightCount; i++) {
-        float lightDistance = distance(lights[i].position, fPosition);
-        float lightStrength = lights[i].strength / lightDistance;
+    return vec4(color, alpha);
+}
 
-        if (lightStrength < 0.01) {
-            continue;
-        }
-        
-        vec3 lightDirection = normalize(lights[i].position - fPosition);
+// Samples the material's specular color at the fragment
+vec3 sampleSpecular() {
+    vec3 specular = matSpecularColor;
 
-        float diffuseAmount = max(dot(normal, lightDirection), 0.0);
-        vec3 diffuse = diffuseAmount * lights[i].color * color;
+    if ((matMask & USE_SPECULAR_TEXTURE) != 0) {
+        specular = sampleMaterial(matSpecular, matSpecularArray, matSpecularLayer, SPECULAR_IN_ARRAY).rgb;
+    }
 
-        vec3 reflectDirection = reflect(-lightDirection, normal);
+    return specular;
+}
 
-        float specularAmount = pow(max(dot(viewDirection, reflectDirection), 0.0), 32.0);
-        vec3 specularColor = specular * specularAmount * lights[i].color;
+vec4 calculateLighting(float alphaClip) {
+    vec4 albedo = sampleAlbedo(alphaClip);
+    vec3 specular = sampleSpecular();
 
-        finalColor += (diffuse + specularColor) * lightStrength;
-    }
+    vec3 finalColor = shadeSurface(fPosition, normalize(fNormal), albedo.rgb, specular);
 
-    return vec4(finalColor, alpha);
+    return vec4(finalColor, albedo.a);
 }
+#endif
@@ -1,11 +1,38 @@
+#ifdef DEFERRED_SHADING
+// The surface of a fragment, shaded by the resolve. normal is octahedral
+// encoded with packSnorm2x16, albedo is the color and alpha packed with
+// packUnorm4x8 and material indexes resolveMaterials
+struct Fragment {
+    uint next;
+    uint normal;
+    uint albedo;
+    uint material;
+    float depth;
+};
+
+vec2 octahedronWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+#else
+// The lit color of a fragment
 struct Fragment {
     uint next;
     vec4 color;
     float depth;
 };
+#endif
 
 uniform layout(binding=0) atomic_uint counter;
 
+// Counts for the GUI: the fragments the resolve didn't need to composite,
+// the fragments that missed their tile's page and took a page of their
+// own, and the fragments that got no node
+layout(std430, binding=6) buffer fragmentStats {
+    uint skippedFragments;
+    uint fallbackFragments;
+    uint droppedFragments;
+};
+
 #ifdef LINKED_LIST_READONLY
 layout(std430, binding=1) readonly buffer head {
     uint tail[];
@@ -14,6 +41,59 @@ layout(std430, binding=1) readonly buffer head {
 layout(std430, binding=2) readonly buffer list {
     Fragment fragments[];
 };
+
+layout(std430, binding=5) readonly buffer tileMask {
+    uint tiles[];
+};
+
+// Composites front to back and stops once less than transmittanceEpsilon
+// of what is behind would show through. Otherwise composites back to front
+uniform uint frontToBack;
+uniform float transmittanceEpsilon;
+
+#ifdef DEFERRED_SHADING
+// The specular color of each material of the transparent model
+layout(std430, binding=7) readonly buffer resolveMaterials {
+    vec4 materialSpecular[];
+};
+
+// Turns a pixel and depth back into a world position
+uniform mat4 inversePV;
+uniform vec2 screenSize;
+
+vec3 decodeNormal(uint encoded) {
+    vec2 e = unpackSnorm2x16(encoded);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+    if (n.z < 0.0) {
+        n.xy = octahedronWrap(n.xy);
+    }
+
+    return normalize(n);
+}
+
+// Lights a stored surface. Only fragments that are composited get here
+vec4 fragmentColor(uint index, uvec2 pixel) {
+    vec3 ndc = vec3((vec2(pixel) + 0.5) / screenSize, fragments[index].depth) * 2.0 - 1.0;
+    vec4 position = inversePV * vec4(ndc, 1.0);
+
+    vec4 albedo = unpackUnorm4x8(fragments[index].albedo);
+    vec3 specular = materialSpecular[fragments[index].material].rgb;
+    vec3 normal = decodeNormal(fragments[index].normal);
+
+    return vec4(shadeSurface(position.xyz / position.w, normal, albedo.rgb, specular), albedo.a);
+}
+#else
+vec4 fragmentColor(uint index, uvec2 pixel) {
+    return fragments[index].color;
+}
+#endif
+
+// Fragments are composited in order of depth. Fragments at the same depth
+// keep their order in the list
+bool isBefore(float depthA, uint orderA, float depthB, uint orderB) {
+    return depthA < depthB || (depthA == depthB && orderA < orderB);
+}
 #else
 layout(std430, binding=1) coherent buffer head {
     uint tail[];
@@ -22,16 +102,133 @@ layout(std430, binding=1) coherent buffer head {
 layout(std430, binding=2) writeonly buffer list {
     Fragment fragments[];
 };
+
+layout(std430, binding=5) buffer tileMask {
+    uint tiles[];
+};
 #endif
 
-uniform uint screenWidth;
-uniform uint screenHeight;
+// The pixels the head buffer covers: x, y, width and height. Transparent
+// fragments are only drawn inside of it
+uniform uint headRect[4];
+
+// Head entries hold the epoch of the frame that wrote them in their top
+// bits and a fragment index in the rest. Entries written in other frames
+// read as empty, so the head buffer doesn't need to be cleared
+#define HEAD_INDEX_BITS 24
+#define HEAD_INDEX_MASK 0xFFFFFFu
+
+uniform uint headEpoch;
 
+// The head rect is split into square tiles. The transparent pass sets the
+// entry of every tile it draws into to tileStamp, which changes every
+// frame, so the compute resolve can skip the tiles that hold nothing
+#define TILE_SIZE 8
+
+uniform uint tileStamp;
+
+uint calculateHead(uvec2 pixel) {
+    uvec2 index = pixel - uvec2(headRect[0], headRect[1]);
+    return index.y * headRect[2] + index.x;
+}
+
+uint calculateTile(uvec2 pixel) {
+    uvec2 index = (pixel - uvec2(headRect[0], headRect[1])) / TILE_SIZE;
+    uint tilesX = (headRect[2] + TILE_SIZE - 1) / TILE_SIZE;
+    return index.y * tilesX + index.x;
+}
+
+uint readHead(uint entry) {
+    return (entry >> HEAD_INDEX_BITS) == headEpoch ? entry & HEAD_INDEX_MASK : 0u;
+}
+
+uint makeHead(uint index) {
+    return (headEpoch << HEAD_INDEX_BITS) | index;
+}
+
+#if defined(DEFERRED_SHADING) && !defined(LINKED_LIST_READONLY)
+uint encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : octahedronWrap(n.xy);
+    return packSnorm2x16(e);
+}
+#endif
+
+#if defined(PAGED_ALLOCATION) && !defined(LINKED_LIST_READONLY)
+// Nodes are handed out in pages of PAGE_SIZE. Each tile counts its
+// fragments, and the first fragment of each of the tile's pages takes the
+// next page from the counter. The other fragments of the page find it in
+// the tile's ring of latest pages. The counter is hit once per page, and a
+// tile's fragments are next to each other in the list.
+// rendering/pages.hpp is the same allocator on the CPU
+#define PAGE_SIZE 16u
+#define PAGE_RING 8u
+#define PAGE_STRIDE (1u + PAGE_RING)
+#define PAGE_SPINS 1024u
+
+// Ring entries hold a page index in their low bits, and which of the
+// tile's pages it is in the rest. The largest index marks a page that
+// didn't fit
+#define PAGE_INDEX_BITS 20
+#define PAGE_INDEX_MASK 0xFFFFFu
+
+// PAGE_STRIDE entries per tile: its fragment count, then the ring. The
+// tiles of the head rect are cleared every frame
+layout(std430, binding=0) coherent buffer tilePages {
+    uint pages[];
+};
+
+// The nodes the list buffer holds
+uniform uint listCapacity;
+
+// Takes the next page from the counter. PAGE_INDEX_MASK if it doesn't fit
+uint takePage() {
+    uint index = atomicCounterIncrement(counter);
+
+    // The page after the index is used, since node zero ends the lists
+    bool fits = index < PAGE_INDEX_MASK && (index + 2u) * PAGE_SIZE <= listCapacity;
+    return fits ? index : PAGE_INDEX_MASK;
+}
+
+// Returns the node for a new fragment of a tile. Zero if there is no room
+uint allocateFragment(uint tile) {
+    uint base = tile * PAGE_STRIDE;
+    uint slot = atomicAdd(pages[base], 1u);
+    uint page = slot / PAGE_SIZE;
+
+    uint entry = base + 1u + page % PAGE_RING;
+    uint tag = ((page & 0x7FFu) + 1u) << PAGE_INDEX_BITS;
+
+    if (slot % PAGE_SIZE == 0u) {
+        atomicExchange(pages[entry], tag | takePage());
+    }
+
+    // The fragment that takes the page is in this or an earlier loop, so
+    // the page shows up unless the tile went around the ring since
+    for (uint i = 0u; i < PAGE_SPINS; i++) {
+        uint value = atomicOr(pages[entry], 0u);
+
+        if ((value & ~PAGE_INDEX_MASK) == tag) {
+            uint index = value & PAGE_INDEX_MASK;
+            return index == PAGE_INDEX_MASK ? 0u : (index + 1u) * PAGE_SIZE + slot % PAGE_SIZE;
+        }
+    }
+
+    // The fragment takes a page of its own instead of being lost. The rest
+    // of that page and the fragment's slot in the tile's page go unused
+    atomicAdd(fallbackFragments, 1u);
+
+    uint index = takePage();
+    return index == PAGE_INDEX_MASK ? 0u : (index + 1u) * PAGE_SIZE;
+}
+#endif
+
+// Compute shaders have no fragment position or scene depth
+#ifndef LINKED_LIST_COMPUTE
 uniform sampler2D sceneDepth;
 
 uint calculateHead() {
-    uvec2 index = uvec2(gl_FragCoord.xy);
-    return index.y * screenWidth + index.x;
+    return calculateHead(uvec2(gl_FragCoord.xy));
 }
 
 void doZPrePass(float fDepth) {
@@ -41,3 +238,4 @@ void doZPrePass(float fDepth) {
         discard;
     }
 }
+#endif
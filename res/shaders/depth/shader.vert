@@ -0,0 +1,10 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPosition;
+
+uniform mat4 PV;
+uniform mat4 M;
+
+void main() {
+    gl_Position = PV * M * vec4(aPosition, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 430 core
+
+in vec3 fPosition;
+in vec3 fNormal;
+in vec2 fUV;
+in vec3 fColor;
+
+#define MATERIAL_BUFFER
+#include <res/shaders/common/lighting.frag>
+
+layout (location = 0) out vec4 gFragColor;
+layout (location = 1) out float gZCoord;
+
+void main() {
+    gFragColor = calculateLighting(0.9);
+    gZCoord = gl_FragCoord.z;
+}
@@ -0,0 +1,40 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+layout (location = 4) in vec2 aUV;
+layout (location = 5) in vec3 aColor;
+
+// The base instance of the draw command, which is the draw's index
+layout (location = 6) in uint aDrawIndex;
+
+// Per draw data (see DrawData)
+struct Draw {
+    mat4 M;
+    uint material;
+};
+
+layout(std430, binding=3) readonly buffer drawBuffer {
+    Draw draws[];
+};
+
+uniform mat4 PV;
+
+out vec3 fPosition;
+out vec3 fNormal;
+out vec2 fUV;
+out vec3 fColor;
+flat out uint fMaterial;
+
+void main() {
+    mat4 M = draws[aDrawIndex].M;
+
+    vec4 pos = M * vec4(aPosition, 1.0);
+    fPosition = pos.xyz / pos.w;
+    fNormal = mat3(transpose(inverse(M))) * aNormal;
+    fUV = aUV;
+    fColor = aColor;
+    fMaterial = draws[aDrawIndex].material;
+
+    gl_Position = PV * pos;
+}
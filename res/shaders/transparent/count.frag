@@ -4,12 +4,6 @@
 
 layout(early_fragment_tests) in;
 
-in vec3 fPosition;
-in vec3 fNormal;
-in vec2 fUV;
-in vec3 fColor;
-in float fZ;
-
 #include <res/shaders/common/transparancy.frag>
 
 void main() {
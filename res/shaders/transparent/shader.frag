@@ -11,6 +11,11 @@ in vec3 fColor;
 
 in mat3 TBN;
 
+#ifdef DEFERRED_SHADING
+// The index of the mesh's material in resolveMaterials
+uniform uint matIndex;
+#endif
+
 #include <res/shaders/common/lighting.frag>
 #include <res/shaders/common/transparancy.frag>
 
@@ -21,12 +26,46 @@ void main() {
     uint listIndex;
     uint lastIndex = tail[headIndex];
 
+#ifdef DEFERRED_SHADING
+    // The resolve lights the fragment if it is composited
+    vec4 albedo = sampleAlbedo(0.0);
+#else
     vec4 color = calculateLighting(0.0);
+#endif
+
+    uint tileIndex = calculateTile(uvec2(gl_FragCoord.xy));
+
+#ifdef PAGED_ALLOCATION
+    listIndex = allocateFragment(tileIndex);
 
+    if (listIndex == 0u) {
+        atomicAdd(droppedFragments, 1u);
+        discard;
+    }
+#else
     listIndex = atomicCounterIncrement(counter);
-    lastIndex = atomicExchange(tail[headIndex], listIndex);
+
+    // Head entries can't point past HEAD_INDEX_MASK
+    if (listIndex > HEAD_INDEX_MASK) {
+        atomicAdd(droppedFragments, 1u);
+        discard;
+    }
+#endif
+
+    lastIndex = readHead(atomicExchange(tail[headIndex], makeHead(listIndex)));
 
     fragments[listIndex].next = lastIndex+1;
+#ifdef DEFERRED_SHADING
+    fragments[listIndex].normal = encodeNormal(normalize(fNormal));
+    fragments[listIndex].albedo = packUnorm4x8(albedo);
+    fragments[listIndex].material = matIndex;
+#else
     fragments[listIndex].color = color;
+#endif
     fragments[listIndex].depth = gl_FragCoord.z;
+
+    // Many fragments share a tile, so the entry is only written once
+    if (tiles[tileIndex] != tileStamp) {
+        tiles[tileIndex] = tileStamp;
+    }
 }
@@ -0,0 +1,359 @@
+#include "helper/allocator.hpp"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Marks the end of a list or a missing block
+#define NO_BLOCK UINT32_MAX
+
+// Returns the index of the lowest set bit. The value must not be zero
+static int lowestBit(uint32_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+// Returns the index of the highest set bit. The value must not be zero
+static int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return (int)index;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+  for (auto &level : this->heads) {
+    fill(begin(level), end(level), NO_BLOCK);
+  }
+
+  this->grow(capacity);
+}
+
+bool RangeAllocator::allocate(size_t size, Allocation &allocation,
+                              size_t alignment) {
+  size = max(size, (size_t)1);
+  alignment = max(alignment, (size_t)1);
+
+  // Any block this large fits the range wherever it starts
+  uint32_t block = this->findFree(size + alignment - 1);
+  if (block == NO_BLOCK) {
+    return false;
+  }
+
+  this->removeFree(block);
+
+  // Split off the start of the block if it isn't aligned. The block before
+  // is in use, since free neighbours are merged, so the start stays its
+  // own free block
+  size_t padding = (alignment - this->blocks[block].offset % alignment) %
+                   alignment;
+
+  if (padding > 0) {
+    uint32_t start = this->newBlock();
+
+    // newBlock can move the blocks, so the references are taken after it
+    Block &allocated = this->blocks[block];
+    Block &skipped = this->blocks[start];
+
+    skipped.offset = allocated.offset;
+    skipped.size = padding;
+    skipped.prevPhysical = allocated.prevPhysical;
+    skipped.nextPhysical = block;
+
+    if (allocated.prevPhysical != NO_BLOCK) {
+      this->blocks[allocated.prevPhysical].nextPhysical = start;
+    }
+
+    allocated.offset += padding;
+    allocated.size -= padding;
+    allocated.prevPhysical = start;
+
+    this->insertFree(start);
+  }
+
+  // Split off the end of the block if it is larger than needed
+  if (this->blocks[block].size > size) {
+    uint32_t rest = this->newBlock();
+
+    // newBlock can move the blocks, so the references are taken after it
+    Block &allocated = this->blocks[block];
+    Block &remainder = this->blocks[rest];
+
+    remainder.offset = allocated.offset + size;
+    remainder.size = allocated.size - size;
+    remainder.prevPhysical = block;
+    remainder.nextPhysical = allocated.nextPhysical;
+
+    if (allocated.nextPhysical != NO_BLOCK) {
+      this->blocks[allocated.nextPhysical].prevPhysical = rest;
+    } else {
+      this->last = rest;
+    }
+
+    allocated.size = size;
+    allocated.nextPhysical = rest;
+
+    this->insertFree(rest);
+  }
+
+  this->blocks[block].isFree = false;
+
+  this->used += size;
+  this->allocations++;
+
+  allocation.offset = this->blocks[block].offset;
+  allocation.size = size;
+  allocation.block = block;
+
+  return true;
+}
+
+void RangeAllocator::free(const Allocation &allocation) {
+  uint32_t block = allocation.block;
+  if (block == NO_BLOCK) {
+    return;
+  }
+
+  this->used -= this->blocks[block].size;
+  this->allocations--;
+  this->blocks[block].isFree = true;
+
+  // Merge with the block before
+  uint32_t prev = this->blocks[block].prevPhysical;
+  if (prev != NO_BLOCK && this->blocks[prev].isFree) {
+    this->removeFree(prev);
+
+    Block &merged = this->blocks[prev];
+    merged.size += this->blocks[block].size;
+    merged.nextPhysical = this->blocks[block].nextPhysical;
+
+    if (merged.nextPhysical != NO_BLOCK) {
+      this->blocks[merged.nextPhysical].prevPhysical = prev;
+    } else {
+      this->last = prev;
+    }
+
+    this->deleteBlock(block);
+    block = prev;
+  }
+
+  // Merge with the block after
+  uint32_t next = this->blocks[block].nextPhysical;
+  if (next != NO_BLOCK && this->blocks[next].isFree) {
+    this->removeFree(next);
+
+    Block &merged = this->blocks[block];
+    merged.size += this->blocks[next].size;
+    merged.nextPhysical = this->blocks[next].nextPhysical;
+
+    if (merged.nextPhysical != NO_BLOCK) {
+      this->blocks[merged.nextPhysical].prevPhysical = block;
+    } else {
+      this->last = block;
+    }
+
+    this->deleteBlock(next);
+  }
+
+  this->insertFree(block);
+}
+
+void RangeAllocator::grow(size_t capacity) {
+  if (capacity <= this->capacity) {
+    return;
+  }
+
+  size_t extra = capacity - this->capacity;
+
+  if (this->last != NO_BLOCK && this->blocks[this->last].isFree) {
+    // Extend the free block at the end
+    this->removeFree(this->last);
+    this->blocks[this->last].size += extra;
+    this->insertFree(this->last);
+  } else {
+    uint32_t block = this->newBlock();
+
+    Block &added = this->blocks[block];
+    added.offset = this->capacity;
+    added.size = extra;
+    added.prevPhysical = this->last;
+    added.nextPhysical = NO_BLOCK;
+
+    if (this->last != NO_BLOCK) {
+      this->blocks[this->last].nextPhysical = block;
+    }
+
+    this->last = block;
+    this->insertFree(block);
+  }
+
+  this->capacity = capacity;
+}
+
+size_t RangeAllocator::getCapacity() const { return this->capacity; }
+
+size_t RangeAllocator::getUsed() const { return this->used; }
+
+RangeAllocator::Stats RangeAllocator::getStats() const {
+  Stats stats;
+  stats.capacity = this->capacity;
+  stats.used = this->used;
+  stats.allocations = this->allocations;
+  stats.freeBlocks = this->freeBlocks;
+
+  // The largest free block is in the highest non empty class
+  if (this->flBitmap != 0) {
+    int fl = highestBit(this->flBitmap);
+    int sl = highestBit(this->slBitmap[fl]);
+
+    for (uint32_t block = this->heads[fl][sl]; block != NO_BLOCK;
+         block = this->blocks[block].nextFree) {
+      stats.largestFree = max(stats.largestFree, this->blocks[block].size);
+    }
+  }
+
+  size_t freeUnits = this->capacity - this->used;
+  if (freeUnits > 0) {
+    stats.fragmentation = 1.0f - (float)stats.largestFree / (float)freeUnits;
+  }
+
+  return stats;
+}
+
+void RangeAllocator::mapping(size_t size, int &fl, int &sl) {
+  // Small sizes are all in the first level, one class per size
+  if (size < ALLOCATOR_SL_COUNT) {
+    fl = 0;
+    sl = (int)size;
+    return;
+  }
+
+  int msb = highestBit(size);
+  fl = msb - ALLOCATOR_SL_BITS + 1;
+  sl = (int)(size >> (msb - ALLOCATOR_SL_BITS)) - ALLOCATOR_SL_COUNT;
+}
+
+uint32_t RangeAllocator::findFree(size_t size) {
+  // Rounding up to the next class means any block in the class found is
+  // large enough, so the list never has to be searched
+  size_t rounded = size;
+  if (size >= ALLOCATOR_SL_COUNT) {
+    rounded += ((size_t)1 << (highestBit(size) - ALLOCATOR_SL_BITS)) - 1;
+  }
+
+  int fl, sl;
+  mapping(rounded, fl, sl);
+
+  if (fl < ALLOCATOR_FL_COUNT) {
+    uint32_t slMap = this->slBitmap[fl] & (~0u << sl);
+
+    if (slMap == 0) {
+      uint32_t flMap =
+          fl + 1 < ALLOCATOR_FL_COUNT ? this->flBitmap & (~0u << (fl + 1)) : 0;
+
+      if (flMap != 0) {
+        fl = lowestBit(flMap);
+        slMap = this->slBitmap[fl];
+      }
+    }
+
+    if (slMap != 0) {
+      return this->heads[fl][lowestBit(slMap)];
+    }
+  }
+
+  // A block in the size's own class may still fit. This keeps the last
+  // free space usable when it is close to the size asked for
+  mapping(size, fl, sl);
+
+  if (fl < ALLOCATOR_FL_COUNT) {
+    for (uint32_t block = this->heads[fl][sl]; block != NO_BLOCK;
+         block = this->blocks[block].nextFree) {
+      if (this->blocks[block].size >= size) {
+        return block;
+      }
+    }
+  }
+
+  return NO_BLOCK;
+}
+
+void RangeAllocator::insertFree(uint32_t block) {
+  int fl, sl;
+  mapping(this->blocks[block].size, fl, sl);
+
+  Block &inserted = this->blocks[block];
+  inserted.isFree = true;
+  inserted.prevFree = NO_BLOCK;
+  inserted.nextFree = this->heads[fl][sl];
+
+  if (inserted.nextFree != NO_BLOCK) {
+    this->blocks[inserted.nextFree].prevFree = block;
+  }
+
+  this->heads[fl][sl] = block;
+  this->flBitmap |= 1u << fl;
+  this->slBitmap[fl] |= 1u << sl;
+
+  this->freeBlocks++;
+}
+
+void RangeAllocator::removeFree(uint32_t block) {
+  int fl, sl;
+  mapping(this->blocks[block].size, fl, sl);
+
+  Block &removed = this->blocks[block];
+
+  if (removed.prevFree != NO_BLOCK) {
+    this->blocks[removed.prevFree].nextFree = removed.nextFree;
+  } else {
+    this->heads[fl][sl] = removed.nextFree;
+  }
+
+  if (removed.nextFree != NO_BLOCK) {
+    this->blocks[removed.nextFree].prevFree = removed.prevFree;
+  }
+
+  // Clear the bitmaps when the list is empty
+  if (this->heads[fl][sl] == NO_BLOCK) {
+    this->slBitmap[fl] &= ~(1u << sl);
+
+    if (this->slBitmap[fl] == 0) {
+      this->flBitmap &= ~(1u << fl);
+    }
+  }
+
+  this->freeBlocks--;
+}
+
+uint32_t RangeAllocator::newBlock() {
+  uint32_t block;
+
+  if (!this->unusedBlocks.empty()) {
+    block = this->unusedBlocks.back();
+    this->unusedBlocks.pop_back();
+  } else {
+    block = (uint32_t)this->blocks.size();
+    this->blocks.emplace_back();
+  }
+
+  this->blocks[block] =
+      Block{0, 0, NO_BLOCK, NO_BLOCK, NO_BLOCK, NO_BLOCK, false};
+  return block;
+}
+
+void RangeAllocator::deleteBlock(uint32_t block) {
+  this->unusedBlocks.push_back(block);
+}
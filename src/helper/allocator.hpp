@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The number of second level classes per power of two, as a power of two
+#define ALLOCATOR_SL_BITS 4
+#define ALLOCATOR_SL_COUNT (1 << ALLOCATOR_SL_BITS)
+
+// The number of first level classes. Sizes up to 2^(FL_COUNT + SL_BITS - 1)
+// units are supported
+#define ALLOCATOR_FL_COUNT 32
+
+/* Hands out ranges of a linear space using a two level segregated fit
+ * (TLSF) allocator. It does not know what the space holds, so the units
+ * can be bytes, vertices or indices
+ *
+ * Free ranges are kept in lists by size class. The first level splits
+ * sizes by powers of two and the second level splits each power of two
+ * into ALLOCATOR_SL_COUNT classes. A bitmap per level finds a large enough
+ * class in constant time, and freed ranges are merged with free neighbours
+ */
+class RangeAllocator {
+public:
+  // A range handed out by the allocator
+  struct Allocation {
+    size_t offset = 0;
+    size_t size = 0;
+
+    // The allocator's block of the range. Only used by free
+    uint32_t block = UINT32_MAX;
+  };
+
+  // Allocator statistics
+  struct Stats {
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t allocations = 0;
+    size_t freeBlocks = 0;
+    size_t largestFree = 0;
+
+    // 0 when every free unit is in one block, approaching 1 as the free
+    // space is split into small pieces
+    float fragmentation = 0.0f;
+  };
+
+  /* Creates an allocator with all of its space free
+   * @param capacity The size of the space
+   */
+  RangeAllocator(size_t capacity = 0);
+
+  /* Allocates a range
+   * @param size The size of the range. Zero is allocated as one unit
+   * @param allocation Set to the range if there is space
+   * @param alignment The offset of the range is a multiple of this. The
+   * units skipped to align the range stay free
+   * @returns True if the range was allocated
+   */
+  bool allocate(size_t size, Allocation &allocation, size_t alignment = 1);
+
+  /* Frees a range, merging it with its free neighbours
+   * @param allocation A range returned by allocate
+   */
+  void free(const Allocation &allocation);
+
+  /* Adds space to the end. Existing ranges keep their offsets
+   * @param capacity The new size of the space. Ignored if it is smaller
+   * than the current size
+   */
+  void grow(size_t capacity);
+
+  // Returns the size of the space
+  // @returns The size of the space
+  size_t getCapacity() const;
+
+  // Returns the number of units that are allocated
+  // @returns The number of units that are allocated
+  size_t getUsed() const;
+
+  // Returns the allocator statistics. Walks the free blocks of the largest
+  // size class, so it is not meant to be called per allocation
+  // @returns The allocator statistics
+  Stats getStats() const;
+
+private:
+  struct Block {
+    size_t offset;
+    size_t size;
+
+    // Blocks next to this one in the space
+    uint32_t prevPhysical;
+    uint32_t nextPhysical;
+
+    // Blocks in the same free list
+    uint32_t prevFree;
+    uint32_t nextFree;
+
+    bool isFree;
+  };
+
+  /* Finds the size class of a size
+   * @param size The size
+   * @param fl Set to the first level class
+   * @param sl Set to the second level class
+   */
+  static void mapping(size_t size, int &fl, int &sl);
+
+  /* Finds a free block of at least a size
+   * @param size The size
+   * @returns The block, or UINT32_MAX if there is none
+   */
+  uint32_t findFree(size_t size);
+
+  // Adds a block to the free list of its class
+  void insertFree(uint32_t block);
+  // Removes a block from the free list of its class
+  void removeFree(uint32_t block);
+
+  /* Creates a block, reusing an unused one if possible
+   * @returns The block
+   */
+  uint32_t newBlock();
+  // Returns a block for reuse
+  void deleteBlock(uint32_t block);
+
+  std::vector<Block> blocks;
+  std::vector<uint32_t> unusedBlocks;
+
+  // The first block of each free list
+  uint32_t heads[ALLOCATOR_FL_COUNT][ALLOCATOR_SL_COUNT];
+
+  // Bit n is set if first level n has a non empty list
+  uint32_t flBitmap = 0;
+  // Bit n of entry f is set if the list of (f, n) is not empty
+  uint32_t slBitmap[ALLOCATOR_FL_COUNT] = {};
+
+  // The block at the end of the space, or UINT32_MAX if it is empty
+  uint32_t last = UINT32_MAX;
+
+  size_t capacity = 0;
+  size_t used = 0;
+  size_t allocations = 0;
+  size_t freeBlocks = 0;
+};
@@ -0,0 +1,527 @@
+#include "helper/blockcompress.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+using namespace std;
+
+// Expands a 5 or 6 bit value to 8 bits
+#define EXPAND5(v) (((v) << 3) | ((v) >> 2))
+#define EXPAND6(v) (((v) << 2) | ((v) >> 4))
+
+/* Finds the closest palette entry for 16 values. The values and palette
+ * are split into components so that four values are compared at once
+ * @param components The number of components per value
+ * @param values The values, 16 per component
+ * @param palette The palette, paletteSize per component
+ * @param paletteSize The number of palette entries
+ * @param indices The closest palette entry for each value
+ * @returns The total squared error
+ */
+static float selectIndices(int components, const float *values,
+                           const float *palette, int paletteSize,
+                           int *indices) {
+#ifdef USE_SSE2
+  __m128 total = _mm_setzero_ps();
+
+  for (int i = 0; i < 16; i += 4) {
+    __m128 best = _mm_set1_ps(numeric_limits<float>::max());
+    __m128i bestIndex = _mm_setzero_si128();
+
+    for (int p = 0; p < paletteSize; p++) {
+      __m128 distance = _mm_setzero_ps();
+
+      for (int c = 0; c < components; c++) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(values + c * 16 + i),
+                              _mm_set1_ps(palette[c * paletteSize + p]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+      }
+
+      // Keep the palette entry if it is closer
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+      bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)),
+                               _mm_andnot_si128(closer, bestIndex));
+      best = _mm_min_ps(distance, best);
+    }
+
+    _mm_storeu_si128((__m128i *)(indices + i), bestIndex);
+    total = _mm_add_ps(total, best);
+  }
+
+  float sums[4];
+  _mm_storeu_ps(sums, total);
+  return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+  float total = 0.0f;
+
+  for (int i = 0; i < 16; i++) {
+    float best = numeric_limits<float>::max();
+
+    for (int p = 0; p < paletteSize; p++) {
+      float distance = 0.0f;
+
+      for (int c = 0; c < components; c++) {
+        float d = values[c * 16 + i] - palette[c * paletteSize + p];
+        distance += d * d;
+      }
+
+      if (distance < best) {
+        best = distance;
+        indices[i] = p;
+      }
+    }
+
+    total += best;
+  }
+
+  return total;
+#endif
+}
+
+// Packs a color into 565
+static uint16_t packColor(const float *color) {
+  int r = (int)lround(clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f);
+  int g = (int)lround(clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f);
+  int b = (int)lround(clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f);
+
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Builds the four color BC1 palette, split into components
+static void buildColorPalette(uint16_t color0, uint16_t color1,
+                              float *palette) {
+  float c0[3] = {(float)EXPAND5(color0 >> 11), (float)EXPAND6((color0 >> 5) & 63),
+                 (float)EXPAND5(color0 & 31)};
+  float c1[3] = {(float)EXPAND5(color1 >> 11), (float)EXPAND6((color1 >> 5) & 63),
+                 (float)EXPAND5(color1 & 31)};
+
+  for (int c = 0; c < 3; c++) {
+    palette[c * 4 + 0] = c0[c];
+    palette[c * 4 + 1] = c1[c];
+    palette[c * 4 + 2] = (2.0f * c0[c] + c1[c]) / 3.0f;
+    palette[c * 4 + 3] = (c0[c] + 2.0f * c1[c]) / 3.0f;
+  }
+}
+
+// Fits the endpoints to the selected indices with least squares
+// @returns False if the fit is degenerate
+static bool refineEndpoints(const float *values, const int *indices,
+                            float *end0, float *end1) {
+  // How much of end0 each palette entry uses
+  const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+  float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+  float ax[3] = {0.0f, 0.0f, 0.0f};
+  float bx[3] = {0.0f, 0.0f, 0.0f};
+
+  for (int i = 0; i < 16; i++) {
+    float a = weights[indices[i]];
+    float b = 1.0f - a;
+
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * values[c * 16 + i];
+      bx[c] += b * values[c * 16 + i];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (fabs(determinant) < 1e-6f) {
+    return false;
+  }
+
+  for (int c = 0; c < 3; c++) {
+    end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+    end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+  }
+
+  return true;
+}
+
+// Writes a BC1 block. Makes sure color0 > color1 so the four color
+// mode is used
+static void writeColorBlock(uint16_t color0, uint16_t color1,
+                            const int *indices, unsigned char *block) {
+  uint32_t bits = 0;
+
+  if (color0 == color1) {
+    // Every index uses color0
+  } else if (color0 < color1) {
+    swap(color0, color1);
+
+    // Swapping the endpoints swaps 0 with 1 and 2 with 3
+    for (int i = 0; i < 16; i++) {
+      bits |= (uint32_t)(indices[i] ^ 1) << (i * 2);
+    }
+  } else {
+    for (int i = 0; i < 16; i++) {
+      bits |= (uint32_t)indices[i] << (i * 2);
+    }
+  }
+
+  block[0] = color0 & 0xff;
+  block[1] = color0 >> 8;
+  block[2] = color1 & 0xff;
+  block[3] = color1 >> 8;
+  memcpy(block + 4, &bits, 4);
+}
+
+void encodeBC1(const unsigned char *rgba, unsigned char *block) {
+  // Split the pixels into components
+  float values[48];
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      values[c * 16 + i] = rgba[i * 4 + c];
+      mean[c] += rgba[i * 4 + c] / 16.0f;
+    }
+  }
+
+  // Find the principal axis of the colors with power iteration
+  float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+
+  for (int i = 0; i < 16; i++) {
+    float r = values[i] - mean[0];
+    float g = values[16 + i] - mean[1];
+    float b = values[32 + i] - mean[2];
+
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+
+  for (int i = 0; i < 4; i++) {
+    float x = axis[0] * covariance[0] + axis[1] * covariance[1] +
+              axis[2] * covariance[2];
+    float y = axis[0] * covariance[1] + axis[1] * covariance[3] +
+              axis[2] * covariance[4];
+    float z = axis[0] * covariance[2] + axis[1] * covariance[4] +
+              axis[2] * covariance[5];
+
+    float length = max(max(fabs(x), fabs(y)), fabs(z));
+    if (length < 1e-6f) {
+      break;
+    }
+
+    axis[0] = x / length;
+    axis[1] = y / length;
+    axis[2] = z / length;
+  }
+
+  // The endpoints are the colors furthest along the axis
+  float minProjection = numeric_limits<float>::max();
+  float maxProjection = -numeric_limits<float>::max();
+  int minIndex = 0, maxIndex = 0;
+
+  for (int i = 0; i < 16; i++) {
+    float projection = values[i] * axis[0] + values[16 + i] * axis[1] +
+                       values[32 + i] * axis[2];
+
+    if (projection < minProjection) {
+      minProjection = projection;
+      minIndex = i;
+    }
+
+    if (projection > maxProjection) {
+      maxProjection = projection;
+      maxIndex = i;
+    }
+  }
+
+  // Move the endpoints in slightly, since the extremes are rarely used
+  float end0[3], end1[3];
+  for (int c = 0; c < 3; c++) {
+    float high = values[c * 16 + maxIndex];
+    float low = values[c * 16 + minIndex];
+    float inset = (high - low) / 16.0f;
+
+    end0[c] = high - inset;
+    end1[c] = low + inset;
+  }
+
+  uint16_t color0 = packColor(end0);
+  uint16_t color1 = packColor(end1);
+
+  float palette[12];
+  int indices[16];
+
+  buildColorPalette(color0, color1, palette);
+  float error = selectIndices(3, values, palette, 4, indices);
+
+  // Refit the endpoints to the chosen indices and keep the result if it
+  // is better
+  if (refineEndpoints(values, indices, end0, end1)) {
+    uint16_t refined0 = packColor(end0);
+    uint16_t refined1 = packColor(end1);
+
+    float refinedPalette[12];
+    int refinedIndices[16];
+
+    buildColorPalette(refined0, refined1, refinedPalette);
+    float refinedError =
+        selectIndices(3, values, refinedPalette, 4, refinedIndices);
+
+    if (refinedError < error) {
+      color0 = refined0;
+      color1 = refined1;
+      memcpy(indices, refinedIndices, sizeof(indices));
+    }
+  }
+
+  writeColorBlock(color0, color1, indices, block);
+}
+
+void encodeBC4(const unsigned char *values, size_t stride,
+               unsigned char *block) {
+  float v[16];
+  unsigned char high = 0, low = 255;
+
+  for (int i = 0; i < 16; i++) {
+    unsigned char value = values[i * stride];
+    v[i] = value;
+    high = max(high, value);
+    low = min(low, value);
+  }
+
+  block[0] = high;
+  block[1] = low;
+
+  uint64_t bits = 0;
+
+  if (high != low) {
+    // Eight value mode. Entries 2 to 7 go from high to low
+    float palette[8];
+    palette[0] = high;
+    palette[1] = low;
+
+    for (int i = 1; i < 7; i++) {
+      palette[i + 1] = ((7 - i) * high + i * low) / 7.0f;
+    }
+
+    int indices[16];
+    selectIndices(1, v, palette, 8, indices);
+
+    for (int i = 0; i < 16; i++) {
+      bits |= (uint64_t)indices[i] << (i * 3);
+    }
+  }
+
+  for (int i = 0; i < 6; i++) {
+    block[2 + i] = (bits >> (i * 8)) & 0xff;
+  }
+}
+
+// Decodes a BC1 block into 16 RGBA pixels
+static void decodeBC1(const unsigned char *block, unsigned char *rgba) {
+  uint16_t color0 = block[0] | (block[1] << 8);
+  uint16_t color1 = block[2] | (block[3] << 8);
+  uint32_t bits;
+  memcpy(&bits, block + 4, 4);
+
+  float palette[12];
+  buildColorPalette(color0, color1, palette);
+
+  // Three color mode
+  if (color0 <= color1) {
+    for (int c = 0; c < 3; c++) {
+      palette[c * 4 + 2] = (palette[c * 4] + palette[c * 4 + 1]) / 2.0f;
+      palette[c * 4 + 3] = 0.0f;
+    }
+  }
+
+  for (int i = 0; i < 16; i++) {
+    int index = (bits >> (i * 2)) & 3;
+
+    for (int c = 0; c < 3; c++) {
+      rgba[i * 4 + c] = (unsigned char)lround(palette[c * 4 + index]);
+    }
+
+    rgba[i * 4 + 3] = (color0 <= color1 && index == 3) ? 0 : 255;
+  }
+}
+
+// Decodes a BC4 block into 16 values
+static void decodeBC4(const unsigned char *block, unsigned char *values,
+                      size_t stride) {
+  float palette[8];
+  palette[0] = block[0];
+  palette[1] = block[1];
+
+  if (block[0] > block[1]) {
+    for (int i = 1; i < 7; i++) {
+      palette[i + 1] = ((7 - i) * block[0] + i * block[1]) / 7.0f;
+    }
+  } else {
+    for (int i = 1; i < 5; i++) {
+      palette[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5.0f;
+    }
+    palette[6] = 0.0f;
+    palette[7] = 255.0f;
+  }
+
+  uint64_t bits = 0;
+  for (int i = 0; i < 6; i++) {
+    bits |= (uint64_t)block[2 + i] << (i * 8);
+  }
+
+  for (int i = 0; i < 16; i++) {
+    values[i * stride] = (unsigned char)lround(palette[(bits >> (i * 3)) & 7]);
+  }
+}
+
+size_t getBlockSize(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::BC1:
+  case BlockFormat::BC4:
+    return 8;
+  case BlockFormat::BC3:
+  case BlockFormat::BC5:
+    return 16;
+  }
+
+  return 0;
+}
+
+size_t getCompressedSize(BlockFormat format, int width, int height) {
+  size_t blocksX = (width + 3) / 4;
+  size_t blocksY = (height + 3) / 4;
+
+  return blocksX * blocksY * getBlockSize(format);
+}
+
+vector<unsigned char> compressImage(const unsigned char *pixels, int width,
+                                    int height, int channels,
+                                    BlockFormat format) {
+  int blocksX = (width + 3) / 4;
+  int blocksY = (height + 3) / 4;
+  size_t blockSize = getBlockSize(format);
+
+  vector<unsigned char> blocks(getCompressedSize(format, width, height));
+
+  for (int by = 0; by < blocksY; by++) {
+    for (int bx = 0; bx < blocksX; bx++) {
+      // Gather the block as RGBA, repeating the edge pixels
+      unsigned char rgba[64];
+
+      for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+          int px = min(bx * 4 + x, width - 1);
+          int py = min(by * 4 + y, height - 1);
+          const unsigned char *pixel =
+              pixels + ((size_t)py * width + px) * channels;
+          unsigned char *out = rgba + (y * 4 + x) * 4;
+
+          for (int c = 0; c < 4; c++) {
+            out[c] = c < channels ? pixel[c] : (c == 3 ? 255 : 0);
+          }
+        }
+      }
+
+      unsigned char *block =
+          blocks.data() + ((size_t)by * blocksX + bx) * blockSize;
+
+      switch (format) {
+      case BlockFormat::BC1:
+        encodeBC1(rgba, block);
+        break;
+      case BlockFormat::BC3:
+        encodeBC4(rgba + 3, 4, block);
+        encodeBC1(rgba, block + 8);
+        break;
+      case BlockFormat::BC4:
+        encodeBC4(rgba, 4, block);
+        break;
+      case BlockFormat::BC5:
+        encodeBC4(rgba, 4, block);
+        encodeBC4(rgba + 1, 4, block + 8);
+        break;
+      }
+    }
+  }
+
+  return blocks;
+}
+
+vector<unsigned char> decompressImage(const unsigned char *blocks, int width,
+                                      int height, int channels,
+                                      BlockFormat format) {
+  int blocksX = (width + 3) / 4;
+  int blocksY = (height + 3) / 4;
+  size_t blockSize = getBlockSize(format);
+
+  vector<unsigned char> pixels((size_t)width * height * channels);
+
+  for (int by = 0; by < blocksY; by++) {
+    for (int bx = 0; bx < blocksX; bx++) {
+      const unsigned char *block =
+          blocks + ((size_t)by * blocksX + bx) * blockSize;
+
+      unsigned char rgba[64];
+      memset(rgba, 0, sizeof(rgba));
+
+      switch (format) {
+      case BlockFormat::BC1:
+        decodeBC1(block, rgba);
+        break;
+      case BlockFormat::BC3:
+        decodeBC1(block + 8, rgba);
+        decodeBC4(block, rgba + 3, 4);
+        break;
+      case BlockFormat::BC4:
+        decodeBC4(block, rgba, 4);
+        break;
+      case BlockFormat::BC5:
+        decodeBC4(block, rgba, 4);
+        decodeBC4(block + 8, rgba + 1, 4);
+        break;
+      }
+
+      // Copy the pixels that are inside the image
+      for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++) {
+          unsigned char *pixel =
+              pixels.data() +
+              ((size_t)(by * 4 + y) * width + bx * 4 + x) * channels;
+
+          memcpy(pixel, rgba + (y * 4 + x) * 4, channels);
+        }
+      }
+    }
+  }
+
+  return pixels;
+}
+
+double calculatePSNR(const unsigned char *a, const unsigned char *b,
+                     size_t size) {
+  double error = 0.0;
+
+  for (size_t i = 0; i < size; i++) {
+    double d = (double)a[i] - (double)b[i];
+    error += d * d;
+  }
+
+  if (error == 0.0) {
+    return numeric_limits<double>::infinity();
+  }
+
+  double mse = error / size;
+  return 10.0 * log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/* CPU encoders and decoders for the block compressed texture formats.
+ * Every format stores a 4x4 block of pixels. Images that are not a
+ * multiple of four in size are padded by repeating the edge pixels
+ *
+ * BC1 - RGB, 8 bytes per block
+ * BC3 - RGBA, a BC4 alpha block followed by a BC1 color block
+ * BC4 - Single channel, 8 bytes per block
+ * BC5 - Two channels, two BC4 blocks
+ */
+enum class BlockFormat { BC1, BC3, BC4, BC5 };
+
+/* Returns the number of bytes of one 4x4 block
+ * @param format The block format
+ * @returns The block size in bytes
+ */
+size_t getBlockSize(BlockFormat format);
+
+/* Returns the number of bytes a compressed image uses
+ * @param format The block format
+ * @param width The image width
+ * @param height The image height
+ * @returns The compressed size in bytes
+ */
+size_t getCompressedSize(BlockFormat format, int width, int height);
+
+/* Compresses a 4x4 block of RGB pixels as BC1
+ * @param rgba 16 RGBA pixels, row by row. Alpha is ignored
+ * @param block The 8 byte output block
+ */
+void encodeBC1(const unsigned char *rgba, unsigned char *block);
+
+/* Compresses a 4x4 block of single channel values as BC4
+ * @param values 16 values, row by row
+ * @param stride The distance in bytes between values
+ * @param block The 8 byte output block
+ */
+void encodeBC4(const unsigned char *values, size_t stride,
+               unsigned char *block);
+
+/* Compresses an image
+ * @param pixels Tightly packed pixels
+ * @param width The image width
+ * @param height The image height
+ * @param channels The number of channels in pixels (1-4). Missing channels
+ * are read as zero, except alpha which is read as 255
+ * @param format The block format
+ * @returns The compressed blocks, row by row
+ */
+std::vector<unsigned char> compressImage(const unsigned char *pixels,
+                                         int width, int height, int channels,
+                                         BlockFormat format);
+
+/* Decompresses an image
+ * @param blocks The compressed blocks
+ * @param width The image width
+ * @param height The image height
+ * @param channels The number of channels to write (1-4)
+ * @param format The block format
+ * @returns Tightly packed pixels
+ */
+std::vector<unsigned char> decompressImage(const unsigned char *blocks,
+                                           int width, int height,
+                                           int channels, BlockFormat format);
+
+/* Calculates the peak signal to noise ratio between two images
+ * @param a The first image
+ * @param b The second image
+ * @param size The number of bytes in each image
+ * @returns The PSNR in decibels. Identical images return infinity
+ */
+double calculatePSNR(const unsigned char *a, const unsigned char *b,
+                     size_t size);
@@ -0,0 +1,114 @@
+#include "helper/governor.hpp"
+#include "helper/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace std;
+
+// How much of each new frame time goes into the average
+#define GOVERNOR_SMOOTHING 0.1
+
+// Scales are multiples of this, so small changes in the time don't move it
+#define GOVERNOR_STEP 0.05f
+
+// The most the scale changes at once
+#define GOVERNOR_MAX_CHANGE 0.15f
+
+// The scale only grows if the average time is below this much of the
+// budget, so it doesn't bounce between two steps
+#define GOVERNOR_HEADROOM 0.85
+
+// The frames to wait after a change. The GPU timers are a few frames behind
+#define GOVERNOR_COOLDOWN 10
+
+ResolutionGovernor::ResolutionGovernor(double budget, float minScale,
+                                       float maxScale)
+    : budget(budget), minScale(minScale), maxScale(maxScale),
+      scale(maxScale) {}
+
+float ResolutionGovernor::update(double frameTime) {
+  this->frame++;
+
+  if (frameTime <= 0.0) {
+    return this->scale;
+  }
+
+  if (this->averageTime == 0.0) {
+    this->averageTime = frameTime;
+  } else {
+    this->averageTime += (frameTime - this->averageTime) * GOVERNOR_SMOOTHING;
+  }
+
+  if (this->cooldown > 0) {
+    this->cooldown--;
+    return this->scale;
+  }
+
+  bool overBudget = this->averageTime > this->budget;
+  bool underBudget = this->averageTime < this->budget * GOVERNOR_HEADROOM;
+
+  if (!overBudget && !underBudget) {
+    return this->scale;
+  }
+
+  // The time goes with the number of pixels, which is the square of the
+  // scale. Growing aims for the headroom, so the next frame isn't over
+  double target = overBudget ? this->budget : this->budget * GOVERNOR_HEADROOM;
+  float wanted = this->scale * (float)sqrt(target / this->averageTime);
+
+  wanted = std::clamp(wanted, this->scale - GOVERNOR_MAX_CHANGE,
+                    this->scale + GOVERNOR_MAX_CHANGE);
+  wanted = std::clamp(wanted, this->minScale, this->maxScale);
+
+  // Shrink down and grow up to a step, so the budget is still kept
+  float steps = wanted / GOVERNOR_STEP;
+  float snapped = (overBudget ? floor(steps) : ceil(steps)) * GOVERNOR_STEP;
+  snapped = std::clamp(snapped, this->minScale, this->maxScale);
+
+  if (fabs(snapped - this->scale) < GOVERNOR_STEP * 0.5f) {
+    return this->scale;
+  }
+
+  info("Resolution scale %.2f -> %.2f at frame %zu (GPU %.2f ms, budget "
+       "%.2f ms)\n",
+       this->scale, snapped, this->frame, this->averageTime * 1000.0,
+       this->budget * 1000.0);
+
+  this->history.push_back(
+      ResolutionChange{this->frame, this->scale, snapped, this->averageTime});
+
+  if (this->history.size() > GOVERNOR_HISTORY) {
+    this->history.pop_front();
+  }
+
+  this->scale = snapped;
+  this->cooldown = GOVERNOR_COOLDOWN;
+  this->changes++;
+
+  return this->scale;
+}
+
+float ResolutionGovernor::getScale() { return this->scale; }
+
+double ResolutionGovernor::getAverageTime() { return this->averageTime; }
+
+size_t ResolutionGovernor::getChangeCount() { return this->changes; }
+
+const deque<ResolutionChange> &ResolutionGovernor::getHistory() {
+  return this->history;
+}
+
+bool ResolutionGovernor::saveHistory(const string &path) {
+  ofstream file(path);
+
+  file << "frame,from,to,gpu_ms,budget_ms\n";
+
+  for (auto &change : this->history) {
+    file << change.frame << "," << change.from << "," << change.to << ","
+         << change.time * 1000.0 << "," << this->budget * 1000.0 << "\n";
+  }
+
+  return !file.fail();
+}
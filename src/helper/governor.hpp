@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+// The most scale changes a ResolutionGovernor remembers
+#define GOVERNOR_HISTORY 64
+
+// A change of a ResolutionGovernor's scale
+struct ResolutionChange {
+  // The frame of the change, counted by update
+  size_t frame;
+
+  float from, to;
+
+  // The averaged GPU time that caused the change, in seconds
+  double time;
+};
+
+/* Picks the render resolution each frame so that the GPU time of a frame
+ * stays near a budget. The scale is the fraction of the full resolution in
+ * each direction, so the pixel count, and roughly the GPU time, go with
+ * its square. The latest changes are kept so they can be shown or saved in
+ * any build, and each is also logged with info
+ */
+class ResolutionGovernor {
+private:
+  /* Creates a governor at the largest scale
+   * @param budget The GPU time a frame should take, in seconds
+   * @param minScale The smallest scale
+   * @param maxScale The largest scale
+   */
+  ResolutionGovernor(double budget, float minScale, float maxScale);
+
+public:
+  /* Adds the GPU time of a frame and picks the scale of the next one. The
+   * time is averaged over several frames, and the scale is left alone for
+   * a few frames after a change, since the GPU times arrive late
+   * @param frameTime The GPU time of a frame in seconds. Zero if it isn't
+   * known yet, which leaves the scale as it is
+   * @returns The scale to render the next frame at
+   */
+  float update(double frameTime);
+
+  // Returns the current scale
+  // @returns The scale
+  float getScale();
+
+  // Returns the averaged GPU time
+  // @returns The time in seconds
+  double getAverageTime();
+
+  // Returns the number of times the scale changed
+  // @returns The number of changes
+  size_t getChangeCount();
+
+  // Returns the latest changes, oldest first
+  // @returns Up to GOVERNOR_HISTORY changes
+  const std::deque<ResolutionChange> &getHistory();
+
+  /* Writes the latest changes to a CSV file, oldest first
+   * @param path The file to write
+   * @returns If the file was written
+   */
+  bool saveHistory(const std::string &path);
+
+  /* Creates a governor at the largest scale
+   * @param budget The GPU time a frame should take, in seconds
+   * @param minScale The smallest scale
+   * @param maxScale The largest scale
+   */
+  inline static auto create(double budget, float minScale = 0.5f,
+                            float maxScale = 1.0f) {
+    return std::shared_ptr<ResolutionGovernor>(
+        new ResolutionGovernor{budget, minScale, maxScale});
+  }
+
+private:
+  double budget;
+  float minScale, maxScale;
+
+  float scale;
+  double averageTime = 0.0;
+
+  // The frames left before the scale may change again
+  int cooldown = 0;
+
+  size_t frame = 0;
+  size_t changes = 0;
+
+  std::deque<ResolutionChange> history;
+};
@@ -0,0 +1,401 @@
+#include "helper/mipmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// MIPMAP_SCALAR leaves out the SIMD kernels, so they can be compared with
+// the scalar ones
+#if !defined(MIPMAP_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+#if !defined(MIPMAP_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define USE_AVX2
+#endif
+
+using namespace std;
+
+// The number of entries in the linear to sRGB table. Large enough that
+// every sRGB value has its own entry
+#define LINEAR_TABLE_SIZE 4096
+
+// The most taps a filter uses
+#define MAX_TAPS 6
+
+// Weights for halving an image along one axis. Output pixel x is the sum
+// of source pixels 2x + offset to 2x + offset + taps - 1
+struct Kernel {
+  int offset;
+  int taps;
+  float weights[MAX_TAPS];
+};
+
+// Zeroth order modified Bessel function of the first kind
+static float bessel0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+
+  for (int i = 1; i < 16; i++) {
+    term *= (x * 0.5f / i) * (x * 0.5f / i);
+    sum += term;
+  }
+
+  return sum;
+}
+
+// Creates the kernel of a filter
+static Kernel makeKernel(MipFilter filter) {
+  Kernel kernel;
+
+  if (filter == MipFilter::Box) {
+    kernel.offset = 0;
+    kernel.taps = 2;
+    kernel.weights[0] = 0.5f;
+    kernel.weights[1] = 0.5f;
+    return kernel;
+  }
+
+  // Windowed sinc over 6 source pixels. Distances are measured in
+  // destination pixels from the center of the output pixel
+  const float alpha = 4.0f;
+  const float radius = 1.5f;
+  const float pi = 3.14159265f;
+
+  kernel.offset = -2;
+  kernel.taps = 6;
+
+  float sum = 0.0f;
+
+  for (int i = 0; i < kernel.taps; i++) {
+    float x = (i - 2.5f) * 0.5f;
+    float sinc = sin(pi * x) / (pi * x);
+    float window =
+        bessel0(alpha * sqrt(1.0f - (x / radius) * (x / radius))) /
+        bessel0(alpha);
+
+    kernel.weights[i] = sinc * window;
+    sum += kernel.weights[i];
+  }
+
+  for (int i = 0; i < kernel.taps; i++) {
+    kernel.weights[i] /= sum;
+  }
+
+  return kernel;
+}
+
+// Returns a table from sRGB bytes to linear values
+static const float *getSRGBToLinear() {
+  static float table[256];
+  static bool ready = [] {
+    for (int i = 0; i < 256; i++) {
+      float c = i / 255.0f;
+      table[i] = c <= 0.04045f ? c / 12.92f
+                               : pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return true;
+  }();
+
+  (void)ready;
+  return table;
+}
+
+// Returns a table from linear values to sRGB bytes
+static const unsigned char *getLinearToSRGB() {
+  static unsigned char table[LINEAR_TABLE_SIZE + 1];
+  static bool ready = [] {
+    for (int i = 0; i <= LINEAR_TABLE_SIZE; i++) {
+      float c = (float)i / LINEAR_TABLE_SIZE;
+      float s = c <= 0.0031308f ? c * 12.92f
+                                : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+      table[i] = (unsigned char)(s * 255.0f + 0.5f);
+    }
+    return true;
+  }();
+
+  (void)ready;
+  return table;
+}
+
+/* Sums rows of values. This is the vertical pass of the filter, and every
+ * row is contiguous, so it is vectorized over the whole row
+ * @param rows The source rows, one per tap
+ * @param weights The weight of each row
+ * @param taps The number of rows
+ * @param out The output row
+ * @param count The number of values in a row
+ */
+static void filterColumns(const float *const *rows, const float *weights,
+                          int taps, float *out, int count) {
+  int i = 0;
+
+#ifdef USE_AVX2
+  for (; i + 8 <= count; i += 8) {
+    __m256 sum = _mm256_setzero_ps();
+
+    for (int t = 0; t < taps; t++) {
+      __m256 weight = _mm256_set1_ps(weights[t]);
+      __m256 value = _mm256_loadu_ps(rows[t] + i);
+#ifdef __FMA__
+      sum = _mm256_fmadd_ps(value, weight, sum);
+#else
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(value, weight));
+#endif
+    }
+
+    _mm256_storeu_ps(out + i, sum);
+  }
+#endif
+
+#ifdef USE_SSE2
+  for (; i + 4 <= count; i += 4) {
+    __m128 sum = _mm_setzero_ps();
+
+    for (int t = 0; t < taps; t++) {
+      __m128 weight = _mm_set1_ps(weights[t]);
+      __m128 value = _mm_loadu_ps(rows[t] + i);
+      sum = _mm_add_ps(sum, _mm_mul_ps(value, weight));
+    }
+
+    _mm_storeu_ps(out + i, sum);
+  }
+#endif
+
+  for (; i < count; i++) {
+    float sum = 0.0f;
+
+    for (int t = 0; t < taps; t++) {
+      sum += rows[t][i] * weights[t];
+    }
+
+    out[i] = sum;
+  }
+}
+
+/* Halves a row of pixels. This is the horizontal pass of the filter. The
+ * output is clamped to 0-1, since Kaiser can overshoot
+ * @param row The source row
+ * @param width The number of pixels in the source row
+ * @param channels The number of channels per pixel
+ * @param kernel The filter kernel
+ * @param out The output row
+ * @param outWidth The number of pixels in the output row
+ */
+static void filterRow(const float *row, int width, int channels,
+                      const Kernel &kernel, float *out, int outWidth) {
+  for (int x = 0; x < outWidth; x++) {
+    int first = x * 2 + kernel.offset;
+
+    // Repeat the edge pixels
+    int source[MAX_TAPS];
+    for (int t = 0; t < kernel.taps; t++) {
+      source[t] = min(max(first + t, 0), width - 1);
+    }
+
+#ifdef USE_SSE2
+    // RGBA pixels fit in a single register
+    if (channels == 4) {
+      __m128 sum = _mm_setzero_ps();
+
+      for (int t = 0; t < kernel.taps; t++) {
+        __m128 weight = _mm_set1_ps(kernel.weights[t]);
+        __m128 value = _mm_loadu_ps(row + source[t] * 4);
+        sum = _mm_add_ps(sum, _mm_mul_ps(value, weight));
+      }
+
+      sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+      _mm_storeu_ps(out + x * 4, sum);
+      continue;
+    }
+#endif
+
+    for (int c = 0; c < channels; c++) {
+      float sum = 0.0f;
+
+      for (int t = 0; t < kernel.taps; t++) {
+        sum += row[source[t] * channels + c] * kernel.weights[t];
+      }
+
+      out[x * channels + c] = min(max(sum, 0.0f), 1.0f);
+    }
+  }
+}
+
+/* Finds the alpha scale that makes a level keep the coverage of the base
+ * level. Coverage only goes up as the scale does, so it is a binary search
+ * @param values The level's values
+ * @param count The number of pixels
+ * @param channels The number of channels per pixel
+ * @param channel The alpha tested channel
+ * @param cutoff The alpha test reference value
+ * @param coverage The fraction of pixels that pass in the base level
+ * @returns The scale to apply to the channel
+ */
+static float findCoverageScale(const float *values, size_t count,
+                               int channels, int channel, float cutoff,
+                               float coverage) {
+  auto measure = [&](float scale) {
+    size_t passed = 0;
+    for (size_t i = 0; i < count; i++) {
+      passed += values[i * channels + channel] * scale >= cutoff;
+    }
+    return (float)passed / count;
+  };
+
+  float low = 0.0f;
+  float high = 1.0f;
+
+  while (measure(high) < coverage && high < 256.0f) {
+    low = high;
+    high *= 2.0f;
+  }
+
+  for (int i = 0; i < 16; i++) {
+    float middle = (low + high) * 0.5f;
+
+    if (measure(middle) < coverage) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  return high;
+}
+
+vector<MipLevel> generateMipChain(const unsigned char *pixels, int width,
+                                  int height, int channels,
+                                  const MipSettings &settings) {
+  vector<MipLevel> levels;
+
+  if (width <= 1 && height <= 1) {
+    return levels;
+  }
+
+  Kernel kernel = makeKernel(settings.filter);
+
+  const float *toLinear = getSRGBToLinear();
+  const unsigned char *toSRGB = getLinearToSRGB();
+
+  // Channels that are averaged in linear space
+  int srgbChannels = settings.srgb && channels >= 3 ? 3 : 0;
+
+  // Alpha test coverage of the base level
+  int coverageChannel = settings.coverageChannel;
+  if (coverageChannel >= channels) {
+    coverageChannel = -1;
+  }
+
+  float coverage = 0.0f;
+
+  if (coverageChannel != -1) {
+    size_t passed = 0;
+    size_t count = (size_t)width * height;
+
+    for (size_t i = 0; i < count; i++) {
+      passed += pixels[i * channels + coverageChannel] / 255.0f >=
+                settings.coverageCutoff;
+    }
+
+    coverage = (float)passed / count;
+  }
+
+  // The base level is only converted to floats a few rows at a time, so
+  // it never needs a full float copy. Rows are cached by row % MAX_TAPS,
+  // which never evicts a row that the current output row still needs
+  size_t rowSize = (size_t)width * channels;
+  vector<float> baseRows(rowSize * MAX_TAPS);
+  int cachedRows[MAX_TAPS];
+  fill(cachedRows, cachedRows + MAX_TAPS, -1);
+
+  auto getBaseRow = [&](int y) {
+    float *row = &baseRows[(y % MAX_TAPS) * rowSize];
+
+    if (cachedRows[y % MAX_TAPS] != y) {
+      const unsigned char *source = pixels + y * rowSize;
+
+      for (size_t i = 0; i < rowSize; i += channels) {
+        for (int c = 0; c < channels; c++) {
+          row[i + c] = c < srgbChannels ? toLinear[source[i + c]]
+                                        : source[i + c] * (1.0f / 255.0f);
+        }
+      }
+
+      cachedRows[y % MAX_TAPS] = y;
+    }
+
+    return (const float *)row;
+  };
+
+  vector<float> previous;
+  vector<float> current;
+  vector<float> column(rowSize);
+
+  while (width > 1 || height > 1) {
+    int outWidth = max(width / 2, 1);
+    int outHeight = max(height / 2, 1);
+
+    current.resize((size_t)outWidth * outHeight * channels);
+
+    // Halving a single row or column leaves the other axis alone, which
+    // the kernels already do when every tap is clamped to the same pixel
+    for (int y = 0; y < outHeight; y++) {
+      const float *rows[MAX_TAPS];
+
+      for (int t = 0; t < kernel.taps; t++) {
+        int source = min(max(y * 2 + kernel.offset + t, 0), height - 1);
+
+        rows[t] = levels.empty()
+                      ? getBaseRow(source)
+                      : &previous[(size_t)source * width * channels];
+      }
+
+      filterColumns(rows, kernel.weights, kernel.taps, column.data(),
+                    width * channels);
+      filterRow(column.data(), width, channels, kernel,
+                &current[(size_t)y * outWidth * channels], outWidth);
+    }
+
+    // Convert the level to bytes. Coverage scaling is applied here and not
+    // to the floats, so the error doesn't build up in smaller levels
+    MipLevel level;
+    level.width = outWidth;
+    level.height = outHeight;
+    level.pixels.resize(current.size());
+
+    float scale = 1.0f;
+    if (coverageChannel != -1) {
+      scale = findCoverageScale(current.data(),
+                                (size_t)outWidth * outHeight, channels,
+                                coverageChannel, settings.coverageCutoff,
+                                coverage);
+    }
+
+    for (size_t i = 0; i < current.size(); i += channels) {
+      for (int c = 0; c < channels; c++) {
+        float value = current[i + c];
+
+        if (c < srgbChannels) {
+          level.pixels[i + c] =
+              toSRGB[(int)(value * LINEAR_TABLE_SIZE + 0.5f)];
+        } else {
+          if (c == coverageChannel) {
+            value = min(value * scale, 1.0f);
+          }
+
+          level.pixels[i + c] = (unsigned char)(value * 255.0f + 0.5f);
+        }
+      }
+    }
+
+    levels.push_back(move(level));
+
+    swap(previous, current);
+    width = outWidth;
+    height = outHeight;
+  }
+
+  return levels;
+}
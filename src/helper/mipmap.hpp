@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+/* The filter used to halve each mip level
+ *
+ * Box    - Averages 2x2 pixels. Fast, but blurry
+ * Kaiser - A 6 tap Kaiser windowed sinc. Keeps more detail in the
+ *          smaller levels
+ */
+enum class MipFilter { Box, Kaiser };
+
+// How a mip chain is generated
+struct MipSettings {
+  MipFilter filter = MipFilter::Kaiser;
+
+  // Averages the first three channels in linear space instead of sRGB.
+  // Only used for images with at least three channels
+  bool srgb = true;
+
+  // The channel that is alpha tested, or -1 if there is none. The channel
+  // is scaled in each level so the same fraction of pixels pass the test
+  // as in the base level
+  int coverageChannel = -1;
+
+  // The alpha test reference value (0-1)
+  float coverageCutoff = 0.5f;
+};
+
+// A single mip level
+struct MipLevel {
+  int width;
+  int height;
+
+  // Tightly packed pixels
+  std::vector<unsigned char> pixels;
+};
+
+/* Generates the mip chain of an image down to 1x1. Each level is halved
+ * from the previous one, so the work is about a third of the base level
+ * @param pixels Tightly packed pixels of the base level
+ * @param width The image width
+ * @param height The image height
+ * @param channels The number of channels in pixels (1-4)
+ * @param settings How the levels are filtered
+ * @returns Every level below the base, largest first
+ */
+std::vector<MipLevel> generateMipChain(const unsigned char *pixels, int width,
+                                       int height, int channels,
+                                       const MipSettings &settings = {});
@@ -0,0 +1,79 @@
+#include "helper/threadpool.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    // Leave a thread for the OpenGL thread
+    unsigned int hardware = thread::hardware_concurrency();
+    threads = hardware > 1 ? hardware - 1 : 1;
+  }
+
+  for (size_t i = 0; i < threads; i++) {
+    this->workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() { this->stop(); }
+
+void ThreadPool::stop() {
+  {
+    lock_guard<mutex> lock(this->taskLock);
+    this->stopping = true;
+    this->tasks.clear();
+  }
+
+  this->taskReady.notify_all();
+
+  for (auto &worker : this->workers) {
+    worker.join();
+  }
+
+  this->workers.clear();
+}
+
+void ThreadPool::submit(function<void()> task) {
+  {
+    lock_guard<mutex> lock(this->taskLock);
+    this->tasks.push_back(move(task));
+    this->pending++;
+  }
+
+  this->taskReady.notify_one();
+}
+
+void ThreadPool::wait() {
+  unique_lock<mutex> lock(this->taskLock);
+  this->taskDone.wait(lock, [this] { return this->pending == 0; });
+}
+
+size_t ThreadPool::getThreadCount() { return this->workers.size(); }
+
+void ThreadPool::work() {
+  while (true) {
+    function<void()> task;
+
+    {
+      // Wait for a task or for the pool to stop
+      unique_lock<mutex> lock(this->taskLock);
+      this->taskReady.wait(
+          lock, [this] { return this->stopping || !this->tasks.empty(); });
+
+      if (this->stopping) {
+        return;
+      }
+
+      task = move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+
+    task();
+
+    {
+      lock_guard<mutex> lock(this->taskLock);
+      this->pending--;
+    }
+
+    this->taskDone.notify_all();
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed size pool of worker threads. Tasks are run in the
+// order they are submitted
+class ThreadPool {
+private:
+  /* Starts the worker threads
+   * @param threads The number of worker threads. Zero uses one less than the
+   * number of hardware threads
+   */
+  ThreadPool(size_t threads = 0);
+
+public:
+  // Stops the worker threads
+  ~ThreadPool();
+
+  // Queues a task to be run on a worker thread
+  // @param task The task to run
+  void submit(std::function<void()> task);
+
+  // Blocks until every submitted task has finished
+  void wait();
+
+  // Waits for the running tasks to finish and stops the worker threads.
+  // Tasks that have not started are dropped
+  void stop();
+
+  // Returns the number of worker threads
+  // @returns The number of worker threads
+  size_t getThreadCount();
+
+  /* Starts the worker threads
+   * @param threads The number of worker threads. Zero uses one less than the
+   * number of hardware threads
+   */
+  inline static auto create(size_t threads = 0) {
+    return std::shared_ptr<ThreadPool>(new ThreadPool{threads});
+  }
+
+private:
+  // The loop each worker thread runs
+  void work();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+
+  std::mutex taskLock;
+  std::condition_variable taskReady;
+  std::condition_variable taskDone;
+
+  // Number of tasks that are queued or running
+  size_t pending = 0;
+  bool stopping = false;
+};
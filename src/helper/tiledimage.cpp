@@ -0,0 +1,78 @@
+#include "helper/tiledimage.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+TiledImage::TiledImage(const string &path, int width, int height,
+                       int tileWidth, int tileHeight)
+    : file(path, ios::binary), width(width), height(height),
+      tileWidth(tileWidth), tileHeight(tileHeight) {
+  this->columns = (width + tileWidth - 1) / tileWidth;
+  this->rows = (height + tileHeight - 1) / tileHeight;
+
+  this->band.resize((size_t)width * tileHeight * 3);
+
+  this->file << "P6\n" << width << " " << height << "\n255\n";
+}
+
+bool TiledImage::isOpen() { return this->file.good(); }
+
+size_t TiledImage::getTileCount() {
+  return (size_t)this->columns * this->rows;
+}
+
+size_t TiledImage::getTilesAdded() { return this->added; }
+
+ImageTile TiledImage::getNextTile() {
+  int column = (int)(this->added % this->columns);
+  int row = (int)(this->added / this->columns);
+
+  // Rows are counted from the top, but the tile from the bottom
+  int top = row * this->tileHeight;
+
+  return ImageTile{column * this->tileWidth,
+                   this->height - top - this->tileHeight, this->tileWidth,
+                   this->tileHeight};
+}
+
+bool TiledImage::addTile(const uint8_t *pixels) {
+  if (this->isDone()) {
+    return false;
+  }
+
+  int column = (int)(this->added % this->columns);
+  int row = (int)(this->added / this->columns);
+
+  int left = column * this->tileWidth;
+  int top = row * this->tileHeight;
+
+  int copyWidth = std::min(this->tileWidth, this->width - left);
+  int copyHeight = std::min(this->tileHeight, this->height - top);
+
+  // The tile's rows are bottom up, so its top row is its last
+  for (int y = 0; y < copyHeight; y++) {
+    const uint8_t *source =
+        pixels + (size_t)(this->tileHeight - 1 - y) * this->tileWidth * 3;
+    uint8_t *destination =
+        &this->band[((size_t)y * this->width + left) * 3];
+
+    memcpy(destination, source, (size_t)copyWidth * 3);
+  }
+
+  this->added++;
+
+  if (column == this->columns - 1) {
+    this->file.write((const char *)this->band.data(),
+                     (streamsize)this->width * copyHeight * 3);
+
+    if (this->isDone()) {
+      this->file.close();
+    }
+  }
+
+  return !this->file.fail();
+}
+
+bool TiledImage::isDone() { return this->added == this->getTileCount(); }
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A tile of a TiledImage. x and y are the bottom left corner, counted from
+// the bottom left of the image like OpenGL's pixels. Tiles on the right and
+// top edges reach past the image
+struct ImageTile {
+  int x, y;
+  int width, height;
+};
+
+/* Writes an image too large to keep in memory as a binary PPM, one tile
+ * at a time. Tiles are added from the top row down and left to right in
+ * each row. Only the row of tiles being added is held in memory, and it
+ * is written out once its last tile is added
+ */
+class TiledImage {
+private:
+  /* Opens the file and writes the header
+   * @param path The file to write
+   * @param width The width of the image in pixels
+   * @param height The height of the image in pixels
+   * @param tileWidth The width of each tile in pixels
+   * @param tileHeight The height of each tile in pixels
+   */
+  TiledImage(const std::string &path, int width, int height, int tileWidth,
+             int tileHeight);
+
+public:
+  // Returns if the file opened
+  // @returns If the file opened
+  bool isOpen();
+
+  // Returns the number of tiles
+  // @returns The number of tiles
+  size_t getTileCount();
+
+  // Returns the number of tiles added
+  // @returns The number of tiles
+  size_t getTilesAdded();
+
+  // Returns the tile to add next
+  // @returns The tile
+  ImageTile getNextTile();
+
+  /* Adds the next tile. The pixels past the image's edges are dropped
+   * @param pixels tileWidth * tileHeight RGB pixels, rows from the bottom
+   * up with no padding, like glReadPixels with a pack alignment of 1
+   * @returns If the file was written without errors
+   */
+  bool addTile(const uint8_t *pixels);
+
+  // Returns if every tile was added and written
+  // @returns If the image is done
+  bool isDone();
+
+  /* Opens the file and writes the header
+   * @param path The file to write
+   * @param width The width of the image in pixels
+   * @param height The height of the image in pixels
+   * @param tileWidth The width of each tile in pixels
+   * @param tileHeight The height of each tile in pixels
+   */
+  inline static auto create(const std::string &path, int width, int height,
+                            int tileWidth, int tileHeight) {
+    return std::shared_ptr<TiledImage>(
+        new TiledImage{path, width, height, tileWidth, tileHeight});
+  }
+
+private:
+  std::ofstream file;
+
+  int width, height;
+  int tileWidth, tileHeight;
+  int columns, rows;
+
+  size_t added = 0;
+
+  // The image rows of the current row of tiles, from the top down
+  std::vector<uint8_t> band;
+};
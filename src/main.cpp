@@ -27,17 +27,29 @@
 
 #include "platform/buffer.hpp"
 #include "platform/framebuffer.hpp"
+#include "platform/gputimer.hpp"
+#include "platform/readback.hpp"
 #include "platform/shader.hpp"
 #include "platform/texture.hpp"
+#include "platform/texturebaker.hpp"
+#include "platform/texturecache.hpp"
 #include "platform/window.hpp"
 
 #include "rendering/camera.hpp"
+#include "rendering/geometry.hpp"
+#include "rendering/indirect.hpp"
 #include "rendering/light.hpp"
+#include "rendering/loader.hpp"
 #include "rendering/model.hpp"
+#include "rendering/occlusion.hpp"
+#include "rendering/pages.hpp"
 #include "rendering/transform.hpp"
 
+#include "helper/governor.hpp"
 #include "helper/gui.hpp"
 #include "helper/log.hpp"
+#include "helper/tiledimage.hpp"
+#include "helper/threadpool.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -52,10 +64,18 @@ using namespace glm;
 #define COUNT_SHADER(s) s[1]
 #define TRANSPARENT_SHADER(s) s[2]
 #define COMBINE_SHADER(s) s[3]
+#define OPAQUE_INDIRECT_SHADER(s) s[4]
+#define RESOLVE_SHADER(s) s[5]
+#define DOWNSAMPLE_SHADER(s) s[6]
+#define UPSAMPLE_SHADER(s) s[7]
 
 #define ABUFFER_COUNTER(a) (dynamic_pointer_cast<BufferCounter>(a[0]))
 #define ABUFFER_HEAD(a) (dynamic_pointer_cast<BufferStorage>(a[1]))
 #define ABUFFER_DATA(a) (dynamic_pointer_cast<BufferStorage>(a[2]))
+#define ABUFFER_TILES(a) (dynamic_pointer_cast<BufferStorage>(a[3]))
+#define ABUFFER_STATS(a) (dynamic_pointer_cast<BufferStorage>(a[4]))
+#define ABUFFER_MATERIALS(a) (dynamic_pointer_cast<BufferStorage>(a[5]))
+#define ABUFFER_PAGES(a) (dynamic_pointer_cast<BufferStorage>(a[6]))
 
 #define SPONZA(m) m[0]
 #define DRAGON(m) m[1]
@@ -64,12 +84,113 @@ using namespace glm;
 
 #define OPAQUE_COLOR(g) g[0]
 #define OPAQUE_DEPTH(g) g[1]
+#define TRANSPARENT_LAYER(g) g[2]
+#define TRANSPARENT_DEPTH(g) g[3]
 
 #define FRAMEBUFFER_OPAQUE(f) f[0]
+#define FRAMEBUFFER_TRANSPARENT(f) f[1]
 
 const unsigned int RES_X = 1280;
 const unsigned int RES_Y = 720;
 
+// The time in seconds each frame may spend uploading loaded assets
+const double uploadBudget = 0.004;
+
+// Packs textures of the same size and format into texture arrays, so that
+// meshes sharing them are drawn without texture binds in between
+const bool useTextureArrays = true;
+
+// Draws the opaque pass with multi draw indirect instead of a draw per mesh
+const bool useIndirectDraws = true;
+
+// Skips the chunks of meshes that are outside of the view frustum
+const bool useFrustumCulling = true;
+
+// Hides chunks behind Sponza's nearest walls and pillars using a small
+// depth buffer rasterized on the CPU
+const bool useOcclusionCulling = true;
+
+// The size of the occlusion buffer, and the most occluder triangles
+// rasterized into it each frame
+const int occlusionWidth = 320;
+const int occlusionHeight = 176;
+const size_t occluderBudget = 20000;
+
+// Skips the dragon's meshlets that are outside of the view frustum or
+// only have triangles facing away from the camera
+const bool useMeshletCulling = true;
+
+// Draws meshes with simplified levels of detail when the difference
+// covers at most lodMaxError pixels
+const bool useLODs = true;
+const float lodMaxError = 1.0f;
+
+// Limits the transparent passes, the head buffer clear and the resolve to
+// the pixels the dragon may cover. The rest of the screen is only copied
+const bool useTransparentScissor = true;
+
+// Tags head buffer entries with the frame's epoch instead of clearing the
+// head buffer every frame. The tag has 8 bits, so the buffer is only
+// cleared when the epoch wraps around
+const bool useHeadEpochs = true;
+const unsigned int headEpochCount = 256;
+
+// Marks the pixels with transparent fragments in the stencil buffer during
+// the count pass, so that only they run the list resolve
+const bool useStencilResolve = true;
+
+// Resolves the transparent fragments with a compute shader that works on
+// 8x8 tiles and skips the tiles the transparent pass didn't draw into,
+// instead of with a fragment shader over a quad
+const bool useComputeResolve = true;
+
+// Composites the transparent fragments from the nearest to the furthest,
+// and stops once less than resolveEpsilon of what is behind would show
+const bool useFrontToBack = true;
+const float resolveEpsilon = 1.0f / 255.0f;
+
+// Stores the surface of each transparent fragment instead of its lit
+// color, and lights only the fragments the resolve composites. Nodes
+// shrink from 48 to 20 bytes, but the resolve runs the lighting
+const bool useDeferredTransparency = true;
+
+// Keeps the fragment buffer's allocation while the fragment count moves
+// around, instead of reallocating it to the exact count every frame. With
+// immutable storage each reallocation makes a new buffer object
+const bool useBufferReserve = true;
+const bool useImmutableABuffer = false;
+
+// Hands out the fragment buffer in pages of FRAGMENT_PAGE_SIZE nodes. Each
+// 8x8 tile takes pages from the global counter and fills them itself, so
+// the counter is hit once per page and a tile's fragments are next to each
+// other for the resolve
+const bool usePagedAllocation = true;
+
+// Runs the count, transparent and resolve passes at 1 / transparentScale
+// of the resolution in each direction, against a shrunk copy of the opaque
+// depth. The result is blended back with a depth aware upsample. 1 keeps
+// the full resolution, 2 is half and 4 is quarter. The upsample can blur
+// thin transparent edges, so the full resolution is the default
+const unsigned int transparentScale = 1;
+const unsigned int transparentResX =
+    (RES_X + transparentScale - 1) / transparentScale;
+const unsigned int transparentResY =
+    (RES_Y + transparentScale - 1) / transparentScale;
+
+// Lowers the render resolution when the GPU passes take longer than
+// gpuBudget, down to minRenderScale of the resolution in each direction.
+// The render targets keep their full size and are rendered into their
+// bottom left, so changing the scale never reallocates them
+const bool useDynamicResolution = true;
+const double gpuBudget = 0.010;
+const float minRenderScale = 0.5f;
+
+// Stops the camera from moving through Sponza's walls
+const bool useCameraCollision = true;
+
+// How close the camera can get to a wall
+const float cameraRadius = 5.0f;
+
 const vec3 ambient = vec3(0.05f, 0.05f, 0.05f);
 const vec3 skyColor = vec3(0.812f, 0.992f, 1.0f);
 
@@ -89,9 +210,39 @@ const float quadPosition[] = {-1.0, -1.0, 1.0, -1.0, -1.0, 1.0,
 #if defined(_WIN32) && defined(IS_RELEASE)
 int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine,
             int nShowCmd) {
+  int argc = __argc;
+  char **argv = __argv;
 #else
-int main() {
+int main(int argc, char **argv) {
 #endif
+  // Baking textures doesn't need a window, so it is done before one is
+  // created. Usage: OIT --bake-textures <model.obj> <base folder>
+  if (argc == 4 && string(argv[1]) == "--bake-textures") {
+    return TextureBaker::bakeModel(argv[2], argv[3]) ? 0 : 1;
+  }
+
+  // Renders one image of any size in tiles of the window's resolution, and
+  // closes once it is written. The head and fragment buffers only ever
+  // hold one tile. Usage: OIT --render <width> <height> <image.ppm>
+  shared_ptr<TiledImage> tiledImage;
+  int imageWidth = 0, imageHeight = 0;
+
+  if (argc == 5 && string(argv[1]) == "--render") {
+    imageWidth = atoi(argv[2]);
+    imageHeight = atoi(argv[3]);
+
+    if (imageWidth <= 0 || imageHeight <= 0) {
+      critical("Invalid image size: %s x %s\n", argv[2], argv[3]);
+    }
+
+    tiledImage =
+        TiledImage::create(argv[4], imageWidth, imageHeight, RES_X, RES_Y);
+
+    if (!tiledImage->isOpen()) {
+      critical("Failed to open %s\n", argv[4]);
+    }
+  }
+
 #ifdef DEBUG_OPENGL
   auto window = Window::create(RES_X, RES_Y, "OIT OpenGL 4.3", true);
 #else
@@ -99,14 +250,14 @@ int main() {
 #endif
   GUI::setup(window);
 
-  array<std::shared_ptr<Framebuffer>, 1> fBuffers;
-  array<std::shared_ptr<TextureRender>, 2> gBuffers;
-  array<std::shared_ptr<Shader>, 4> shaders;
+  array<std::shared_ptr<Framebuffer>, 2> fBuffers;
+  array<std::shared_ptr<TextureRender>, 4> gBuffers;
+  array<std::shared_ptr<Shader>, 8> shaders;
 
   auto vao = BufferArray::create();
   array<std::shared_ptr<BufferData>, 1> dBuffers;
 
-  array<std::shared_ptr<Buffer>, 3> aBuffers;
+  array<std::shared_ptr<Buffer>, 7> aBuffers;
 
   array<Light, 3> lights;
 
@@ -126,23 +277,96 @@ int main() {
     critical("Could not create framebuffer\n");
   }
 
+  // Create the resources for the reduced transparent passes. The layer
+  // holds the composited color and transmittance of the transparent
+  // fragments, and the depth is the shrunk opaque depth
+  bool isReduced = transparentScale > 1;
+
+  if (isReduced) {
+    FRAMEBUFFER_TRANSPARENT(fBuffers) =
+        Framebuffer::create(transparentResX, transparentResY);
+
+    TRANSPARENT_LAYER(gBuffers) =
+        TextureRender::create(transparentResX, transparentResY, GL_RGBA16F);
+    TRANSPARENT_DEPTH(gBuffers) =
+        TextureRender::create(transparentResX, transparentResY, GL_R32F);
+
+    FRAMEBUFFER_TRANSPARENT(fBuffers)->bind();
+    FRAMEBUFFER_TRANSPARENT(fBuffers)->attach(TRANSPARENT_LAYER(gBuffers));
+    FRAMEBUFFER_TRANSPARENT(fBuffers)->attach(TRANSPARENT_DEPTH(gBuffers));
+
+    if (!FRAMEBUFFER_TRANSPARENT(fBuffers)->build()) {
+      critical("Could not create framebuffer\n");
+    }
+
+    FRAMEBUFFER_TRANSPARENT(fBuffers)->unbind();
+  }
+
+  // The framebuffer and scene depth the transparent passes use
+  auto transparentTarget = isReduced ? FRAMEBUFFER_TRANSPARENT(fBuffers)
+                                     : FRAMEBUFFER_OPAQUE(fBuffers);
+  auto transparentDepth =
+      isReduced ? TRANSPARENT_DEPTH(gBuffers) : OPAQUE_DEPTH(gBuffers);
+
   // Create shaders
   OPAQUE_SHADER(shaders) = Shader::CreateDefault("res/shaders/solid/shader.vert",
                                              "res/shaders/solid/shader.frag");
 
   COUNT_SHADER(shaders) = Shader::CreateDefault(
-      "res/shaders/solid/shader.vert", "res/shaders/transparent/count.frag");
+      "res/shaders/depth/shader.vert", "res/shaders/transparent/count.frag");
+
+  // The passes that write or read the A-buffer have to agree on its nodes
+  vector<string> transparentDefines;
+
+  if (useDeferredTransparency) {
+    transparentDefines.push_back("DEFERRED_SHADING");
+  }
+
+  size_t fragmentSize = useDeferredTransparency ? 20 : 48;
+
+  // Only the transparent pass allocates nodes
+  vector<string> allocateDefines = transparentDefines;
+
+  if (usePagedAllocation) {
+    allocateDefines.push_back("PAGED_ALLOCATION");
+  }
 
   TRANSPARENT_SHADER(shaders) = Shader::CreateDefault(
-      "res/shaders/solid/shader.vert", "res/shaders/transparent/shader.frag");
+      "res/shaders/solid/shader.vert", "res/shaders/transparent/shader.frag",
+      allocateDefines);
 
   COMBINE_SHADER(shaders) = Shader::CreateDefault(
-      "res/shaders/combine/shader.vert", "res/shaders/combine/shader.frag");
+      "res/shaders/combine/shader.vert", "res/shaders/combine/shader.frag",
+      transparentDefines);
+
+  OPAQUE_INDIRECT_SHADER(shaders) =
+      Shader::CreateDefault("res/shaders/solid/indirect.vert",
+                            "res/shaders/solid/indirect.frag");
+
+  // The reduced compute resolve writes the layer instead of blending
+  vector<string> resolveDefines = transparentDefines;
+
+  if (isReduced) {
+    resolveDefines.push_back("RESOLVE_TO_LAYER");
+  }
+
+  RESOLVE_SHADER(shaders) =
+      Shader::CreateCompute("res/shaders/combine/tiles.comp", resolveDefines);
+
+  DOWNSAMPLE_SHADER(shaders) = Shader::CreateDefault(
+      "res/shaders/combine/shader.vert", "res/shaders/combine/downsample.frag");
+
+  UPSAMPLE_SHADER(shaders) = Shader::CreateDefault(
+      "res/shaders/combine/shader.vert", "res/shaders/combine/upsample.frag");
 
   // Create resources for the transparency pass
   aBuffers[0] = BufferCounter::create();
   aBuffers[1] = BufferStorage::create();
-  aBuffers[2] = BufferStorage::create();
+  aBuffers[2] = BufferStorage::create(GL_DYNAMIC_COPY, useImmutableABuffer);
+  aBuffers[3] = BufferStorage::create();
+  aBuffers[4] = BufferStorage::create();
+  aBuffers[5] = BufferStorage::create();
+  aBuffers[6] = BufferStorage::create();
 
   ABUFFER_COUNTER(aBuffers)->bind();
   ABUFFER_COUNTER(aBuffers)->setLocation(0);
@@ -150,10 +374,54 @@ int main() {
   ABUFFER_HEAD(aBuffers)->bind();
   ABUFFER_HEAD(aBuffers)->setLocation(1);
   ABUFFER_HEAD(aBuffers)->resize(RES_X * RES_Y * 4);
+  ABUFFER_HEAD(aBuffers)->clear();
+
+  // Entries of epoch zero are the cleared buffer, so frames start at one
+  unsigned int headEpoch = 0;
 
   ABUFFER_DATA(aBuffers)->bind();
   ABUFFER_DATA(aBuffers)->setLocation(2);
 
+  // One entry per 8x8 tile. Entries hold the stamp of the last frame that
+  // drew into the tile, so it never needs to be cleared. Bindings 3 and 4
+  // belong to the indirect draws
+  unsigned int tilesX = (RES_X + 7) / 8;
+  unsigned int tilesY = (RES_Y + 7) / 8;
+
+  ABUFFER_TILES(aBuffers)->bind();
+  ABUFFER_TILES(aBuffers)->setLocation(5);
+  ABUFFER_TILES(aBuffers)->resize(tilesX * tilesY * 4);
+  ABUFFER_TILES(aBuffers)->clear();
+
+  unsigned int tileStamp = 0;
+
+  // The number of fragments the resolve skipped, that took a page of
+  // their own, and that got no node
+  ABUFFER_STATS(aBuffers)->bind();
+  ABUFFER_STATS(aBuffers)->setLocation(6);
+  ABUFFER_STATS(aBuffers)->resize(12);
+
+  unsigned int fragmentCount = 0;
+  unsigned int skippedFragments = 0;
+  unsigned int fallbackFragments = 0;
+  unsigned int droppedFragments = 0;
+
+  // The stats and the page count are read a few frames late, so reading
+  // them doesn't wait for the GPU
+  auto statsReadback = BufferReadback::create(16);
+
+  // The specular colors the resolve lights deferred fragments with
+  ABUFFER_MATERIALS(aBuffers)->bind();
+  ABUFFER_MATERIALS(aBuffers)->setLocation(7);
+
+  // The fragment count and latest pages of each tile. Every other storage
+  // binding is taken, but the atomic counter's binding 0 is separate
+  ABUFFER_PAGES(aBuffers)->bind();
+  ABUFFER_PAGES(aBuffers)->setLocation(0);
+  ABUFFER_PAGES(aBuffers)->resize(tilesX * tilesY * FRAGMENT_PAGE_STRIDE * 4);
+
+  unsigned int pageCount = 0;
+
   // Setup lights
   lights[0].position = vec3(0.0f, -45.0f, 0.0f);
   lights[0].color = vec3(1.0f, 1.0f, 1.0f);
@@ -171,13 +439,13 @@ int main() {
   for (auto &shader : shaders) {
     shader->bind();
 
-    if ((shader == TRANSPARENT_SHADER(shaders)) ||
-        (shader == COMBINE_SHADER(shaders))) {
-      shader->setUniformUInt("screenWidth", RES_X);
-    }
+    bool isResolve = (shader == COMBINE_SHADER(shaders)) ||
+                     (shader == RESOLVE_SHADER(shaders));
 
     if ((shader == OPAQUE_SHADER(shaders)) ||
-        (shader == TRANSPARENT_SHADER(shaders))) {
+        (shader == OPAQUE_INDIRECT_SHADER(shaders)) ||
+        (shader == TRANSPARENT_SHADER(shaders)) ||
+        (isResolve && useDeferredTransparency)) {
       shader->setUniformUInt("lightCount", lights.size());
       shader->setUniformVec3("globalAmbient", ambient);
 
@@ -190,6 +458,24 @@ int main() {
         (shader == TRANSPARENT_SHADER(shaders))) {
       shader->setUniformTexture("sceneDepth", 0);
     }
+
+    if (isResolve) {
+      shader->setUniformUInt("frontToBack", useFrontToBack ? 1 : 0);
+      shader->setUniformFloat("transmittanceEpsilon", resolveEpsilon);
+    }
+
+    if (shader == DOWNSAMPLE_SHADER(shaders)) {
+      shader->setUniformTexture("opaqueDepth", 0);
+      shader->setUniformUInt("scale", transparentScale);
+    }
+
+    if (shader == UPSAMPLE_SHADER(shaders)) {
+      shader->setUniformTexture("transparentLayer", 0);
+      shader->setUniformTexture("transparentDepth", 1);
+      shader->setUniformTexture("opaqueDepth", 2);
+      shader->setUniformUInt("scale", transparentScale);
+    }
+
   }
 
   // Create resources for combine pass
@@ -200,13 +486,45 @@ int main() {
 
   vao->setAttribute(0, 2, GL_FLOAT, 0, 0);
 
-  // Load models and set transforms
-  SPONZA(models) = Model::create("res/sponza/sponza.obj", "res/sponza/");
-  DRAGON(models) = Model::create("res/dragon/dragon.obj", "res/dragon/");
+  // Start loading models and set transforms. The models are filled in
+  // while the window is running
+  auto loader = AssetLoader::create(0, useTextureArrays);
+
+  SPONZA(models) = loader->loadModel("res/sponza/sponza.obj", "res/sponza/");
+  DRAGON(models) = loader->loadModel("res/dragon/dragon.obj", "res/dragon/");
 
   DRAGON(models)->transform.position = vec3(0.0f, -50.0f, 0.0f);
   DRAGON(models)->transform.scale = vec3(50.0f);
 
+  auto indirect = IndirectDraw::create();
+
+  // Occlusion and meshlet culling run one after another, so they share
+  // their worker threads
+  auto cullPool = ThreadPool::create();
+
+  auto occlusion =
+      OcclusionBuffer::create(occlusionWidth, occlusionHeight, cullPool);
+  double occlusionTime = 0.0;
+  double meshletTime = 0.0;
+
+  // GPU time of each pass. The resolve includes copying to the screen
+  auto opaqueTimer = GPUTimer::create();
+  auto countTimer = GPUTimer::create();
+  auto transparentTimer = GPUTimer::create();
+  auto resolveTimer = GPUTimer::create();
+
+  auto governor = ResolutionGovernor::create(gpuBudget, minRenderScale);
+
+  // The result of the last save of the governor's changes
+  const char *governorSaved = "";
+
+  // Each finished tile is read back from the screen
+  vector<uint8_t> tilePixels;
+
+  if (tiledImage) {
+    tilePixels.resize((size_t)RES_X * RES_Y * 3);
+  }
+
   // Create camera and set transform
   auto camera = Camera::create(70.0f, RES_X / (float)RES_Y, 10.0f, 3000.0f);
   camera->transform.position.z = -75.0f;
@@ -226,7 +544,7 @@ int main() {
 
   window->setClearColor(skyColor);
 
-  // Loading is done. Show the window
+  // Setup is done. Show the window
   window->showWindow(true);
   while (!window->shouldClose()) {
     // Calculate delta time
@@ -234,13 +552,29 @@ int main() {
     deltaTime = currentTime - lastTime;
     lastTime = currentTime;
 
+    // Upload any assets that finished loading
+    loader->update(uploadBudget);
+
+    // Tiles start once everything is loaded, so they all see the same
+    // scene. The scene stays still while rendering
+    bool isTileFrame = tiledImage && !loader->isLoading();
+    ImageTile tile{};
+
+    if (isTileFrame) {
+      tile = tiledImage->getNextTile();
+    }
+
     // Rotate dragon
-    DRAGON(models)->transform.rotateAxis(vec3(0.0f, 1.0f, 0.0f),
-                                         -deltaTime * 3.0f);
+    if (!tiledImage) {
+      DRAGON(models)->transform.rotateAxis(vec3(0.0f, 1.0f, 0.0f),
+                                           -deltaTime * 3.0f);
+    }
+
+    vec3 lastCameraPosition = camera->transform.position;
 
     // Calculate camera movement if the right mouse button
     // is down
-    if (GUI::isButtonDown(1)) {
+    if (!tiledImage && GUI::isButtonDown(1)) {
       GUI::captureMouse(true);
 
       // Calculate mouse delta
@@ -320,61 +654,464 @@ int main() {
       GUI::getCursorPos(lastPosX, lastPosY);
     }
 
+    // Tiles cover part of the image with the whole clip space
+    mat4 PV = isTileFrame
+                  ? camera->getTileMatrix(tile.x, tile.y, tile.width,
+                                          tile.height, imageWidth, imageHeight)
+                  : camera->getMatrix();
+
     // Update shaders
     for (auto &shader : shaders) {
       shader->bind();
 
-      if ((shader != COMBINE_SHADER(shaders))) {
-        shader->setUniformMatrix("PV", camera->getMatrix());
+      bool isScreenPass = (shader == COMBINE_SHADER(shaders)) ||
+                          (shader == RESOLVE_SHADER(shaders)) ||
+                          (shader == DOWNSAMPLE_SHADER(shaders)) ||
+                          (shader == UPSAMPLE_SHADER(shaders));
+
+      if (!isScreenPass) {
+        shader->setUniformMatrix("PV", PV);
       }
 
+      bool isResolve = (shader == COMBINE_SHADER(shaders)) ||
+                       (shader == RESOLVE_SHADER(shaders));
+
       if ((shader == OPAQUE_SHADER(shaders)) ||
-          (shader == TRANSPARENT_SHADER(shaders))) {
+          (shader == OPAQUE_INDIRECT_SHADER(shaders)) ||
+          (shader == TRANSPARENT_SHADER(shaders)) ||
+          (isResolve && useDeferredTransparency)) {
         shader->setUniformVec3("viewPosition", camera->transform.position);
       }
+
+      if (isResolve && useDeferredTransparency) {
+        shader->setUniformMatrix("inversePV", inverse(PV));
+      }
+    }
+
+    // The dragon's materials may still be loading, so they are sent every
+    // frame. There are only a few
+    if (useDeferredTransparency) {
+      auto specular = DRAGON(models)->getSpecularColors();
+
+      if (!specular.empty()) {
+        ABUFFER_MATERIALS(aBuffers)->setData(specular.size() * sizeof(vec4),
+                                             specular.data());
+        ABUFFER_MATERIALS(aBuffers)->setLocation(7);
+      }
+    }
+
+    // Stop the camera short of the first wall it would move through
+    vec3 cameraMove = camera->transform.position - lastCameraPosition;
+    float cameraDistance = length(cameraMove);
+
+    if (useCameraCollision && cameraDistance > 0.0f) {
+      vec3 direction = cameraMove / cameraDistance;
+      float distance = cameraDistance + cameraRadius;
+
+      if (SPONZA(models)->raycast(lastCameraPosition, direction, distance)) {
+        camera->transform.position =
+            lastCameraPosition +
+            direction * std::max(distance - cameraRadius, 0.0f);
+      }
+    }
+
+    // Cull once per frame. Every pass draws from the same camera
+    CullStats cullStats;
+
+    // Occlusion and meshlet culling refine the chunks of the frustum cull,
+    // so they need it to run every frame
+    if (useFrustumCulling || useOcclusionCulling || useMeshletCulling) {
+      for (auto &model : models) {
+        model->cull(PV);
+      }
+    }
+
+    // Sponza is the only model solid enough to hide anything. Every
+    // model, including Sponza, is tested against it
+    if (useOcclusionCulling) {
+      double start = glfwGetTime();
+
+      occlusion->clear();
+      SPONZA(models)->addOccluders(*occlusion, PV, occluderBudget);
+      occlusion->render();
+
+      for (auto &model : models) {
+        model->cullOcclusion(*occlusion, PV);
+      }
+
+      occlusionTime = glfwGetTime() - start;
+    }
+
+    // Only the dragon has enough triangles for meshlets to pay off
+    if (useMeshletCulling) {
+      double start = glfwGetTime();
+
+      DRAGON(models)->cullMeshlets(PV, camera->transform.position,
+                                   cullPool.get());
+
+      meshletTime = glfwGetTime() - start;
+    }
+
+    // The timers are a few frames behind, so the governor reacts to the
+    // GPU time of an earlier frame
+    double gpuTime = opaqueTimer->getTime() + countTimer->getTime() +
+                     transparentTimer->getTime() + resolveTimer->getTime();
+    float renderScale = useDynamicResolution && !tiledImage
+                            ? governor->update(gpuTime)
+                            : 1.0f;
+
+    unsigned int renderWidth =
+        std::max(1u, (unsigned int)std::round(RES_X * renderScale));
+    unsigned int renderHeight =
+        std::max(1u, (unsigned int)std::round(RES_Y * renderScale));
+    unsigned int transparentWidth =
+        (renderWidth + transparentScale - 1) / transparentScale;
+    unsigned int transparentHeight =
+        (renderHeight + transparentScale - 1) / transparentScale;
+
+    FRAMEBUFFER_OPAQUE(fBuffers)->setRenderSize(renderWidth, renderHeight);
+
+    // The transparent framebuffer only exists at a reduced resolution
+    if (isReduced) {
+      FRAMEBUFFER_TRANSPARENT(fBuffers)->setRenderSize(transparentWidth,
+                                                       transparentHeight);
+    }
+
+    LODStats lodStats;
+
+    if (useLODs) {
+      for (auto &model : models) {
+        model->selectLODs(*camera, isTileFrame ? imageHeight : renderHeight,
+                          lodMaxError);
+        lodStats.add(model->getLODStats());
+      }
+    }
+
+    for (auto &model : models) {
+      cullStats.add(model->getCullStats());
+    }
+
+    // The dragon is the only transparent model. The head buffer only
+    // covers its rectangle, so less of it is cleared. It is in the pixels
+    // of the transparent passes
+    ScreenRect transparentRect{0, 0, (int)transparentWidth,
+                               (int)transparentHeight};
+
+    if (useTransparentScissor) {
+      transparentRect = DRAGON(models)->getScreenRect(PV, transparentWidth,
+                                                      transparentHeight);
+    }
+
+    bool hasTransparency = !transparentRect.isEmpty();
+
+    // The same rectangle on the screen, which the render size is stretched
+    // over
+    float toScreenX = transparentScale * RES_X / (float)renderWidth;
+    float toScreenY = transparentScale * RES_Y / (float)renderHeight;
+
+    ScreenRect screenRect{(int)(transparentRect.x * toScreenX),
+                          (int)(transparentRect.y * toScreenY), 0, 0};
+    screenRect.width = std::min(
+        (int)std::ceil((transparentRect.x + transparentRect.width) * toScreenX),
+        (int)RES_X) - screenRect.x;
+    screenRect.height = std::min(
+        (int)std::ceil((transparentRect.y + transparentRect.height) * toScreenY),
+        (int)RES_Y) - screenRect.y;
+
+    unsigned int headRect[4] = {(unsigned int)transparentRect.x,
+                                (unsigned int)transparentRect.y,
+                                (unsigned int)transparentRect.width,
+                                (unsigned int)transparentRect.height};
+
+    // Without epochs every frame uses epoch zero, and the head buffer is
+    // cleared instead
+    if (useHeadEpochs && hasTransparency) {
+      headEpoch = (headEpoch + 1) % headEpochCount;
+
+      if (headEpoch == 0) {
+        ABUFFER_HEAD(aBuffers)->clear();
+        headEpoch = 1;
+      }
+    }
+
+    // Zero is the cleared tile buffer, so stamps skip it when they wrap
+    tileStamp++;
+
+    if (tileStamp == 0) {
+      ABUFFER_TILES(aBuffers)->clear();
+      tileStamp = 1;
+    }
+
+    TRANSPARENT_SHADER(shaders)->bind();
+    TRANSPARENT_SHADER(shaders)->setUniformUIntv("headRect", headRect, 4);
+    TRANSPARENT_SHADER(shaders)->setUniformUInt("headEpoch", headEpoch);
+    TRANSPARENT_SHADER(shaders)->setUniformUInt("tileStamp", tileStamp);
+    COMBINE_SHADER(shaders)->bind();
+    COMBINE_SHADER(shaders)->setUniformUIntv("headRect", headRect, 4);
+    COMBINE_SHADER(shaders)->setUniformUInt("headEpoch", headEpoch);
+    RESOLVE_SHADER(shaders)->bind();
+    RESOLVE_SHADER(shaders)->setUniformUIntv("headRect", headRect, 4);
+    RESOLVE_SHADER(shaders)->setUniformUInt("headEpoch", headEpoch);
+    RESOLVE_SHADER(shaders)->setUniformUInt("tileStamp", tileStamp);
+
+    // The resolves rebuild positions from the pixels of the transparent
+    // passes, and the resamples only read inside the render size
+    vec2 transparentSize = vec2(transparentWidth, transparentHeight);
+    vec2 renderSize = vec2(renderWidth, renderHeight);
+
+    if (useDeferredTransparency) {
+      COMBINE_SHADER(shaders)->bind();
+      COMBINE_SHADER(shaders)->setUniformVec2("screenSize", transparentSize);
+      RESOLVE_SHADER(shaders)->bind();
+      RESOLVE_SHADER(shaders)->setUniformVec2("screenSize", transparentSize);
+    }
+
+    if (isReduced) {
+      DOWNSAMPLE_SHADER(shaders)->bind();
+      DOWNSAMPLE_SHADER(shaders)->setUniformVec2("renderSize", renderSize);
+      UPSAMPLE_SHADER(shaders)->bind();
+      UPSAMPLE_SHADER(shaders)->setUniformVec2("renderSize", renderSize);
     }
 
     // Opaque pass
     ABUFFER_COUNTER(aBuffers)->reset();
 
+    opaqueTimer->begin();
+
     FRAMEBUFFER_OPAQUE(fBuffers)->bind();
     FRAMEBUFFER_OPAQUE(fBuffers)->clear();
 
-    SPONZA(models)->draw(OPAQUE_SHADER(shaders));
+    if (useIndirectDraws) {
+      indirect->clear();
+      indirect->add(SPONZA(models));
+      indirect->draw(OPAQUE_INDIRECT_SHADER(shaders));
+    } else {
+      SPONZA(models)->draw(OPAQUE_SHADER(shaders));
+    }
+
+    opaqueTimer->end();
 
     // Count pass
+    countTimer->begin();
+
+    // The reduced passes test against the furthest opaque depth under each
+    // of their pixels. The whole layer is written, so the upsample never
+    // reads old pixels past the edges of the rectangle
+    if (isReduced) {
+      FRAMEBUFFER_TRANSPARENT(fBuffers)->bind();
+      FRAMEBUFFER_TRANSPARENT(fBuffers)->clear();
+
+      DOWNSAMPLE_SHADER(shaders)->bind();
+      OPAQUE_DEPTH(gBuffers)->bind(0);
+
+      glDepthFunc(GL_ALWAYS);
+
+      vao->bind();
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      vao->unbind();
+
+      glDepthFunc(GL_LESS);
+    }
+
     window->setDepthTest(false);
-    OPAQUE_DEPTH(gBuffers)->bind(0);
+    transparentDepth->bind(0);
+
+    window->setScissor(true, transparentRect.x, transparentRect.y,
+                       transparentRect.width, transparentRect.height);
 
-    DRAGON(models)->draw(COUNT_SHADER(shaders));
+    // Fragments that pass the depth test mark their pixel. The count
+    // shader uses early fragment tests, so this matches what it counts
+    if (useStencilResolve && !useComputeResolve) {
+      glEnable(GL_STENCIL_TEST);
+      glStencilFunc(GL_ALWAYS, 1, 0xFF);
+      glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    }
+
+    if (hasTransparency) {
+      DRAGON(models)->draw(COUNT_SHADER(shaders));
+    }
+
+    glDisable(GL_STENCIL_TEST);
+
+    countTimer->end();
 
     // Transparent pass
 
     // Resize transparency buffers to the number of
     // transparent fragments to draw
-    ABUFFER_DATA(aBuffers)->resize(ABUFFER_COUNTER(aBuffers)->read() * 48);
+    fragmentCount = ABUFFER_COUNTER(aBuffers)->read();
+
+    // Pages leave the end of each tile's last page unused. The fallbacks
+    // are from a few frames ago, which is close enough since they are rare
+    size_t rectTiles = (size_t)((transparentRect.width + 7) / 8) *
+                       ((transparentRect.height + 7) / 8);
+    size_t nodeCount = usePagedAllocation
+                           ? PageAllocator::getNodeBound(
+                                 fragmentCount, rectTiles, fallbackFragments)
+                           : fragmentCount;
+
+    if (useBufferReserve) {
+      ABUFFER_DATA(aBuffers)->reserve(nodeCount * fragmentSize);
+    } else {
+      ABUFFER_DATA(aBuffers)->resize(nodeCount * fragmentSize);
+    }
     ABUFFER_COUNTER(aBuffers)->reset();
-    ABUFFER_HEAD(aBuffers)->clear();
 
-    DRAGON(models)->draw(TRANSPARENT_SHADER(shaders));
+    // The counter hands out pages instead of nodes. Nodes past the head
+    // entries' index bits can't be used
+    if (usePagedAllocation && hasTransparency) {
+      size_t listCapacity =
+          std::min(ABUFFER_DATA(aBuffers)->getCapacity() / fragmentSize,
+                   (size_t)1 << 24);
+
+      TRANSPARENT_SHADER(shaders)->bind();
+      TRANSPARENT_SHADER(shaders)->setUniformUInt("listCapacity",
+                                                  (unsigned int)listCapacity);
+
+      ABUFFER_PAGES(aBuffers)->clear(0, rectTiles * FRAGMENT_PAGE_STRIDE * 4);
+    }
+
+    ABUFFER_STATS(aBuffers)->clear();
+
+    transparentTimer->begin();
+
+    if (hasTransparency) {
+      if (!useHeadEpochs) {
+        ABUFFER_HEAD(aBuffers)->clear(
+            0, (size_t)transparentRect.width * transparentRect.height * 4);
+      }
+
+      DRAGON(models)->draw(TRANSPARENT_SHADER(shaders));
+    }
+
+    transparentTimer->end();
 
     // Combine pass
+
+    // The resolve blends the fragments over the opaque color in place, so
+    // pixels without transparent fragments are left as they are. With the
+    // stencil, only the marked pixels run the resolve
+    resolveTimer->begin();
+
+    if (hasTransparency && useComputeResolve) {
+      // A work group per tile of the head rect. Groups of empty tiles
+      // return after reading the tile's stamp
+      RESOLVE_SHADER(shaders)->bind();
+
+      if (isReduced) {
+        TRANSPARENT_LAYER(gBuffers)->bindImage(0, GL_WRITE_ONLY);
+      } else {
+        OPAQUE_COLOR(gBuffers)->bindImage(0, GL_READ_WRITE);
+      }
+
+      ABUFFER_DATA(aBuffers)->barrier();
+
+      glDispatchCompute((transparentRect.width + 7) / 8,
+                        (transparentRect.height + 7) / 8, 1);
+
+      // The blit reads the color through the framebuffer, and the upsample
+      // reads the layer as a texture
+      glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT |
+                      GL_TEXTURE_FETCH_BARRIER_BIT);
+    } else if (hasTransparency) {
+      COMBINE_SHADER(shaders)->bind();
+      ABUFFER_DATA(aBuffers)->barrier();
+
+      if (useStencilResolve) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+      }
+
+      // The quad covers the opaque depth, and the depth attachment isn't
+      // needed after the transparent pass. The reduced layer is written as
+      // it is, and blended by the upsample
+      glDisable(GL_DEPTH_TEST);
+      glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+      if (!isReduced) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+      }
+
+      vao->bind();
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      vao->unbind();
+
+      glDisable(GL_BLEND);
+      glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      glEnable(GL_DEPTH_TEST);
+      glDisable(GL_STENCIL_TEST);
+    }
+
+    window->setScissor(false);
     window->setDepthTest(true);
 
-    FRAMEBUFFER_OPAQUE(fBuffers)->unbind();
+    transparentTarget->unbind();
+    FRAMEBUFFER_OPAQUE(fBuffers)->blit();
 
-    COMBINE_SHADER(shaders)->bind();
+    // Blend the reduced layer over the screen
+    if (isReduced && hasTransparency) {
+      UPSAMPLE_SHADER(shaders)->bind();
+      TRANSPARENT_LAYER(gBuffers)->bind(0);
+      TRANSPARENT_DEPTH(gBuffers)->bind(1);
+      OPAQUE_DEPTH(gBuffers)->bind(2);
 
-    for (size_t i = 0; i < gBuffers.size(); i++) {
-      gBuffers[i]->bind(i);
+      window->setScissor(true, screenRect.x, screenRect.y, screenRect.width,
+                         screenRect.height);
+
+      glDisable(GL_DEPTH_TEST);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+
+      vao->bind();
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      vao->unbind();
+
+      glDisable(GL_BLEND);
+      glEnable(GL_DEPTH_TEST);
+
+      window->setScissor(false);
     }
 
-    COMBINE_SHADER(shaders)->setUniformTexture("opaqueColor", 0);
-    ABUFFER_DATA(aBuffers)->barrier();
+    resolveTimer->end();
+
+    // The finished tile is on the screen until the GUI is drawn over it
+    if (isTileFrame) {
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+      glReadPixels(0, 0, RES_X, RES_Y, GL_RGB, GL_UNSIGNED_BYTE,
+                   tilePixels.data());
+
+      if (!tiledImage->addTile(tilePixels.data())) {
+        critical("Failed to write the image\n");
+      }
+
+      if (tiledImage->isDone()) {
+        info("Wrote a %d x %d image in %zu tiles\n", imageWidth, imageHeight,
+             tiledImage->getTileCount());
+        glfwSetWindowShouldClose(window->getWindow(), GLFW_TRUE);
+      }
+    }
 
-    vao->bind();
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    vao->unbind();
+    // With paged allocation, the counter holds the pages the transparent
+    // pass took
+    if (hasTransparency) {
+      statsReadback->begin();
+      statsReadback->copy(*ABUFFER_STATS(aBuffers), 0, 12, 0);
+      statsReadback->copy(*ABUFFER_COUNTER(aBuffers), 0, 4, 12);
+      statsReadback->end();
+
+      auto stats = (const unsigned int *)statsReadback->getData();
+      skippedFragments = stats[0];
+      fallbackFragments = stats[1];
+      droppedFragments = stats[2];
+      pageCount = usePagedAllocation ? stats[3] : 0;
+    } else {
+      skippedFragments = 0;
+      fallbackFragments = 0;
+      droppedFragments = 0;
+      pageCount = 0;
+    }
 
     // Draw the GUI
     GUI::newFrame();
@@ -383,11 +1120,179 @@ int main() {
     // Window resolution
     ImGui::Text("Resolution: (%d, %d)", RES_X, RES_Y);
 
+    if (tiledImage) {
+      ImGui::Text("Rendering %d x %d: tile %zu / %zu", imageWidth, imageHeight,
+                  tiledImage->getTilesAdded(), tiledImage->getTileCount());
+    }
+
+    if (useDynamicResolution) {
+      ImGui::Text("Render resolution: (%u, %u) at %.0f%%", renderWidth,
+                  renderHeight, renderScale * 100.0f);
+      ImGui::Text("GPU budget: %.2f / %.2f ms, %zu scale changes",
+                  governor->getAverageTime() * 1000.0, gpuBudget * 1000.0,
+                  governor->getChangeCount());
+
+      // info is left out of release builds, so the changes are shown here
+      auto &history = governor->getHistory();
+
+      if (!history.empty() && ImGui::CollapsingHeader("Scale Changes")) {
+        if (ImGui::Button("Save to governor.csv")) {
+          governorSaved = governor->saveHistory("governor.csv")
+                              ? "Saved"
+                              : "Failed to save";
+        }
+
+        ImGui::SameLine();
+        ImGui::Text("%s", governorSaved);
+
+        for (auto change = history.rbegin(); change != history.rend();
+             change++) {
+          ImGui::Text("Frame %zu: %.0f%% -> %.0f%% (GPU %.2f ms)",
+                      change->frame, change->from * 100.0f,
+                      change->to * 100.0f, change->time * 1000.0);
+        }
+      }
+    }
+
     ImGui::Separator();
 
     // FPS display
     ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
 
+    // Loading progress
+    if (loader->isLoading()) {
+      ImGui::Separator();
+
+      size_t loaded = loader->getLoaded();
+      size_t total = loader->getTotal();
+
+      ImGui::Text("Loading assets (%zu / %zu)", loaded, total);
+      ImGui::ProgressBar(loaded / (float)total);
+    }
+
+    // Texture load times
+    auto textureQueue = loader->getTextureQueue();
+    auto &textureStats = textureQueue->getStats();
+
+    if (!textureStats.empty() && ImGui::CollapsingHeader("Texture Loading")) {
+      double decodeTime = 0.0;
+      double uploadTime = 0.0;
+
+      for (auto &stats : textureStats) {
+        decodeTime += stats.decodeTime;
+        uploadTime += stats.uploadTime;
+      }
+
+      ImGui::Text("Textures: %zu", textureStats.size());
+      ImGui::Text("Decode: %.1f ms (worker threads)", decodeTime * 1000.0);
+      ImGui::Text("Upload: %.1f ms", uploadTime * 1000.0);
+      ImGui::Text("Peak decoded: %.1f MB",
+                  textureQueue->getPeakBytes() / (1024.0 * 1024.0));
+    }
+
+    // Texture cache
+    ImGui::Text("Textures: %zu (%.1f MB)", TextureCache::getCount(),
+                TextureCache::getBytes() / (1024.0 * 1024.0));
+    ImGui::Text("Duplicate loads avoided: %zu", TextureCache::getHits());
+
+    if (auto buckets = loader->getTextureQueue()->getBuckets()) {
+      ImGui::Text("Texture arrays: %zu (%zu layers)", buckets->getCount(),
+                  buckets->getLayers());
+    }
+
+    if (useIndirectDraws) {
+      ImGui::Text("Opaque draws: %zu in %zu multi draws",
+                  indirect->getDrawCount(), indirect->getBatchCount());
+    }
+
+    if (useOcclusionCulling) {
+      ImGui::Text("Occlusion: %zu chunks hidden, %zu occluder triangles",
+                  cullStats.occludedChunks, occlusion->getTriangleCount());
+      ImGui::Text("Occlusion time: %.2f ms", occlusionTime * 1000.0);
+    }
+
+    if (useFrustumCulling || useOcclusionCulling) {
+      ImGui::Text("Culling: %zu / %zu meshes, %zu / %zu chunks drawn",
+                  cullStats.visibleMeshes, cullStats.meshes,
+                  cullStats.visibleChunks, cullStats.chunks);
+    }
+
+    if (useMeshletCulling && cullStats.meshlets > 0) {
+      ImGui::Text("Meshlets: %zu / %zu drawn (%.0f%% culled)",
+                  cullStats.visibleMeshlets, cullStats.meshlets,
+                  100.0 * (1.0 - cullStats.visibleMeshlets /
+                                     (double)cullStats.meshlets));
+      ImGui::Text("Meshlet culling time: %.2f ms", meshletTime * 1000.0);
+    }
+
+    ImGui::Text("GPU: opaque %.2f ms, count %.2f ms",
+                opaqueTimer->getTime() * 1000.0,
+                countTimer->getTime() * 1000.0);
+    ImGui::Text("GPU: transparent %.2f ms, resolve %.2f ms",
+                transparentTimer->getTime() * 1000.0,
+                resolveTimer->getTime() * 1000.0);
+
+    ImGui::Text("A-buffer: %u fragments, %.1f MB (%zu bytes each)",
+                fragmentCount, fragmentCount * fragmentSize / (1024.0 * 1024.0),
+                fragmentSize);
+    ImGui::Text("A-buffer capacity: %.1f MB (%.1f MB unused), %zu allocations",
+                ABUFFER_DATA(aBuffers)->getCapacity() / (1024.0 * 1024.0),
+                ABUFFER_DATA(aBuffers)->getOverReserved() / (1024.0 * 1024.0),
+                ABUFFER_DATA(aBuffers)->getReallocations());
+
+    if (usePagedAllocation && pageCount > 0) {
+      ImGui::Text("Pages: %u of %d nodes (%.0f%% filled)", pageCount,
+                  FRAGMENT_PAGE_SIZE,
+                  100.0 * fragmentCount / (pageCount * FRAGMENT_PAGE_SIZE));
+      ImGui::Text("Fallbacks: %u fragments", fallbackFragments);
+    }
+
+    if (droppedFragments > 0) {
+      ImGui::Text("Dropped: %u fragments", droppedFragments);
+    }
+
+    if (useFrontToBack && fragmentCount > 0) {
+      ImGui::Text("Resolve: %u / %u fragments skipped (%.0f%%)",
+                  skippedFragments, fragmentCount,
+                  100.0 * skippedFragments / fragmentCount);
+    }
+
+    if (useTransparentScissor) {
+      ImGui::Text("Transparent area: %d x %d (%.0f%% of the screen)",
+                  transparentRect.width, transparentRect.height,
+                  100.0 * transparentRect.width * transparentRect.height /
+                      (transparentWidth * transparentHeight));
+    }
+
+    if (isReduced) {
+      ImGui::Text("Transparency at 1/%u resolution (%u x %u)",
+                  transparentScale, transparentWidth, transparentHeight);
+    }
+
+    if (useLODs) {
+      string levels;
+      for (size_t lod = 0; lod <= MESH_LOD_LEVELS; lod++) {
+        levels += (lod > 0 ? " / " : "") + to_string(lodStats.meshes[lod]);
+      }
+
+      ImGui::Text("LOD meshes: %s", levels.c_str());
+      ImGui::Text("LOD triangles: %zu / %zu", lodStats.triangles,
+                  lodStats.fullTriangles);
+    }
+
+    {
+      auto geometry = GeometryBuffer::get();
+      auto vertexStats = geometry->getVertexStats();
+      auto indexStats = geometry->getIndexStats();
+
+      ImGui::Text("Geometry pool: %.1f / %.1f MB",
+                  geometry->getBytesUsed() / (1024.0f * 1024.0f),
+                  geometry->getBytesAllocated() / (1024.0f * 1024.0f));
+      ImGui::Text("Pool fragmentation: %.0f%% vertices, %.0f%% indices",
+                  vertexStats.fragmentation * 100.0f,
+                  indexStats.fragmentation * 100.0f);
+    }
+
     ImGui::Separator();
 
     ImGui::DragFloat("Mouse Speed", &mouseSpeed, 0.4f, 0.1f, 10.0f, "%.3f",
@@ -2,6 +2,8 @@
 
 #include "helper/log.hpp"
 
+#include <algorithm>
+
 // The max number of attributes our application can support
 #define MAX_ATTRIBUTES (sizeof(unsigned long) * 8)
 
@@ -50,6 +52,10 @@ void BufferArray::setAttributeI(unsigned int attribute, unsigned int components,
   glEnableVertexAttribArray(attribute);
 }
 
+void BufferArray::setDivisor(unsigned int attribute, unsigned int divisor) {
+  glVertexAttribDivisor(attribute, divisor);
+}
+
 unsigned int BufferArray::getMaxAttributes() {
   // Because of the number of bits in attributes, the software
   // can only support a maximum of MAX_ATTRIBUTES. OpenGL may
@@ -73,17 +79,68 @@ Buffer::~Buffer() { glDeleteBuffers(1, &this->buffer); }
 void Buffer::bind() {}
 void Buffer::unbind() {}
 
+GLuint Buffer::getID() { return this->buffer; }
+
 BufferData::BufferData(size_t size, const void *data, GLenum usage) {
   this->bind();
   glBufferData(GL_ARRAY_BUFFER, size, data, usage);
 }
 
+BufferData::BufferData() {}
+
+std::shared_ptr<BufferData> BufferData::createImmutable(size_t size,
+                                                   const void *data,
+                                                   GLbitfield flags) {
+  auto buffer = std::shared_ptr<BufferData>(new BufferData);
+  buffer->bind();
+  glBufferStorage(GL_ARRAY_BUFFER, size, data, flags);
+
+  return buffer;
+}
+
 void BufferData::bind() { glBindBuffer(GL_ARRAY_BUFFER, this->buffer); }
 
 void BufferData::unbind() { glBindBuffer(GL_ARRAY_BUFFER, 0); }
 
-BufferStorage::BufferStorage(GLenum usage) {
+BufferIndex::BufferIndex(size_t size, const void *data, GLenum usage) {
+  this->bind();
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+}
+
+BufferIndex::BufferIndex() {}
+
+std::shared_ptr<BufferIndex> BufferIndex::createImmutable(size_t size,
+                                                     const void *data,
+                                                     GLbitfield flags) {
+  auto buffer = std::shared_ptr<BufferIndex>(new BufferIndex);
+  buffer->bind();
+  glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, size, data, flags);
+
+  return buffer;
+}
+
+void BufferIndex::bind() {
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffer);
+}
+
+void BufferIndex::unbind() { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); }
+
+BufferIndirect::BufferIndirect(GLenum usage) { this->usage = usage; }
+
+void BufferIndirect::bind() {
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->buffer);
+}
+
+void BufferIndirect::unbind() { glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0); }
+
+void BufferIndirect::setData(size_t size, const void *data) {
+  this->bind();
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, size, data, this->usage);
+}
+
+BufferStorage::BufferStorage(GLenum usage, bool immutable) {
   this->usage = usage;
+  this->immutable = immutable;
 }
 
 void BufferStorage::bind() {
@@ -93,6 +150,9 @@ void BufferStorage::bind() {
 void BufferStorage::unbind() { glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); }
 
 void BufferStorage::setLocation(size_t location) {
+  this->hasLocation = true;
+  this->location = (GLuint)location;
+
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, location, this->buffer);
 }
 
@@ -101,15 +161,94 @@ void BufferStorage::clear() {
                          GL_UNSIGNED_BYTE, nullptr);
 }
 
+void BufferStorage::clear(size_t offset, size_t size) {
+  glClearNamedBufferSubData(this->buffer, GL_R32UI, offset, size,
+                            GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
 void BufferStorage::resize(size_t newSize) {
+  this->size = newSize;
+  this->allocate(newSize, nullptr);
+}
+
+void BufferStorage::reserve(size_t newSize) {
+  this->size = newSize;
+
+  size_t wanted = std::max((size_t)(newSize * BUFFER_GROWTH),
+                           (size_t)BUFFER_MIN_CAPACITY);
+
+  if (this->reallocations == 0 || newSize > this->capacity) {
+    this->underused = 0;
+    this->allocate(wanted, nullptr);
+    return;
+  }
+
+  // A single small frame doesn't shrink the buffer, or the next large one
+  // would grow it again
+  if (newSize * BUFFER_SHRINK_RATIO >= this->capacity ||
+      this->capacity <= BUFFER_MIN_CAPACITY) {
+    this->underused = 0;
+    return;
+  }
+
+  this->underusedPeak =
+      this->underused == 0 ? newSize : std::max(this->underusedPeak, newSize);
+  this->underused++;
+
+  if (this->underused >= BUFFER_SHRINK_FRAMES) {
+    this->underused = 0;
+    this->allocate(std::max((size_t)(this->underusedPeak * BUFFER_GROWTH),
+                            (size_t)BUFFER_MIN_CAPACITY),
+                   nullptr);
+  }
+}
+
+void BufferStorage::setData(size_t size, const void *data) {
+  this->size = size;
+  this->allocate(size, data);
+}
+
+void BufferStorage::allocate(size_t newCapacity, const void *data) {
+  this->capacity = newCapacity;
+  this->reallocations++;
+
+  if (!this->immutable) {
+    this->bind();
+    glBufferData(GL_SHADER_STORAGE_BUFFER, newCapacity, data, this->usage);
+    return;
+  }
+
+  // Immutable storage can't be specified twice, so it gets a new buffer
+  // object. Deleting the old one also unbinds it from its location
+  if (this->reallocations > 1) {
+    glDeleteBuffers(1, &this->buffer);
+    glGenBuffers(1, &this->buffer);
+  }
+
+  // Immutable storage can't be empty
   this->bind();
-  glBufferData(GL_SHADER_STORAGE_BUFFER, newSize, nullptr, this->usage);
+  glBufferStorage(GL_SHADER_STORAGE_BUFFER, std::max(newCapacity, (size_t)4),
+                  data, GL_DYNAMIC_STORAGE_BIT);
+
+  if (this->hasLocation) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, this->location, this->buffer);
+  }
 }
 
 void BufferStorage::barrier() {
   glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
+size_t BufferStorage::getSize() { return this->size; }
+
+size_t BufferStorage::getCapacity() { return this->capacity; }
+
+size_t BufferStorage::getOverReserved() {
+  return this->capacity > this->size ? this->capacity - this->size : 0;
+}
+
+size_t BufferStorage::getReallocations() { return this->reallocations; }
+
 BufferCounter::BufferCounter(unsigned int resetValue, GLbitfield usage) {
   // Creates a counter
   this->bind();
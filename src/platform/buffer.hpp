@@ -4,6 +4,18 @@
 
 #include "platform/opengl.hpp"
 
+// BufferStorage::reserve allocates this many times the size asked for, so
+// that a size that changes a little each frame doesn't reallocate
+#define BUFFER_GROWTH 1.5
+
+// The capacity shrinks once the size stayed below 1 / BUFFER_SHRINK_RATIO
+// of it for BUFFER_SHRINK_FRAMES reserves in a row
+#define BUFFER_SHRINK_RATIO 4
+#define BUFFER_SHRINK_FRAMES 120
+
+// The smallest capacity reserve allocates, in bytes
+#define BUFFER_MIN_CAPACITY 65536
+
 // Manages an OpenGL vertex array object
 class BufferArray {
 private:
@@ -43,6 +55,12 @@ public:
   void setAttributeI(unsigned int attribute, unsigned int components,
                      GLenum type, size_t stride, size_t offset);
 
+  /* Makes an attribute advance once per instance instead of per vertex
+   * @param attribute The attribute number
+   * @param divisor The number of instances that use each item
+   */
+  void setDivisor(unsigned int attribute, unsigned int divisor);
+
   // Returns the maximum number of attributes allowed
   // @returns The maximum number of attributes allowed
   static unsigned int getMaxAttributes();
@@ -75,6 +93,10 @@ public:
   // Unbinds the buffer object
   virtual void unbind();
 
+  // Returns the buffer ID
+  // @returns The buffer ID
+  GLuint getID();
+
 protected:
   GLuint buffer;
 };
@@ -89,6 +111,9 @@ private:
    */
   BufferData(size_t size, const void *data, GLenum usage = GL_STATIC_DRAW);
 
+  // Creates a buffer without any storage
+  BufferData();
+
 public:
   // Binds the buffer object
   void bind() override;
@@ -103,16 +128,98 @@ public:
   inline static auto create(size_t size, const void* data, GLenum usage = GL_STATIC_DRAW) {
     return std::shared_ptr<BufferData>(new BufferData{size, data, usage});
   }
+
+  /* Creates immutable storage on the GPU. The size can't change, but the
+   * contents can be updated if flags has GL_DYNAMIC_STORAGE_BIT
+   * @param size The length of the data
+   * @param data The pointer to the data, or nullptr
+   * @param flags OpenGL storage flags (GL_DYNAMIC_STORAGE_BIT)
+   */
+  static std::shared_ptr<BufferData>
+  createImmutable(size_t size, const void *data,
+                  GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
 };
 
-// This class manages OpenGL shader storage buffer objects.
+// Triangle indices are uploaded and managed using this class
+class BufferIndex : public Buffer {
+private:
+  /* Uploads indices onto the GPU
+   * @param size The length of the data
+   * @param data The pointer to the data
+   * @param usage OpenGL usage hint (GL_STATIC_DRAW)
+   */
+  BufferIndex(size_t size, const void *data, GLenum usage = GL_STATIC_DRAW);
+
+  // Creates a buffer without any storage
+  BufferIndex();
+
+public:
+  // Binds the buffer object
+  void bind() override;
+  // Unbinds the buffer object
+  void unbind() override;
+
+  /* Uploads indices onto the GPU
+   * @param size The length of the data
+   * @param data The pointer to the data
+   * @param usage OpenGL usage hint (GL_STATIC_DRAW)
+   */
+  inline static auto create(size_t size, const void *data,
+                            GLenum usage = GL_STATIC_DRAW) {
+    return std::shared_ptr<BufferIndex>(new BufferIndex{size, data, usage});
+  }
+
+  /* Creates immutable storage on the GPU. The size can't change, but the
+   * contents can be updated if flags has GL_DYNAMIC_STORAGE_BIT
+   * @param size The length of the data
+   * @param data The pointer to the data, or nullptr
+   * @param flags OpenGL storage flags (GL_DYNAMIC_STORAGE_BIT)
+   */
+  static std::shared_ptr<BufferIndex>
+  createImmutable(size_t size, const void *data,
+                  GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
+};
+
+// Draw commands for indirect draws are managed using this class
+class BufferIndirect : public Buffer {
+private:
+  // Creates an empty indirect buffer
+  // @param usage OpenGL usage hint (GL_DYNAMIC_DRAW)
+  BufferIndirect(GLenum usage = GL_DYNAMIC_DRAW);
+
+public:
+  // Binds the buffer object
+  void bind() override;
+  // Unbinds the buffer object
+  void unbind() override;
+
+  /* Reallocates the buffer and fills it with draw commands
+   * @param size The length of the data
+   * @param data The pointer to the data
+   */
+  void setData(size_t size, const void *data);
+
+  // Creates an empty indirect buffer
+  // @param usage OpenGL usage hint (GL_DYNAMIC_DRAW)
+  inline static auto create(GLenum usage = GL_DYNAMIC_DRAW) {
+    return std::shared_ptr<BufferIndirect>(new BufferIndirect{usage});
+  }
+
+private:
+  GLenum usage;
+};
+
+// This class manages OpenGL shader storage buffer objects. The size in
+// use is tracked apart from the allocated capacity
 class BufferStorage : public Buffer {
 private:
   /* Checks for SSBO support. Does not define a initial size.
-   * Use resize to create a buffer
+   * Use resize or reserve to create a buffer
    * @param usage OpenGL usage hint (GL_DYNAMIC_COPY)
+   * @param immutable Allocates with glBufferStorage. Each reallocation
+   * then makes a new buffer object, which is bound to the location again
    */
-  BufferStorage(GLenum usage = GL_DYNAMIC_COPY);
+  BufferStorage(GLenum usage = GL_DYNAMIC_COPY, bool immutable = false);
 
 public:
   // Binds the buffer object
@@ -129,25 +236,84 @@ public:
   // Sets the entire buffer to zero
   void clear();
 
+  /* Sets part of the buffer to zero
+   * @param offset The first byte to clear. Must be a multiple of 4
+   * @param size The number of bytes to clear. Must be a multiple of 4
+   */
+  void clear(size_t offset, size_t size);
+
   /* Tells OpenGL to reallocate the buffer with a new size.
    * Data is not copied between the old and new buffer memory
    * @param newSize The new size of the buffer
    */
   void resize(size_t newSize);
 
+  /* Makes sure the buffer holds at least a size. It only reallocates when
+   * the size doesn't fit, and then leaves room to grow, or when the size
+   * stayed far below the capacity for a while. Data is not copied between
+   * the old and new buffer memory
+   * @param newSize The size in use
+   */
+  void reserve(size_t newSize);
+
+  /* Reallocates the buffer and fills it with data
+   * @param size The length of the data
+   * @param data The pointer to the data
+   */
+  void setData(size_t size, const void *data);
+
   // Sets a memory barrier for SSBOs
   void barrier();
 
+  // Returns the size in use
+  // @returns The size in bytes
+  size_t getSize();
+
+  // Returns the allocated size
+  // @returns The size in bytes
+  size_t getCapacity();
+
+  // Returns the bytes allocated past the size in use
+  // @returns The size in bytes
+  size_t getOverReserved();
+
+  // Returns the number of times the buffer was allocated
+  // @returns The number of allocations
+  size_t getReallocations();
+
   /* Checks for SSBO support. Does not define a initial size.
-   * Use resize to create a buffer
+   * Use resize or reserve to create a buffer
    * @param usage OpenGL usage hint (GL_DYNAMIC_COPY)
+   * @param immutable Allocates with glBufferStorage. Each reallocation
+   * then makes a new buffer object, which is bound to the location again
    */
-  inline static auto create(GLenum usage = GL_DYNAMIC_COPY) {
-    return std::shared_ptr<BufferStorage>(new BufferStorage{usage});
+  inline static auto create(GLenum usage = GL_DYNAMIC_COPY,
+                            bool immutable = false) {
+    return std::shared_ptr<BufferStorage>(new BufferStorage{usage, immutable});
   }
 
 private:
+  /* Allocates the buffer's memory
+   * @param newCapacity The size to allocate
+   * @param data The data to fill it with, or nullptr
+   */
+  void allocate(size_t newCapacity, const void *data);
+
   GLenum usage;
+  bool immutable;
+
+  // The binding location, if one was set
+  bool hasLocation = false;
+  GLuint location = 0;
+
+  size_t size = 0;
+  size_t capacity = 0;
+  size_t reallocations = 0;
+
+  // The reserves in a row that used little of the capacity, and the
+  // largest size they asked for
+  size_t underused = 0;
+  size_t underusedPeak = 0;
 };
 
 // An OpenGL atomic counter is managed with this class
@@ -1,6 +1,9 @@
 #include "framebuffer.hpp"
 
-Framebuffer::Framebuffer(unsigned int resX, unsigned int resY) {
+#include <algorithm>
+
+Framebuffer::Framebuffer(unsigned int resX, unsigned int resY)
+    : resX(resX), resY(resY), renderX(resX), renderY(resY) {
   glGenFramebuffers(1, &this->fbo);
   this->bind();
 
@@ -59,10 +62,44 @@ bool Framebuffer::build() {
   return false;
 }
 
-void Framebuffer::bind() { glBindFramebuffer(GL_FRAMEBUFFER, this->fbo); }
+void Framebuffer::bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+
+  // Framebuffers can be smaller than the screen
+  glViewport(0, 0, this->renderX, this->renderY);
+}
 
-void Framebuffer::unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+void Framebuffer::unbind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  int width, height;
+  glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+  glViewport(0, 0, width, height);
+}
 
 void Framebuffer::clear() {
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void Framebuffer::blit() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, this->fbo);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+  bool isScaled = this->renderX != this->resX || this->renderY != this->resY;
+
+  glBlitFramebuffer(0, 0, this->renderX, this->renderY, 0, 0, this->resX,
+                    this->resY, GL_COLOR_BUFFER_BIT,
+                    isScaled ? GL_LINEAR : GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
+
+void Framebuffer::setRenderSize(unsigned int width, unsigned int height) {
+  this->renderX = std::min(width, this->resX);
+  this->renderY = std::min(height, this->resY);
+}
+
+unsigned int Framebuffer::getWidth() { return this->resX; }
+
+unsigned int Framebuffer::getHeight() { return this->resY; }
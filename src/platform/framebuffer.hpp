@@ -25,13 +25,32 @@ public:
   // @returns Returns true if the framebuffer is valid
   bool build();
 
-  // Binds the framebuffer
+  // Binds the framebuffer and sets the viewport to its render size
   void bind();
-  // Unbinds the framebuffer and binds the screen's framebuffer
+  // Unbinds the framebuffer, binds the screen's framebuffer and sets the
+  // viewport to the screen's size
   void unbind();
-  // Clears the color and depth components
+  // Clears the color, depth and stencil components
   void clear();
 
+  // Copies the first color buffer to the screen's framebuffer. The render
+  // size is stretched over the whole framebuffer's size
+  void blit();
+
+  /* Renders into only the bottom left of the framebuffer, so the resolution
+   * can change without reallocating it. The next bind uses it
+   * @param width The width in pixels. At most the framebuffer's width
+   * @param height The height in pixels. At most the framebuffer's height
+   */
+  void setRenderSize(unsigned int width, unsigned int height);
+
+  // Returns the width of the framebuffer
+  // @returns The width in pixels
+  unsigned int getWidth();
+  // Returns the height of the framebuffer
+  // @returns The height in pixels
+  unsigned int getHeight();
+
   /* Creates a framebuffer
    * @param resX The width of the framebuffer
    * @param resY The height of the framebuffer
@@ -43,6 +62,8 @@ public:
 private:
   GLuint fbo;
   GLuint rbo;
+  unsigned int resX, resY;
+  unsigned int renderX, renderY;
 
   unsigned int colorAttachments = 0;
 };
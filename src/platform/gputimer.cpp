@@ -0,0 +1,56 @@
+#include "platform/gputimer.hpp"
+
+GPUTimer::GPUTimer() {
+  glGenQueries(GPU_TIMER_FRAMES * 2, &this->queries[0][0]);
+}
+
+GPUTimer::~GPUTimer() {
+  glDeleteQueries(GPU_TIMER_FRAMES * 2, &this->queries[0][0]);
+}
+
+void GPUTimer::begin() {
+  // The slot is still in use if the GPU is more than GPU_TIMER_FRAMES
+  // measurements behind
+  if (this->pending[this->next]) {
+    this->read(this->next, true);
+  }
+
+  glQueryCounter(this->queries[this->next][0], GL_TIMESTAMP);
+}
+
+void GPUTimer::end() {
+  glQueryCounter(this->queries[this->next][1], GL_TIMESTAMP);
+
+  this->pending[this->next] = true;
+  this->next = (this->next + 1) % GPU_TIMER_FRAMES;
+}
+
+double GPUTimer::getTime() {
+  // Results finish in order, so the oldest is read first
+  while (this->pending[this->oldest] && this->read(this->oldest, false)) {
+  }
+
+  return this->time;
+}
+
+bool GPUTimer::read(size_t slot, bool wait) {
+  if (!wait) {
+    GLint available = 0;
+    glGetQueryObjectiv(this->queries[slot][1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+
+    if (!available) {
+      return false;
+    }
+  }
+
+  GLuint64 start, end;
+  glGetQueryObjectui64v(this->queries[slot][0], GL_QUERY_RESULT, &start);
+  glGetQueryObjectui64v(this->queries[slot][1], GL_QUERY_RESULT, &end);
+
+  this->time = (end - start) / 1e9;
+  this->pending[slot] = false;
+  this->oldest = (slot + 1) % GPU_TIMER_FRAMES;
+
+  return true;
+}
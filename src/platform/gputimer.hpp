@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "platform/opengl.hpp"
+
+// The number of measurements a GPUTimer can have in flight
+#define GPU_TIMER_FRAMES 4
+
+/* Measures how long the GPU takes to run the commands of a pass with
+ * timestamp queries. Results are read a few frames late, so reading them
+ * doesn't wait for the GPU
+ */
+class GPUTimer {
+private:
+  // Creates the queries
+  GPUTimer();
+
+public:
+  // Deletes the queries
+  ~GPUTimer();
+
+  // Starts timing. The commands sent until end are timed
+  void begin();
+
+  // Stops timing
+  void end();
+
+  // Returns the time of the latest finished measurement
+  // @returns The time in seconds. Zero until a measurement has finished
+  double getTime();
+
+  // Creates the queries
+  inline static auto create() {
+    return std::shared_ptr<GPUTimer>(new GPUTimer);
+  }
+
+private:
+  /* Reads the result of a measurement
+   * @param slot The measurement's queries
+   * @param wait Waits for the GPU if the result isn't ready
+   * @returns True if the result was read
+   */
+  bool read(size_t slot, bool wait);
+
+  // The start and end timestamps of each measurement
+  GLuint queries[GPU_TIMER_FRAMES][2];
+  bool pending[GPU_TIMER_FRAMES] = {};
+
+  // The slot the next measurement uses, and the oldest unread slot
+  size_t next = 0;
+  size_t oldest = 0;
+
+  double time = 0.0;
+};
@@ -0,0 +1,69 @@
+#include "platform/readback.hpp"
+
+BufferReadback::BufferReadback(size_t size) : size(size), data(size, 0) {
+  glGenBuffers(1, &this->buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, size * READBACK_FRAMES, nullptr,
+               GL_STREAM_READ);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+BufferReadback::~BufferReadback() {
+  for (GLsync fence : this->fences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+
+  glDeleteBuffers(1, &this->buffer);
+}
+
+void BufferReadback::begin() {
+  // The slot is still in use if the GPU is more than READBACK_FRAMES
+  // frames behind
+  if (this->fences[this->next]) {
+    this->read(this->next, true);
+  }
+
+  // The copies read what shaders wrote
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void BufferReadback::copy(Buffer &buffer, size_t offset, size_t size,
+                          size_t destination) {
+  glCopyNamedBufferSubData(buffer.getID(), this->buffer, offset,
+                           this->next * this->size + destination, size);
+}
+
+void BufferReadback::end() {
+  this->fences[this->next] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_ZERO);
+  this->next = (this->next + 1) % READBACK_FRAMES;
+}
+
+const void *BufferReadback::getData() {
+  // Frames finish in order, so the oldest is read first
+  while (this->fences[this->oldest] && this->read(this->oldest, false)) {
+  }
+
+  return this->data.data();
+}
+
+bool BufferReadback::read(size_t slot, bool wait) {
+  GLenum status = glClientWaitSync(this->fences[slot], GL_ZERO,
+                                   wait ? GL_TIMEOUT_IGNORED : 0);
+
+  if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+    return false;
+  }
+
+  // The copies are done, so this doesn't wait
+  glGetNamedBufferSubData(this->buffer, slot * this->size, this->size,
+                          this->data.data());
+
+  glDeleteSync(this->fences[slot]);
+  this->fences[slot] = nullptr;
+  this->oldest = (slot + 1) % READBACK_FRAMES;
+
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "platform/buffer.hpp"
+#include "platform/opengl.hpp"
+
+// The number of frames a BufferReadback can have in flight
+#define READBACK_FRAMES 4
+
+/* Reads small parts of buffers the GPU writes, like counters, a few frames
+ * late so reading them doesn't wait for the GPU. Each frame copies the
+ * parts into its own slot of a staging buffer and sets a fence, and the
+ * newest slot whose fence has passed is read
+ */
+class BufferReadback {
+private:
+  // Creates the staging buffer
+  // @param size The bytes copied each frame
+  BufferReadback(size_t size);
+
+public:
+  // Deletes the staging buffer and fences
+  ~BufferReadback();
+
+  // Starts a frame's copies. Waits for the GPU if every slot is in flight
+  void begin();
+
+  /* Copies part of a buffer into the frame's slot. Shader writes before
+   * begin are included
+   * @param buffer The buffer to copy from
+   * @param offset The first byte to copy
+   * @param size The number of bytes to copy
+   * @param destination Where the bytes go in the slot
+   */
+  void copy(Buffer &buffer, size_t offset, size_t size, size_t destination);
+
+  // Ends the frame's copies
+  void end();
+
+  // Returns the bytes of the latest finished frame
+  // @returns The bytes. Zero until a frame has finished
+  const void *getData();
+
+  // Creates the staging buffer
+  // @param size The bytes copied each frame
+  inline static auto create(size_t size) {
+    return std::shared_ptr<BufferReadback>(new BufferReadback{size});
+  }
+
+private:
+  /* Reads the bytes of a frame
+   * @param slot The frame's slot
+   * @param wait Waits for the GPU if the copies aren't done
+   * @returns True if the bytes were read
+   */
+  bool read(size_t slot, bool wait);
+
+  GLuint buffer;
+  size_t size;
+
+  // The fence after each slot's copies, or nullptr if it was read
+  GLsync fences[READBACK_FRAMES] = {};
+
+  // The slot the next frame uses, and the oldest unread slot
+  size_t next = 0;
+  size_t oldest = 0;
+
+  std::vector<uint8_t> data;
+};
@@ -104,6 +104,14 @@ void Shader::setUniformFloat(const string &name, float value) {
   }
 }
 
+void Shader::setUniformVec2(const string &name, const glm::vec2 value) {
+  GLint uniform = this->getUniformLocation(name);
+
+  if (uniform != -1) {
+    glUniform2f(uniform, value.x, value.y);
+  }
+}
+
 void Shader::setUniformVec3(const string &name, const glm::vec3 value) {
   GLint uniform = this->getUniformLocation(name);
 
@@ -120,11 +128,13 @@ void Shader::setUniformVec4(const string &name, const glm::vec4 value) {
   }
 }
 
-std::shared_ptr<Shader> Shader::CreateDefault(const string &vertex, const string &fragment) {
+std::shared_ptr<Shader> Shader::CreateDefault(const string &vertex,
+                                              const string &fragment,
+                                              const vector<string> &defines) {
   auto shader = std::shared_ptr<Shader>(new Shader);
 
-  shader->attachSource(vertex, GL_VERTEX_SHADER);
-  shader->attachSource(fragment, GL_FRAGMENT_SHADER);
+  shader->attachSource(vertex, GL_VERTEX_SHADER, defines);
+  shader->attachSource(fragment, GL_FRAGMENT_SHADER, defines);
 
   if (!shader->build()) {
     critical("Could not build shader (%s, %s)\n", vertex.c_str(),
@@ -134,6 +144,19 @@ std::shared_ptr<Shader> Shader::CreateDefault(const string &vertex, const string
   return shader;
 }
 
+std::shared_ptr<Shader> Shader::CreateCompute(const string &compute,
+                                              const vector<string> &defines) {
+  auto shader = std::shared_ptr<Shader>(new Shader);
+
+  shader->attachSource(compute, GL_COMPUTE_SHADER, defines);
+
+  if (!shader->build()) {
+    critical("Could not build shader (%s)\n", compute.c_str());
+  }
+
+  return shader;
+}
+
 const string Shader::readFile(const string &path) {
   string code;
   ifstream file;
@@ -157,7 +180,8 @@ const string Shader::readFile(const string &path) {
   return code;
 }
 
-void Shader::attachSource(const string &path, GLenum type) {
+void Shader::attachSource(const string &path, GLenum type,
+                          const vector<string> &defines) {
   // Reads the file
   string code = this->readFile(path);
   const char *shaderCode;
@@ -191,6 +215,18 @@ void Shader::attachSource(const string &path, GLenum type) {
     index = code.find("#include");
   }
 
+  // Defines go after the #version line, which has to come first
+  if (!defines.empty()) {
+    string lines;
+    for (auto &define : defines) {
+      lines += "#define " + define + "\n";
+    }
+
+    size_t versionEnd = code.find('\n', code.find("#version"));
+    code.insert(versionEnd == string::npos ? code.size() : versionEnd + 1,
+                lines);
+  }
+
   // Upload file contents
   shaderCode = code.c_str();
 
@@ -243,5 +279,27 @@ bool Shader::build() {
     return false;
   }
 
+  // Record which vertex attributes the shader actually reads
+  GLint attributeCount, nameLength;
+  glGetProgramiv(this->program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+  glGetProgramiv(this->program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &nameLength);
+
+  char *name = new char[nameLength + 1];
+
+  for (GLint i = 0; i < attributeCount; i++) {
+    GLint size;
+    GLenum type;
+    glGetActiveAttrib(this->program, i, nameLength + 1, nullptr, &size, &type,
+                      name);
+
+    // Built-in attributes, such as gl_VertexID, have no location
+    GLint location = glGetAttribLocation(this->program, name);
+    if (location != -1) {
+      this->attributes |= (1ul << location);
+    }
+  }
+
+  delete[] name;
+
   return true;
 }
\ No newline at end of file
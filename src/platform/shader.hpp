@@ -6,6 +6,7 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 
 // A class to create a shader object and handle
 // shader data
@@ -81,6 +82,11 @@ public:
    * @param value The float to upload
    */
   void setUniformFloat(const std::string &name, float value);
+  /* Uploads a vec2
+   * @param name The uniform name
+   * @param value The vec2 to upload
+   */
+  void setUniformVec2(const std::string &name, const glm::vec2 value);
   /* Uploads a vec3
    * @param name The uniform name
    * @param value The vec3 to upload
@@ -92,8 +98,28 @@ public:
    */
   void setUniformVec4(const std::string &name, const glm::vec4 value);
 
-  // Creates a shader program with a vertex and fragment shader attached
-  static std::shared_ptr<Shader> CreateDefault(const std::string &vertex, const std::string &fragment);
+  /* Determins if the vertex shader only reads the position attribute
+   * (location 0). Meshes can then be drawn using a position only stream
+   * @returns True if position is the only active vertex attribute
+   */
+  inline bool usesOnlyPosition() { return this->attributes == 1; }
+
+  /* Creates a shader program with a vertex and fragment shader attached
+   * @param vertex The vertex shader path
+   * @param fragment The fragment shader path
+   * @param defines Macros defined at the top of both shaders
+   */
+  static std::shared_ptr<Shader>
+  CreateDefault(const std::string &vertex, const std::string &fragment,
+                const std::vector<std::string> &defines = {});
+
+  /* Creates a shader program with a compute shader attached
+   * @param compute The compute shader path
+   * @param defines Macros defined at the top of the shader
+   */
+  static std::shared_ptr<Shader>
+  CreateCompute(const std::string &compute,
+                const std::vector<std::string> &defines = {});
 
 protected:
   /* A helper function that reads files
@@ -104,8 +130,10 @@ protected:
   /* Uploads the contents of the given file as a shader
    * @param path The path of the file to upload
    * @param type The shader type to use the file as
+   * @param defines Macros defined after the #version line
    */
-  void attachSource(const std::string &path, GLenum type);
+  void attachSource(const std::string &path, GLenum type,
+                    const std::vector<std::string> &defines = {});
 
   // Links the the shader
   // @returns Returns true if the shader links successfuly
@@ -115,4 +143,8 @@ protected:
 
 private:
   std::map<std::string, GLint> uniformLocations;
+
+  // Each bit represents an active vertex attribute location. For example,
+  // bit 0 is location 0 and bit 1 is location 1
+  unsigned long attributes = 0;
 };
\ No newline at end of file
@@ -1,87 +1,259 @@
 #include "platform/texture.hpp"
+#include "platform/texturearray.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.hpp>
 
+// Textures are decoded on pool threads, so the flip flag and the failure
+// reason must be per thread
+#ifndef STBI_THREAD_LOCAL
+#error "stb_image needs thread locals to decode on several threads"
+#endif
+
 #include "helper/log.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <tuple>
+
 using namespace std;
 
-Texture::Texture(const string &path) {
-  // Creates a texture object
+bool TextureSampling::operator<(const TextureSampling &other) const {
+  return tie(this->wrap, this->minFilter, this->magFilter, this->anisotropic) <
+         tie(other.wrap, other.minFilter, other.magFilter, other.anisotropic);
+}
+
+vector<unsigned char> Texture::read(const string &path) {
+  ifstream file(path, ios::binary | ios::ate);
+
+  if (!file) {
+    critical("Unknown path: %s\n", path.c_str());
+  }
+
+  // Read the whole file
+  vector<unsigned char> contents((size_t)file.tellg());
+  file.seekg(0);
+  file.read((char *)contents.data(), contents.size());
+
+  return contents;
+}
+
+shared_ptr<TextureData> Texture::decode(const string &path) {
+  return decode(path, read(path));
+}
+
+shared_ptr<TextureData> Texture::decode(const string &path,
+                                        const vector<unsigned char> &file) {
   info("Loading texture: %s\n", path.c_str());
-  glGenTextures(1, &this->id);
-  glBindTexture(GL_TEXTURE_2D, this->id);
+
+  auto texture = make_shared<TextureData>();
+  texture->path = path;
 
   // Load data
-  stbi_set_flip_vertically_on_load(true);
-  int width, height, nrChannels;
-  unsigned char *data =
-      stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+  stbi_set_flip_vertically_on_load_thread(true);
+  unsigned char *data = stbi_load_from_memory(
+      file.data(), (int)file.size(), &texture->width, &texture->height,
+      &texture->channels, 0);
 
   if (data == nullptr) {
-    critical("Unknown path: %s\n", path.c_str());
+    critical("Could not decode texture %s: %s\n", path.c_str(),
+             stbi_failure_reason());
   }
 
-  // Uploads the texture data
-  switch (nrChannels) {
-  case 1: // BW image
-  {
-    GLint swizzleMask[] = {GL_RED, GL_RED, GL_RED, GL_RED};
-    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+  texture->pixels.assign(data, data + (size_t)texture->width *
+                                          texture->height * texture->channels);
+
+  stbi_image_free(data);
+
+  return texture;
+}
+
+void Texture::generateMipmaps(TextureData &data, TextureUsage usage) {
+  data.mipmaps = generateMipChain(data.pixels.data(), data.width,
+                                  data.height, data.channels,
+                                  getMipSettings(usage));
+}
+
+MipSettings Texture::getMipSettings(TextureUsage usage) {
+  MipSettings settings;
+
+  if (usage == TextureUsage::Alpha) {
+    settings.srgb = false;
+    settings.coverageChannel = 0;
+    settings.coverageCutoff = TEXTURE_ALPHA_CUTOFF;
   }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED,
-                 GL_UNSIGNED_BYTE, data);
+
+  return settings;
+}
+
+Texture::Texture(const TextureData &texture, const TextureSampling &sampling) {
+  // Creates a texture object
+  glGenTextures(1, &this->id);
+  glBindTexture(GL_TEXTURE_2D, this->id);
+
+  int width = texture.width;
+  int height = texture.height;
+  const unsigned char *data = texture.pixels.data();
+
+  // Rows are tightly packed
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  // Uploads the texture data. critical exits, so the default is never used
+  GLenum format = GL_RGBA;
+
+  switch (texture.channels) {
+  case 1: // BW image
+    format = GL_RED;
     break;
   case 2: // RG image
-  {
-    GLint swizzleMask[] = {GL_RED, GL_GREEN, GL_GREEN, GL_GREEN};
-    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
-  }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG, width, height, 0, GL_RG,
-                 GL_UNSIGNED_BYTE, data);
+    format = GL_RG;
     break;
   case 3: // RGB image
-  {
-    GLint swizzleMask[] = {GL_RED, GL_GREEN, GL_BLUE, GL_BLUE};
-    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
-  }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, data);
+    format = GL_RGB;
     break;
   case 4: // RGBA image
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, data);
+    format = GL_RGBA;
     break;
   default: // Unknown image
-    critical("Unknown image channel for %s: %i\n", path.c_str(), nrChannels);
+    critical("Unknown image channel for %s: %i\n", texture.path.c_str(),
+             texture.channels);
     break;
   }
 
-  stbi_image_free(data);
+  setSwizzle(GL_TEXTURE_2D, texture.channels);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+               GL_UNSIGNED_BYTE, data);
+
+  if (texture.mipmaps.empty()) {
+    // The mipmaps add a third of the base level
+    this->bytes = texture.pixels.size() * 4 / 3;
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+  } else {
+    this->bytes = texture.pixels.size();
+
+    // Upload the mipmaps generated on the CPU
+    for (size_t i = 0; i < texture.mipmaps.size(); i++) {
+      auto &level = texture.mipmaps[i];
+
+      glTexImage2D(GL_TEXTURE_2D, (GLint)i + 1, format, level.width,
+                   level.height, 0, format, GL_UNSIGNED_BYTE,
+                   level.pixels.data());
+
+      this->bytes += level.pixels.size();
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    (GLint)texture.mipmaps.size());
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
   // Set the texture's parameters
-  glGenerateMipmap(GL_TEXTURE_2D);
+  setSampling(GL_TEXTURE_2D, sampling);
+}
+
+Texture::Texture(const TextureFile &file, const TextureSampling &sampling) {
+  // Creates a texture object
+  glGenTextures(1, &this->id);
+  glBindTexture(GL_TEXTURE_2D, this->id);
+
+  GLenum format = file.getFormat();
+  unsigned int levels = file.getLevels();
+
+  setSwizzle(GL_TEXTURE_2D, file.getChannels());
+
+  // Uploads every mip level
+  this->bytes = 0;
+
+  for (unsigned int level = 0; level < levels; level++) {
+    size_t size;
+    const unsigned char *data = file.getLevel(level, size);
+
+    GLsizei width = max(file.getWidth() >> level, 1u);
+    GLsizei height = max(file.getHeight() >> level, 1u);
+
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0,
+                           (GLsizei)size, data);
+
+    this->bytes += size;
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+  setSampling(GL_TEXTURE_2D, sampling);
+}
+
+void Texture::setSwizzle(GLenum target, int channels) {
+  // Fill in the channels the image does not have
+  switch (channels) {
+  case 1: {
+    GLint swizzleMask[] = {GL_RED, GL_RED, GL_RED, GL_RED};
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+  } break;
+  case 2: {
+    GLint swizzleMask[] = {GL_RED, GL_GREEN, GL_GREEN, GL_GREEN};
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+  } break;
+  case 3: {
+    GLint swizzleMask[] = {GL_RED, GL_GREEN, GL_BLUE, GL_BLUE};
+    glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+  } break;
+  default:
+    break;
+  }
+}
+
+void Texture::setSampling(GLenum target, const TextureSampling &sampling) {
+  if (sampling.anisotropic) {
+    float aniso = 0.0f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &aniso);
+    glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY, aniso);
+  }
+
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, sampling.wrap);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, sampling.wrap);
 
-  float aniso = 0.0f;
-  glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &aniso);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, aniso);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+}
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+Texture::Texture(shared_ptr<TextureArray> array, unsigned int layer) {
+  this->array = array;
+  this->layer = layer;
+  this->bytes = array->getLayerBytes();
+}
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                  GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+Texture::~Texture() {
+  if (this->array) {
+    this->array->release(this->layer);
+  } else {
+    glDeleteTextures(1, &this->id);
+  }
 }
 
-Texture::~Texture() { glDeleteTextures(1, &this->id); }
+size_t Texture::getBytes() { return this->bytes; }
 
 void Texture::bind(unsigned int index) {
+  if (this->array) {
+    this->array->bind(index);
+    return;
+  }
+
   glActiveTexture(GL_TEXTURE0 + index);
   glBindTexture(GL_TEXTURE_2D, this->id);
 }
 
+GLuint Texture::getID() {
+  return this->array ? this->array->getID() : this->id;
+}
+
+shared_ptr<TextureArray> Texture::getArray() { return this->array; }
+
+unsigned int Texture::getLayer() { return this->layer; }
+
 TextureRender::TextureRender(unsigned int resX, unsigned int resY,
                              GLenum format) {
   // Create a texture object
@@ -94,6 +266,15 @@ TextureRender::TextureRender(unsigned int resX, unsigned int resY,
 
   glTexImage2D(GL_TEXTURE_2D, 0, format, resX, resY, 0, GL_RGBA,
                GL_UNSIGNED_BYTE, nullptr);
+
+  // There are no mipmaps. Without this the texture is incomplete, and
+  // image units treat it as unbound
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  this->format = format;
+  this->resX = resX;
+  this->resY = resY;
 }
 
 TextureRender::~TextureRender() { glDeleteTextures(1, &this->id); }
@@ -103,4 +284,12 @@ void TextureRender::bind(unsigned int index) {
   glBindTexture(GL_TEXTURE_2D, this->id);
 }
 
+void TextureRender::bindImage(unsigned int index, GLenum access) {
+  glBindImageTexture(index, this->id, 0, GL_FALSE, 0, access, this->format);
+}
+
+unsigned int TextureRender::getWidth() { return this->resX; }
+
+unsigned int TextureRender::getHeight() { return this->resY; }
+
 GLuint TextureRender::getID() { return this->id; }
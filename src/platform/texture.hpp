@@ -2,31 +2,183 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
+#include "helper/mipmap.hpp"
 #include "platform/opengl.hpp"
+#include "platform/texturefile.hpp"
 #include <stb_image.hpp>
 
-// A class to upload texture data
+// The alpha test reference value of the opaque pass (see solid/shader.frag)
+#define TEXTURE_ALPHA_CUTOFF 0.9f
+
+// What a texture is used for. This decides how its mipmaps are filtered
+enum class TextureUsage {
+  // Colors, averaged in linear space
+  Color,
+
+  // An alpha tested mask. Only the first channel is read, and its mipmaps
+  // keep the alpha test coverage of the base level
+  Alpha
+};
+
+// Decoded texture data that has not been uploaded to the GPU yet
+struct TextureData {
+  std::string path;
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+
+  // Tightly packed pixels, bottom row first
+  std::vector<unsigned char> pixels;
+
+  // The mip levels below the base, largest first. If it is empty, OpenGL
+  // generates the mipmaps
+  std::vector<MipLevel> mipmaps;
+};
+
+// How a texture is sampled
+struct TextureSampling {
+  GLenum wrap = GL_REPEAT;
+  GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLenum magFilter = GL_LINEAR;
+
+  // Uses the maximum anisotropy supported
+  bool anisotropic = true;
+
+  // Allows TextureSampling to be used as a key
+  bool operator<(const TextureSampling &other) const;
+};
+
+class TextureArray;
+
+/* A class to upload texture data. A texture is either a texture object of
+ * its own or a layer of a TextureArray
+ */
 class Texture {
 private:
-  // Read texture data from a file and uploads it to the GPU
-  // @param path The path of the texture file
-  Texture(const std::string &path);
+  /* Uploads decoded texture data to the GPU
+   * @param data The decoded texture data
+   * @param sampling How the texture is sampled
+   */
+  Texture(const TextureData &data, const TextureSampling &sampling);
+
+  /* Uploads a baked texture container to the GPU. Every mip level is
+   * uploaded as is
+   * @param file The baked texture container
+   * @param sampling How the texture is sampled
+   */
+  Texture(const TextureFile &file, const TextureSampling &sampling);
+
+  /* Holds a layer of a texture array. The layer is given back when the
+   * texture is freed
+   * @param array The texture array
+   * @param layer The layer
+   */
+  Texture(std::shared_ptr<TextureArray> array, unsigned int layer);
 
 public:
   ~Texture();
 
-  // Binds the texture to a texture unit
+  // Binds the texture, or its texture array, to a texture unit
   void bind(unsigned int index);
 
+  // Returns the ID of the texture, or of its texture array
+  // @returns The texture ID
+  GLuint getID();
+
+  // Returns the texture array the texture is a layer of
+  // @returns The texture array, or nullptr if it is a texture of its own
+  std::shared_ptr<TextureArray> getArray();
+
+  // Returns the layer of the texture array the texture is in
+  // @returns The layer
+  unsigned int getLayer();
+
+  // Returns the GPU memory used by the texture, including mipmaps
+  // @returns The GPU memory used in bytes
+  size_t getBytes();
+
+  // The functions below run on TextureQueue's worker threads, so they must
+  // not use OpenGL
+
+  /* Reads a file without decoding it
+   * @param path The path of the texture file
+   * @returns The contents of the file
+   */
+  static std::vector<unsigned char> read(const std::string &path);
+
+  /* Reads and decodes a texture file
+   * @param path The path of the texture file
+   * @returns The decoded texture data
+   */
+  static std::shared_ptr<TextureData> decode(const std::string &path);
+
+  /* Decodes a texture file that has already been read
+   * @param path The path of the texture file. Used for error messages
+   * @param file The contents of the texture file
+   * @returns The decoded texture data
+   */
+  static std::shared_ptr<TextureData>
+  decode(const std::string &path, const std::vector<unsigned char> &file);
+
+  /* Generates the mipmaps of decoded texture data on the CPU
+   * @param data The decoded texture data
+   * @param usage What the texture is used for
+   */
+  static void generateMipmaps(TextureData &data, TextureUsage usage);
+
+  /* Returns how the mipmaps of a texture are generated
+   * @param usage What the texture is used for
+   * @returns The mipmap settings
+   */
+  static MipSettings getMipSettings(TextureUsage usage);
+
+  /* Uploads decoded texture data to the GPU
+   * @param data The decoded texture data
+   * @param sampling How the texture is sampled
+   */
+  inline static auto create(const TextureData &data,
+                            const TextureSampling &sampling = {}) {
+    return std::shared_ptr<Texture>(new Texture(data, sampling));
+  }
+
+  /* Uploads a baked texture container to the GPU
+   * @param file The baked texture container
+   * @param sampling How the texture is sampled
+   */
+  inline static auto create(const TextureFile &file,
+                            const TextureSampling &sampling = {}) {
+    return std::shared_ptr<Texture>(new Texture(file, sampling));
+  }
+
   // Read texture data from a file and uploads it to the GPU
   // @param path The path of the texture file
   inline static auto create(const std::string &path) {
-    return std::shared_ptr<Texture>(new Texture(path));
+    return create(*decode(path));
   }
 
 private:
-  GLuint id;
+  friend class TextureArray;
+  friend class TextureBuckets;
+
+  /* Sets the swizzle of the bound texture for the number of channels
+   * @param target The target the texture is bound to
+   * @param channels The number of channels in the image
+   */
+  static void setSwizzle(GLenum target, int channels);
+  /* Sets the sampling parameters of the bound texture
+   * @param target The target the texture is bound to
+   * @param sampling How the texture is sampled
+   */
+  static void setSampling(GLenum target, const TextureSampling &sampling);
+
+  GLuint id = 0;
+  size_t bytes;
+
+  std::shared_ptr<TextureArray> array = nullptr;
+  unsigned int layer = 0;
 };
 
 // A class to handle textures that hold render data
@@ -44,6 +196,21 @@ public:
 
   // Binds the texture to a texture unit
   void bind(unsigned int index);
+
+  /* Binds the texture to an image unit, so compute shaders can load and
+   * store its pixels
+   * @param index The image unit
+   * @param access GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+   */
+  void bindImage(unsigned int index, GLenum access);
+
+  // Returns the width of the texture
+  // @returns The width in pixels
+  unsigned int getWidth();
+  // Returns the height of the texture
+  // @returns The height in pixels
+  unsigned int getHeight();
+
   // Returns the texture ID
   // @returns Returns the texture ID
   GLuint getID();
@@ -59,4 +226,6 @@ public:
 
 private:
   GLuint id;
+  GLenum format;
+  unsigned int resX, resY;
 };
@@ -0,0 +1,242 @@
+#include "platform/texturearray.hpp"
+
+#include "helper/log.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace std;
+
+// Returns the pixel format of uncompressed data with a number of channels
+static GLenum getDataFormat(int channels) {
+  switch (channels) {
+  case 1:
+    return GL_RED;
+  case 2:
+    return GL_RG;
+  case 3:
+    return GL_RGB;
+  default:
+    return GL_RGBA;
+  }
+}
+
+// Returns the sized internal format for a number of channels
+static GLenum getInternalFormat(int channels) {
+  switch (channels) {
+  case 1:
+    return GL_R8;
+  case 2:
+    return GL_RG8;
+  case 3:
+    return GL_RGB8;
+  default:
+    return GL_RGBA8;
+  }
+}
+
+// Returns the number of bytes of one level of a layer
+static size_t getLevelBytes(const TextureArrayFormat &format, int level) {
+  size_t width = max(format.width >> level, 1);
+  size_t height = max(format.height >> level, 1);
+
+  switch (format.internalFormat) {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RED_RGTC1:
+    return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_RG_RGTC2:
+    return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+  default:
+    return width * height * format.channels;
+  }
+}
+
+bool TextureArrayFormat::operator<(const TextureArrayFormat &other) const {
+  return tie(this->width, this->height, this->internalFormat, this->channels,
+             this->levels, this->sampling) <
+         tie(other.width, other.height, other.internalFormat, other.channels,
+             other.levels, other.sampling);
+}
+
+TextureArray::TextureArray(const TextureArrayFormat &format,
+                           unsigned int capacity) {
+  this->format = format;
+
+  for (int level = 0; level < format.levels; level++) {
+    this->layerBytes += getLevelBytes(format, level);
+  }
+
+  this->resize(max(capacity, 1u));
+}
+
+TextureArray::~TextureArray() { glDeleteTextures(1, &this->id); }
+
+void TextureArray::bind(unsigned int index) {
+  glActiveTexture(GL_TEXTURE0 + index);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, this->id);
+}
+
+GLuint TextureArray::getID() { return this->id; }
+
+const TextureArrayFormat &TextureArray::getFormat() { return this->format; }
+
+unsigned int TextureArray::getLayers() {
+  return this->used - (unsigned int)this->freeLayers.size();
+}
+
+size_t TextureArray::getLayerBytes() { return this->layerBytes; }
+
+unsigned int TextureArray::allocate() {
+  if (!this->freeLayers.empty()) {
+    unsigned int layer = this->freeLayers.back();
+    this->freeLayers.pop_back();
+    return layer;
+  }
+
+  // Double the array so that growing is rare
+  if (this->used == this->capacity) {
+    this->resize(this->capacity * 2);
+  }
+
+  return this->used++;
+}
+
+void TextureArray::release(unsigned int layer) {
+  this->freeLayers.push_back(layer);
+}
+
+void TextureArray::upload(unsigned int layer, const TextureData &data) {
+  glBindTexture(GL_TEXTURE_2D_ARRAY, this->id);
+
+  // Rows are tightly packed
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  GLenum format = getDataFormat(data.channels);
+
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, data.width,
+                  data.height, 1, format, GL_UNSIGNED_BYTE,
+                  data.pixels.data());
+
+  for (size_t i = 0; i < data.mipmaps.size(); i++) {
+    auto &level = data.mipmaps[i];
+
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i + 1, 0, 0, layer,
+                    level.width, level.height, 1, format, GL_UNSIGNED_BYTE,
+                    level.pixels.data());
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureArray::upload(unsigned int layer, const TextureFile &file) {
+  glBindTexture(GL_TEXTURE_2D_ARRAY, this->id);
+
+  for (unsigned int level = 0; level < file.getLevels(); level++) {
+    size_t size;
+    const unsigned char *data = file.getLevel(level, size);
+
+    GLsizei width = max(file.getWidth() >> level, 1u);
+    GLsizei height = max(file.getHeight() >> level, 1u);
+
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width,
+                              height, 1, this->format.internalFormat,
+                              (GLsizei)size, data);
+  }
+}
+
+void TextureArray::resize(unsigned int capacity) {
+  GLuint old = this->id;
+
+  // Immutable storage, so the copy below always matches in size
+  glGenTextures(1, &this->id);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, this->id);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, this->format.levels,
+                 this->format.internalFormat, this->format.width,
+                 this->format.height, capacity);
+
+  Texture::setSwizzle(GL_TEXTURE_2D_ARRAY, this->format.channels);
+  Texture::setSampling(GL_TEXTURE_2D_ARRAY, this->format.sampling);
+
+  if (old != 0) {
+    if (this->used > 0) {
+      for (int level = 0; level < this->format.levels; level++) {
+        glCopyImageSubData(old, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, this->id,
+                           GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                           max(this->format.width >> level, 1),
+                           max(this->format.height >> level, 1), this->used);
+      }
+    }
+
+    glDeleteTextures(1, &old);
+
+    info("Texture array %dx%d grew to %u layers\n", this->format.width,
+         this->format.height, capacity);
+  }
+
+  this->capacity = capacity;
+}
+
+TextureBuckets::TextureBuckets() {}
+
+shared_ptr<Texture> TextureBuckets::upload(const TextureData &data,
+                                           const TextureSampling &sampling) {
+  // Every layer of an array has the same number of levels, so the
+  // mipmaps have to be generated on the CPU
+  bool single = data.width == 1 && data.height == 1;
+  if (data.mipmaps.empty() && !single) {
+    return nullptr;
+  }
+
+  TextureArrayFormat format;
+  format.width = data.width;
+  format.height = data.height;
+  format.internalFormat = getInternalFormat(data.channels);
+  format.channels = data.channels;
+  format.levels = (int)data.mipmaps.size() + 1;
+  format.sampling = sampling;
+
+  auto texture = this->allocate(format);
+  texture->array->upload(texture->layer, data);
+
+  return texture;
+}
+
+shared_ptr<Texture> TextureBuckets::upload(const TextureFile &file,
+                                           const TextureSampling &sampling) {
+  TextureArrayFormat format;
+  format.width = file.getWidth();
+  format.height = file.getHeight();
+  format.internalFormat = file.getFormat();
+  format.channels = file.getChannels();
+  format.levels = file.getLevels();
+  format.sampling = sampling;
+
+  auto texture = this->allocate(format);
+  texture->array->upload(texture->layer, file);
+
+  return texture;
+}
+
+size_t TextureBuckets::getCount() { return this->arrays.size(); }
+
+size_t TextureBuckets::getLayers() {
+  size_t layers = 0;
+
+  for (auto &[format, array] : this->arrays) {
+    layers += array->getLayers();
+  }
+
+  return layers;
+}
+
+shared_ptr<Texture> TextureBuckets::allocate(const TextureArrayFormat &format) {
+  auto &array = this->arrays[format];
+
+  if (!array) {
+    array = TextureArray::create(format);
+  }
+
+  unsigned int layer = array->allocate();
+  return shared_ptr<Texture>(new Texture(array, layer));
+}
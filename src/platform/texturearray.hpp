@@ -0,0 +1,160 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "platform/opengl.hpp"
+#include "platform/texture.hpp"
+
+// The layout of the layers in a texture array. Textures are only put in
+// the same array if their formats match
+struct TextureArrayFormat {
+  int width;
+  int height;
+
+  // The sized internal format, or the compressed format
+  GLenum internalFormat;
+  int channels;
+  int levels;
+
+  TextureSampling sampling;
+
+  // Allows TextureArrayFormat to be used as a key
+  bool operator<(const TextureArrayFormat &other) const;
+};
+
+/* A GL_TEXTURE_2D_ARRAY that holds textures of one format. Each texture
+ * is a layer, and the array grows when it runs out of layers. Layers are
+ * handed out as Texture objects, which give their layer back when they
+ * are freed
+ */
+class TextureArray {
+private:
+  /* Creates an empty texture array
+   * @param format The format of every layer
+   * @param capacity The number of layers to allocate
+   */
+  TextureArray(const TextureArrayFormat &format, unsigned int capacity);
+
+public:
+  ~TextureArray();
+
+  // Binds the texture array to a texture unit
+  void bind(unsigned int index);
+
+  // Returns the texture ID. It changes when the array grows
+  // @returns The texture ID
+  GLuint getID();
+
+  // Returns the format of the layers
+  // @returns The format of the layers
+  const TextureArrayFormat &getFormat();
+
+  // Returns the number of layers holding a texture
+  // @returns The number of layers in use
+  unsigned int getLayers();
+
+  // Returns the GPU memory of one layer, including mipmaps
+  // @returns The GPU memory of a layer in bytes
+  size_t getLayerBytes();
+
+  /* Creates an empty texture array
+   * @param format The format of every layer
+   * @param capacity The number of layers to allocate
+   */
+  inline static auto create(const TextureArrayFormat &format,
+                            unsigned int capacity = 4) {
+    return std::shared_ptr<TextureArray>(new TextureArray{format, capacity});
+  }
+
+private:
+  friend class Texture;
+  friend class TextureBuckets;
+
+  // Returns a free layer, growing the array if there is none
+  // @returns The layer
+  unsigned int allocate();
+
+  // Gives a layer back to the array
+  // @param layer The layer
+  void release(unsigned int layer);
+
+  /* Uploads decoded texture data and its mipmaps to a layer
+   * @param layer The layer
+   * @param data The decoded texture data
+   */
+  void upload(unsigned int layer, const TextureData &data);
+
+  /* Uploads every level of a baked texture container to a layer
+   * @param layer The layer
+   * @param file The baked texture container
+   */
+  void upload(unsigned int layer, const TextureFile &file);
+
+  /* Allocates the storage of the array and copies over the layers of the
+   * old storage, if there was one
+   * @param capacity The number of layers to allocate
+   */
+  void resize(unsigned int capacity);
+
+  GLuint id = 0;
+  TextureArrayFormat format;
+
+  unsigned int capacity = 0;
+  unsigned int used = 0;
+
+  // Layers below used that were freed
+  std::vector<unsigned int> freeLayers;
+
+  size_t layerBytes = 0;
+};
+
+/* Packs textures into texture arrays bucketed by size and format. Draws
+ * that use textures from the same buckets don't need to bind textures
+ * between them, only change the layers they read. Must only be used from
+ * the OpenGL thread
+ */
+class TextureBuckets {
+private:
+  TextureBuckets();
+
+public:
+  /* Uploads decoded texture data to a layer of its bucket
+   * @param data The decoded texture data. Must have its mipmaps
+   * @param sampling How the texture is sampled
+   * @returns The texture, or nullptr if the data can't be put in an array
+   */
+  std::shared_ptr<Texture> upload(const TextureData &data,
+                                  const TextureSampling &sampling = {});
+
+  /* Uploads a baked texture container to a layer of its bucket
+   * @param file The baked texture container
+   * @param sampling How the texture is sampled
+   * @returns The texture
+   */
+  std::shared_ptr<Texture> upload(const TextureFile &file,
+                                  const TextureSampling &sampling = {});
+
+  // Returns the number of texture arrays
+  // @returns The number of texture arrays
+  size_t getCount();
+
+  // Returns the number of layers in use over every texture array
+  // @returns The number of layers in use
+  size_t getLayers();
+
+  inline static auto create() {
+    return std::shared_ptr<TextureBuckets>(new TextureBuckets);
+  }
+
+private:
+  /* Returns a layer of the bucket of a format, creating the bucket if it
+   * does not exist yet
+   * @param format The format of the texture
+   * @returns The texture of the layer. Nothing is uploaded to it yet
+   */
+  std::shared_ptr<Texture> allocate(const TextureArrayFormat &format);
+
+  std::map<TextureArrayFormat, std::shared_ptr<TextureArray>> arrays;
+};
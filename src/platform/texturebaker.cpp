@@ -0,0 +1,143 @@
+#include "platform/texturebaker.hpp"
+
+#include "helper/blockcompress.hpp"
+#include "helper/log.hpp"
+#include "helper/threadpool.hpp"
+#include "rendering/model.hpp"
+
+#include <atomic>
+#include <filesystem>
+
+using namespace std;
+
+// Copies one channel of an image
+static TextureData extractChannel(const TextureData &image, int channel) {
+  TextureData single;
+  single.path = image.path;
+  single.width = image.width;
+  single.height = image.height;
+  single.channels = 1;
+  single.pixels.resize((size_t)image.width * image.height);
+
+  for (size_t i = 0; i < single.pixels.size(); i++) {
+    single.pixels[i] = image.pixels[i * image.channels + channel];
+  }
+
+  return single;
+}
+
+string TextureBaker::getBakedPath(const string &path) { return path + ".oitx"; }
+
+shared_ptr<TextureFile> TextureBaker::findBaked(const string &path) {
+  string baked = getBakedPath(path);
+
+  // A container older than its source image is stale
+  error_code error;
+  auto bakedTime = filesystem::last_write_time(baked, error);
+  if (error) {
+    return nullptr;
+  }
+
+  auto sourceTime = filesystem::last_write_time(path, error);
+  if (!error && sourceTime > bakedTime) {
+    return nullptr;
+  }
+
+  auto file = TextureFile::create(baked);
+  if (!file->isValid()) {
+    return nullptr;
+  }
+
+  return file;
+}
+
+bool TextureBaker::bake(const string &path, TextureUsage usage) {
+  auto decoded = Texture::decode(path);
+  TextureData image = move(*decoded);
+
+  BlockFormat format;
+  GLenum glFormat;
+
+  if (usage == TextureUsage::Alpha && image.channels != 1) {
+    // The shaders only read the first channel of alpha maps
+    image = extractChannel(image, 0);
+  }
+
+  switch (image.channels) {
+  case 1:
+    format = BlockFormat::BC4;
+    glFormat = GL_COMPRESSED_RED_RGTC1;
+    break;
+  case 2:
+    format = BlockFormat::BC5;
+    glFormat = GL_COMPRESSED_RG_RGTC2;
+    break;
+  case 3:
+    format = BlockFormat::BC1;
+    glFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    break;
+  default: {
+    // Images with an unused alpha channel don't need BC3
+    bool opaque = true;
+    for (size_t i = 3; i < image.pixels.size() && opaque; i += 4) {
+      opaque = image.pixels[i] == 255;
+    }
+
+    if (opaque) {
+      format = BlockFormat::BC1;
+      glFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    } else {
+      format = BlockFormat::BC3;
+      glFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+  } break;
+  }
+
+  // Compress every mip level
+  vector<vector<unsigned char>> levels;
+
+  levels.push_back(compressImage(image.pixels.data(), image.width,
+                                 image.height, image.channels, format));
+
+  auto decompressed = decompressImage(levels[0].data(), image.width,
+                                      image.height, image.channels, format);
+  double psnr = calculatePSNR(image.pixels.data(), decompressed.data(),
+                              image.pixels.size());
+
+  for (auto &level : generateMipChain(image.pixels.data(), image.width,
+                                      image.height, image.channels,
+                                      Texture::getMipSettings(usage))) {
+    levels.push_back(compressImage(level.pixels.data(), level.width,
+                                   level.height, image.channels, format));
+  }
+
+  info("Baked %s: %dx%d, %zu levels, PSNR %.2f dB\n", path.c_str(),
+       image.width, image.height, levels.size(), psnr);
+
+  if (!TextureFile::write(getBakedPath(path), glFormat, image.channels,
+                          image.width, image.height, levels)) {
+    info("Could not write %s\n", getBakedPath(path).c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool TextureBaker::bakeModel(const string &path, const string &base) {
+  auto pool = ThreadPool::create();
+  auto data = Model::parse(path, base, pool.get());
+
+  atomic<bool> success{true};
+
+  for (auto &[texture, usage] : data->getTextures()) {
+    pool->submit([&success, texture = texture, usage = usage] {
+      if (!TextureBaker::bake(texture, usage)) {
+        success = false;
+      }
+    });
+  }
+
+  pool->wait();
+
+  return success;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "platform/texture.hpp"
+#include "platform/texturefile.hpp"
+
+/* Bakes textures into block compressed containers with every mip level
+ * precomputed (see generateMipChain). Baking is done offline (see --bake-textures), and the
+ * loaders use a baked container instead of the source image when it is
+ * up to date
+ *
+ * Formats:
+ *   Alpha maps               BC4 (first channel)
+ *   Single channel images    BC4
+ *   Two channel images       BC5
+ *   RGB images               BC1
+ *   RGBA images              BC3, or BC1 if every pixel is opaque
+ */
+class TextureBaker {
+public:
+  /* Returns the path of the baked container of a texture
+   * @param path The path of the source image
+   * @returns The path of the baked container
+   */
+  static std::string getBakedPath(const std::string &path);
+
+  /* Opens the baked container of a texture. Can be called from any thread
+   * @param path The path of the source image
+   * @returns The container, or nullptr if it is missing, invalid or older
+   * than the source image
+   */
+  static std::shared_ptr<TextureFile> findBaked(const std::string &path);
+
+  /* Bakes a texture and writes its container. Can be called from any
+   * thread
+   * @param path The path of the source image
+   * @param usage What the texture is used for
+   * @returns True if the container was written
+   */
+  static bool bake(const std::string &path, TextureUsage usage);
+
+  /* Bakes every texture used by a model's materials
+   * @param path The model file path
+   * @param base The base folder to use when looking for the material file
+   * @returns True if every texture was baked
+   */
+  static bool bakeModel(const std::string &path, const std::string &base);
+};
@@ -0,0 +1,112 @@
+#include "platform/texturecache.hpp"
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+using namespace std;
+
+// The cache is shared by every thread
+static mutex cacheLock;
+static map<TextureCache::Key, weak_ptr<Texture>> cache;
+static size_t cacheHits = 0;
+
+// Removes the textures that have been freed. cacheLock must be held
+static void pruneCache() {
+  for (auto it = cache.begin(); it != cache.end();) {
+    if (it->second.expired()) {
+      it = cache.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+bool TextureCache::Key::operator<(const Key &other) const {
+  return tie(this->hash, this->path, this->sampling, this->usage) <
+         tie(other.hash, other.path, other.sampling, other.usage);
+}
+
+TextureCache::Key TextureCache::makeKey(const string &path,
+                                        const unsigned char *file, size_t size,
+                                        const TextureSampling &sampling,
+                                        TextureUsage usage) {
+  Key key;
+
+  // Resolve relative paths and links so that different spellings of
+  // the same file match
+  error_code error;
+  filesystem::path canonical = filesystem::canonical(path, error);
+  key.path = error ? path : canonical.string();
+
+  // 64 bit FNV-1a
+  key.hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; i++) {
+    key.hash ^= file[i];
+    key.hash *= 0x100000001b3ull;
+  }
+
+  key.sampling = sampling;
+  key.usage = usage;
+
+  return key;
+}
+
+shared_ptr<Texture> TextureCache::find(const Key &key) {
+  lock_guard<mutex> lock(cacheLock);
+
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    return nullptr;
+  }
+
+  auto texture = it->second.lock();
+  if (texture) {
+    cacheHits++;
+  }
+
+  return texture;
+}
+
+shared_ptr<Texture> TextureCache::insert(const Key &key,
+                                         shared_ptr<Texture> texture) {
+  lock_guard<mutex> lock(cacheLock);
+
+  pruneCache();
+
+  // Another load of the same texture may have finished first
+  auto &entry = cache[key];
+  if (auto existing = entry.lock()) {
+    cacheHits++;
+    return existing;
+  }
+
+  entry = texture;
+  return texture;
+}
+
+size_t TextureCache::getCount() {
+  lock_guard<mutex> lock(cacheLock);
+
+  pruneCache();
+  return cache.size();
+}
+
+size_t TextureCache::getBytes() {
+  lock_guard<mutex> lock(cacheLock);
+
+  size_t bytes = 0;
+  for (auto &[key, entry] : cache) {
+    if (auto texture = entry.lock()) {
+      bytes += texture->getBytes();
+    }
+  }
+
+  return bytes;
+}
+
+size_t TextureCache::getHits() {
+  lock_guard<mutex> lock(cacheLock);
+  return cacheHits;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "platform/texture.hpp"
+
+/* A process wide registry of uploaded textures. Textures are looked up
+ * by their canonical path, a hash of the file contents, how they are
+ * sampled and what they are used for, so a file used by several materials or models is only decoded
+ * and uploaded once. Only weak references are held, so a texture is freed
+ * once nothing else uses it
+ */
+class TextureCache {
+public:
+  // Identifies a texture in the cache
+  struct Key {
+    std::string path;
+    uint64_t hash;
+    TextureSampling sampling;
+    TextureUsage usage;
+
+    // Allows Key to be used in ordered containers
+    bool operator<(const Key &other) const;
+  };
+
+  /* Creates the key of a texture file. Can be called from any thread
+   * @param path The path of the texture file
+   * @param file The contents of the texture file
+   * @param size The size of the file in bytes
+   * @param sampling How the texture is sampled
+   * @param usage What the texture is used for
+   * @returns The key of the texture
+   */
+  static Key makeKey(const std::string &path, const unsigned char *file,
+                     size_t size, const TextureSampling &sampling,
+                     TextureUsage usage);
+
+  /* Looks up a texture. Can be called from any thread
+   * @param key The key of the texture
+   * @returns The texture, or nullptr if it is not uploaded
+   */
+  static std::shared_ptr<Texture> find(const Key &key);
+
+  /* Adds an uploaded texture. If the texture was added while it was
+   * being loaded, the texture that is already in the cache is returned
+   * @param key The key of the texture
+   * @param texture The uploaded texture
+   * @returns The texture to use
+   */
+  static std::shared_ptr<Texture> insert(const Key &key,
+                                         std::shared_ptr<Texture> texture);
+
+  // Returns the number of textures in use
+  // @returns The number of textures in use
+  static size_t getCount();
+
+  // Returns the GPU memory held by the textures in use
+  // @returns The GPU memory in bytes
+  static size_t getBytes();
+
+  // Returns the number of loads that were skipped because the texture was
+  // already uploaded
+  // @returns The number of duplicate loads avoided
+  static size_t getHits();
+};
@@ -0,0 +1,193 @@
+#include "platform/texturefile.hpp"
+
+#include "helper/log.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#define TEXTURE_FILE_MAGIC "OITX"
+#define TEXTURE_FILE_VERSION 1
+#define TEXTURE_FILE_ALIGNMENT 16
+
+TextureFile::TextureFile(const string &path) {
+#ifdef _WIN32
+  this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+  if (this->file == INVALID_HANDLE_VALUE) {
+    this->file = nullptr;
+    return;
+  }
+
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(this->file, &fileSize);
+  this->size = (size_t)fileSize.QuadPart;
+
+  this->mapping =
+      CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (this->mapping == nullptr) {
+    return;
+  }
+
+  this->data = (const unsigned char *)MapViewOfFile(this->mapping,
+                                                    FILE_MAP_READ, 0, 0, 0);
+#else
+  int file = open(path.c_str(), O_RDONLY);
+  if (file == -1) {
+    return;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0) {
+    void *mapped =
+        mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    if (mapped != MAP_FAILED) {
+      this->data = (const unsigned char *)mapped;
+      this->size = status.st_size;
+    }
+  }
+
+  // The mapping stays valid after the file is closed
+  close(file);
+#endif
+
+  if (this->data == nullptr || this->size < sizeof(Header)) {
+    return;
+  }
+
+  // Check the header and level table
+  auto header = (const Header *)this->data;
+
+  if (memcmp(header->magic, TEXTURE_FILE_MAGIC, 4) != 0 ||
+      header->version != TEXTURE_FILE_VERSION || header->levels == 0 ||
+      sizeof(Header) + header->levels * sizeof(Level) > this->size) {
+    info("Invalid texture container: %s\n", path.c_str());
+    return;
+  }
+
+  auto levels = (const Level *)(this->data + sizeof(Header));
+
+  for (uint32_t i = 0; i < header->levels; i++) {
+    if (levels[i].offset + levels[i].size > this->size) {
+      info("Truncated texture container: %s\n", path.c_str());
+      return;
+    }
+  }
+
+  this->header = header;
+  this->levels = levels;
+}
+
+TextureFile::~TextureFile() {
+#ifdef _WIN32
+  if (this->data != nullptr) {
+    UnmapViewOfFile(this->data);
+  }
+
+  if (this->mapping != nullptr) {
+    CloseHandle(this->mapping);
+  }
+
+  if (this->file != nullptr) {
+    CloseHandle(this->file);
+  }
+#else
+  if (this->data != nullptr) {
+    munmap((void *)this->data, this->size);
+  }
+#endif
+}
+
+bool TextureFile::isValid() const { return this->header != nullptr; }
+
+GLenum TextureFile::getFormat() const { return this->header->format; }
+
+unsigned int TextureFile::getChannels() const { return this->header->channels; }
+
+unsigned int TextureFile::getWidth() const { return this->header->width; }
+
+unsigned int TextureFile::getHeight() const { return this->header->height; }
+
+unsigned int TextureFile::getLevels() const { return this->header->levels; }
+
+const unsigned char *TextureFile::getLevel(unsigned int level, size_t &size) const {
+  size = this->levels[level].size;
+  return this->data + this->levels[level].offset;
+}
+
+const unsigned char *TextureFile::getData(size_t &size) const {
+  size = this->size;
+  return this->data;
+}
+
+bool TextureFile::write(const string &path, GLenum format,
+                        unsigned int channels, unsigned int width,
+                        unsigned int height,
+                        const vector<vector<unsigned char>> &levels) {
+  Header header;
+  memcpy(header.magic, TEXTURE_FILE_MAGIC, 4);
+  header.version = TEXTURE_FILE_VERSION;
+  header.format = format;
+  header.channels = channels;
+  header.width = width;
+  header.height = height;
+  header.levels = (uint32_t)levels.size();
+  header.reserved = 0;
+
+  // Lay out the level data after the level table
+  vector<Level> table(levels.size());
+  uint64_t offset = sizeof(Header) + table.size() * sizeof(Level);
+
+  for (size_t i = 0; i < levels.size(); i++) {
+    offset = (offset + TEXTURE_FILE_ALIGNMENT - 1) &
+             ~(uint64_t)(TEXTURE_FILE_ALIGNMENT - 1);
+
+    table[i].offset = offset;
+    table[i].size = levels[i].size();
+
+    offset += levels[i].size();
+  }
+
+  // Write to a temporary file first, so a partly written container is
+  // never read
+  string temporary = path + ".tmp";
+  ofstream file(temporary, ios::binary);
+
+  if (!file) {
+    return false;
+  }
+
+  file.write((const char *)&header, sizeof(Header));
+  file.write((const char *)table.data(), table.size() * sizeof(Level));
+
+  for (size_t i = 0; i < levels.size(); i++) {
+    // Pad up to the level's offset
+    static const char padding[TEXTURE_FILE_ALIGNMENT] = {};
+    file.write(padding, table[i].offset - file.tellp());
+
+    file.write((const char *)levels[i].data(), levels[i].size());
+  }
+
+  file.close();
+
+  if (!file) {
+    remove(temporary.c_str());
+    return false;
+  }
+
+  // Replace any older container
+  remove(path.c_str());
+  return rename(temporary.c_str(), path.c_str()) == 0;
+}
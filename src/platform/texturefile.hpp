@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "platform/opengl.hpp"
+
+/* A baked texture container. It holds every mip level of a compressed
+ * texture, so it can be uploaded without decoding or generating mipmaps.
+ * The file is memory mapped, so the data is only paged in when it is read
+ *
+ * Layout (little endian):
+ *   Header
+ *   Level[levels]   Offset and size of each mip level, largest first
+ *   Level data      Each level starts on a 16 byte boundary
+ */
+class TextureFile {
+private:
+  // Memory maps a texture container
+  // @param path The path of the container
+  TextureFile(const std::string &path);
+
+public:
+  // Unmaps the file
+  ~TextureFile();
+
+  // Returns true if the file was mapped and has a valid header
+  // @returns True if the file can be used
+  bool isValid() const;
+
+  // Returns the OpenGL compressed internal format
+  // @returns The OpenGL compressed internal format
+  GLenum getFormat() const;
+  // Returns the number of channels of the source image
+  // @returns The number of channels of the source image
+  unsigned int getChannels() const;
+  // Returns the width of the largest mip level
+  // @returns The width of the largest mip level
+  unsigned int getWidth() const;
+  // Returns the height of the largest mip level
+  // @returns The height of the largest mip level
+  unsigned int getHeight() const;
+  // Returns the number of mip levels
+  // @returns The number of mip levels
+  unsigned int getLevels() const;
+
+  /* Returns the compressed data of a mip level
+   * @param level The mip level
+   * @param size Set to the size of the data in bytes
+   * @returns A pointer into the mapped file
+   */
+  const unsigned char *getLevel(unsigned int level, size_t &size) const;
+
+  // Returns the whole mapped file
+  // @param size Set to the size of the file in bytes
+  // @returns A pointer to the mapped file
+  const unsigned char *getData(size_t &size) const;
+
+  /* Writes a texture container
+   * @param path The path to write to
+   * @param format The OpenGL compressed internal format
+   * @param channels The number of channels of the source image
+   * @param width The width of the largest mip level
+   * @param height The height of the largest mip level
+   * @param levels The compressed data of each mip level, largest first
+   * @returns True if the file was written
+   */
+  static bool write(const std::string &path, GLenum format,
+                    unsigned int channels, unsigned int width,
+                    unsigned int height,
+                    const std::vector<std::vector<unsigned char>> &levels);
+
+  // Memory maps a texture container
+  // @param path The path of the container
+  inline static auto create(const std::string &path) {
+    return std::shared_ptr<TextureFile>(new TextureFile{path});
+  }
+
+private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t channels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t reserved;
+  };
+
+  struct Level {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+
+  const Header *header = nullptr;
+  const Level *levels = nullptr;
+};
@@ -0,0 +1,260 @@
+#include "platform/texturequeue.hpp"
+
+#include <stb_image.hpp>
+
+#include "helper/log.hpp"
+#include "platform/texturebaker.hpp"
+#include "platform/texturecache.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+TextureQueue::TextureQueue(shared_ptr<ThreadPool> pool, size_t memoryBudget) {
+  this->pool = pool;
+  this->memoryBudget = memoryBudget;
+}
+
+void TextureQueue::load(const string &path, Callback callback,
+                        TextureUsage usage, const TextureSampling &sampling) {
+  {
+    lock_guard<mutex> lock(this->queueLock);
+
+    if (this->cancelled) {
+      return;
+    }
+
+    this->pending++;
+  }
+
+  this->pool->submit([this, path, callback, usage, sampling] {
+    auto start = chrono::steady_clock::now();
+
+    // Baked containers don't need to be decoded. Their key uses the
+    // container, so they don't share a cache entry with the source image
+    auto baked = TextureBaker::findBaked(path);
+    if (baked) {
+      size_t size;
+      const unsigned char *data = baked->getData(size);
+      auto key = TextureCache::makeKey(TextureBaker::getBakedPath(path), data,
+                                       size, sampling, usage);
+
+      auto cached = TextureCache::find(key);
+      chrono::duration<double> mapTime = chrono::steady_clock::now() - start;
+
+      {
+        lock_guard<mutex> lock(this->queueLock);
+        this->decoded.push_back(Decoded{nullptr, callback, 0, mapTime.count(),
+                                        key, move(cached), baked});
+      }
+
+      this->textureDecoded.notify_all();
+      return;
+    }
+
+    auto file = Texture::read(path);
+    auto key =
+        TextureCache::makeKey(path, file.data(), file.size(), sampling, usage);
+
+    // Skip the decode if the texture is already uploaded
+    if (auto cached = TextureCache::find(key)) {
+      info("Texture %s: already loaded\n", path.c_str());
+
+      {
+        lock_guard<mutex> lock(this->queueLock);
+        this->decoded.push_back(
+            Decoded{nullptr, callback, 0, 0.0, key, move(cached), nullptr});
+      }
+
+      this->textureDecoded.notify_all();
+      return;
+    }
+
+    // Read the image header to find out how much memory the decode
+    // needs. If it can't be read, decode reports the error. The mipmaps
+    // add a third, and building them needs a float copy of the second
+    // level, which is as large as the base level
+    int width, height, channels;
+    size_t bytes = 0;
+    if (stbi_info_from_memory(file.data(), (int)file.size(), &width, &height,
+                              &channels)) {
+      bytes = (size_t)width * height * channels;
+      bytes += bytes * 4 / 3;
+    }
+
+    {
+      // Wait until the decoded pixels fit in the budget. If nothing is
+      // waiting to be uploaded, the texture is always allowed through
+      unique_lock<mutex> lock(this->queueLock);
+      this->memoryReleased.wait(lock, [this, bytes] {
+        return this->cancelled || this->reservedBytes == 0 ||
+               this->reservedBytes + bytes <= this->memoryBudget;
+      });
+
+      if (this->cancelled) {
+        return;
+      }
+
+      this->reservedBytes += bytes;
+      this->peakBytes = max(this->peakBytes, this->reservedBytes);
+    }
+
+    start = chrono::steady_clock::now();
+    auto data = Texture::decode(path, file);
+    Texture::generateMipmaps(*data, usage);
+    chrono::duration<double> decodeTime = chrono::steady_clock::now() - start;
+
+    {
+      lock_guard<mutex> lock(this->queueLock);
+      this->decoded.push_back(
+          Decoded{data, callback, bytes, decodeTime.count(), key, nullptr,
+                  nullptr});
+    }
+
+    this->textureDecoded.notify_all();
+  });
+}
+
+void TextureQueue::update(double budget) {
+  auto start = chrono::steady_clock::now();
+
+  while (true) {
+    Decoded next;
+
+    {
+      lock_guard<mutex> lock(this->queueLock);
+
+      if (this->decoded.empty()) {
+        break;
+      }
+
+      next = move(this->decoded.front());
+      this->decoded.pop_front();
+    }
+
+    this->upload(next);
+
+    // Stop once the budget is used up
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (elapsed.count() >= budget) {
+      break;
+    }
+  }
+}
+
+void TextureQueue::finish() {
+  while (true) {
+    Decoded next;
+
+    {
+      // Wait for the next decode to finish
+      unique_lock<mutex> lock(this->queueLock);
+      this->textureDecoded.wait(lock, [this] {
+        return this->pending == 0 || !this->decoded.empty();
+      });
+
+      if (this->decoded.empty()) {
+        return;
+      }
+
+      next = move(this->decoded.front());
+      this->decoded.pop_front();
+    }
+
+    this->upload(next);
+  }
+}
+
+void TextureQueue::cancel() {
+  {
+    lock_guard<mutex> lock(this->queueLock);
+    this->cancelled = true;
+  }
+
+  this->memoryReleased.notify_all();
+}
+
+size_t TextureQueue::getPending() {
+  lock_guard<mutex> lock(this->queueLock);
+  return this->pending;
+}
+
+size_t TextureQueue::getPeakBytes() {
+  lock_guard<mutex> lock(this->queueLock);
+  return this->peakBytes;
+}
+
+const vector<TextureStats> &TextureQueue::getStats() { return this->stats; }
+
+void TextureQueue::setBuckets(shared_ptr<TextureBuckets> buckets) {
+  this->buckets = buckets;
+}
+
+shared_ptr<TextureBuckets> TextureQueue::getBuckets() { return this->buckets; }
+
+void TextureQueue::upload(Decoded &decoded) {
+  if (decoded.cached) {
+    {
+      lock_guard<mutex> lock(this->queueLock);
+      this->pending--;
+    }
+
+    this->textureDecoded.notify_all();
+
+    decoded.callback(decoded.cached);
+    return;
+  }
+
+  auto start = chrono::steady_clock::now();
+  shared_ptr<Texture> texture;
+  TextureStats stats;
+
+  if (decoded.baked) {
+    if (this->buckets) {
+      texture = this->buckets->upload(*decoded.baked, decoded.key.sampling);
+    } else {
+      texture = Texture::create(*decoded.baked, decoded.key.sampling);
+    }
+
+    stats.path = decoded.key.path;
+  } else {
+    if (this->buckets) {
+      texture = this->buckets->upload(*decoded.data, decoded.key.sampling);
+    }
+
+    if (!texture) {
+      texture = Texture::create(*decoded.data, decoded.key.sampling);
+    }
+
+    stats.path = decoded.data->path;
+  }
+
+  chrono::duration<double> uploadTime = chrono::steady_clock::now() - start;
+
+  // Another queue may have uploaded the same texture at the same time
+  texture = TextureCache::insert(decoded.key, texture);
+
+  stats.bytes = texture->getBytes();
+  stats.decodeTime = decoded.decodeTime;
+  stats.uploadTime = uploadTime.count();
+  this->stats.push_back(stats);
+
+  info("Texture %s: decode %.2f ms, upload %.2f ms\n", stats.path.c_str(),
+       stats.decodeTime * 1000.0, stats.uploadTime * 1000.0);
+
+  decoded.data = nullptr;
+  decoded.baked = nullptr;
+
+  {
+    // The decoded pixels are freed, so other decodes can start
+    lock_guard<mutex> lock(this->queueLock);
+    this->reservedBytes -= decoded.reserved;
+    this->pending--;
+  }
+
+  this->memoryReleased.notify_all();
+  this->textureDecoded.notify_all();
+
+  decoded.callback(texture);
+}
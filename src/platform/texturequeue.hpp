@@ -0,0 +1,149 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "helper/threadpool.hpp"
+#include "platform/texture.hpp"
+#include "platform/texturearray.hpp"
+#include "platform/texturecache.hpp"
+
+// Load time statistics for a single texture
+struct TextureStats {
+  std::string path;
+
+  // GPU memory used by the texture in bytes
+  size_t bytes;
+
+  // Time in seconds spent decoding and generating mipmaps (or mapping a
+  // baked container) on a worker thread
+  double decodeTime;
+  // Time in seconds spent uploading on the OpenGL thread
+  double uploadTime;
+};
+
+/* Decodes textures on a thread pool and uploads them on the OpenGL
+ * thread in the order the decodes finish. The memory held by decoded
+ * textures that have not been uploaded yet is bounded. Workers wait
+ * before decoding a texture that would go over the bound. Textures that
+ * are already in the TextureCache are not decoded again, and textures
+ * with an up to date baked container are uploaded from it
+ */
+class TextureQueue {
+private:
+  /* Creates a texture queue
+   * @param pool The thread pool to decode textures on
+   * @param memoryBudget The maximum number of bytes of decoded textures
+   * waiting to be uploaded. A single texture larger than this is still loaded
+   */
+  TextureQueue(std::shared_ptr<ThreadPool> pool, size_t memoryBudget);
+
+public:
+  // Called on the OpenGL thread once a texture is uploaded
+  using Callback = std::function<void(std::shared_ptr<Texture>)>;
+
+  /* Queues a texture to be decoded. Its mipmaps are generated on the
+   * worker thread too. Can be called from any thread
+   * @param path The path of the texture file
+   * @param callback Called on the OpenGL thread with the uploaded texture
+   * @param usage What the texture is used for
+   * @param sampling How the texture is sampled
+   */
+  void load(const std::string &path, Callback callback,
+            TextureUsage usage = TextureUsage::Color,
+            const TextureSampling &sampling = {});
+
+  /* Uploads decoded textures. Must be called from the OpenGL thread. At
+   * least one texture is uploaded if one is ready
+   * @param budget The time in seconds to spend uploading
+   */
+  void update(double budget);
+
+  // Uploads textures as they are decoded until every queued texture has
+  // been uploaded. Must be called from the OpenGL thread
+  void finish();
+
+  // Stops decoding textures. Workers waiting for memory return without
+  // decoding. Queued textures are never uploaded
+  void cancel();
+
+  // Returns the number of textures that have not been uploaded
+  // @returns The number of textures that have not been uploaded
+  size_t getPending();
+
+  // Returns the largest number of decoded bytes that waited for upload
+  // @returns The peak number of decoded bytes waiting for upload
+  size_t getPeakBytes();
+
+  // Returns the statistics of every uploaded texture, in upload order. Must
+  // be called from the OpenGL thread
+  // @returns The statistics of every uploaded texture
+  const std::vector<TextureStats> &getStats();
+
+  /* Uploads textures into texture arrays instead of textures of their own.
+   * Textures that can't be put in an array are still uploaded on their own
+   * @param buckets The texture arrays to upload into, or nullptr to stop
+   */
+  void setBuckets(std::shared_ptr<TextureBuckets> buckets);
+
+  // Returns the texture arrays textures are uploaded into
+  // @returns The texture arrays, or nullptr if they are not used
+  std::shared_ptr<TextureBuckets> getBuckets();
+
+  /* Creates a texture queue
+   * @param pool The thread pool to decode textures on
+   * @param memoryBudget The maximum number of bytes of decoded textures
+   * waiting to be uploaded. A single texture larger than this is still loaded
+   */
+  inline static auto create(std::shared_ptr<ThreadPool> pool,
+                            size_t memoryBudget = 256 * 1024 * 1024) {
+    return std::shared_ptr<TextureQueue>(new TextureQueue{pool, memoryBudget});
+  }
+
+private:
+  // A decoded texture waiting to be uploaded
+  struct Decoded {
+    std::shared_ptr<TextureData> data;
+    Callback callback;
+
+    // The bytes reserved against the memory budget
+    size_t reserved;
+    double decodeTime;
+
+    TextureCache::Key key;
+
+    // Set instead of data if the texture was found in the cache
+    std::shared_ptr<Texture> cached;
+
+    // Set instead of data if the texture has a baked container
+    std::shared_ptr<TextureFile> baked;
+  };
+
+  // Uploads one decoded texture and releases its memory reservation
+  // @param decoded The decoded texture
+  void upload(Decoded &decoded);
+
+  std::shared_ptr<ThreadPool> pool;
+
+  std::mutex queueLock;
+  std::condition_variable memoryReleased;
+  std::condition_variable textureDecoded;
+
+  // Decoded textures in the order they finished
+  std::deque<Decoded> decoded;
+
+  size_t memoryBudget;
+  size_t reservedBytes = 0;
+  size_t peakBytes = 0;
+  size_t pending = 0;
+  bool cancelled = false;
+
+  std::vector<TextureStats> stats;
+
+  std::shared_ptr<TextureBuckets> buckets = nullptr;
+};
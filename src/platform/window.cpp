@@ -121,3 +121,12 @@ void Window::setDepthTest(bool test) {
     glDepthMask(GL_FALSE);
   }
 }
+
+void Window::setScissor(bool scissor, int x, int y, int width, int height) {
+  if (scissor) {
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, width, height);
+  } else {
+    glDisable(GL_SCISSOR_TEST);
+  }
+}
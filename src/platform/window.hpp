@@ -44,6 +44,16 @@ public:
   // @param test True enables depth testing
   void setDepthTest(bool test);
 
+  /* Enables/disables the scissor test
+   * @param scissor True limits drawing and clears to a rectangle
+   * @param x The left edge of the rectangle in pixels
+   * @param y The bottom edge of the rectangle in pixels
+   * @param width The width of the rectangle in pixels
+   * @param height The height of the rectangle in pixels
+   */
+  void setScissor(bool scissor, int x = 0, int y = 0, int width = 0,
+                  int height = 0);
+
   /* Creates a window and an OpenGL 4.3 context
    * @param resX The window width
    * @param resY The window height
@@ -0,0 +1,310 @@
+#include "rendering/bvh.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
+using namespace std;
+using namespace glm;
+
+// The number of bins each axis is split into when looking for a split
+#define SAH_BINS 16
+
+// Subtrees with at least this many primitives are built on another thread
+#define PARALLEL_PRIMITIVES 8192
+
+struct BVH::BuildState {
+  const vector<BoundingBox> *boxes;
+  vector<vec3> centroids;
+  size_t leafSize;
+  ThreadPool *pool;
+
+  // The number of nodes handed out
+  atomic<uint32_t> nodeCount{0};
+};
+
+// Returns the surface area of a box
+static float getArea(const BoundingBox &box) {
+  vec3 size = box.max - box.min;
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void BVH::build(const vector<BoundingBox> &boxes, size_t leafSize,
+                ThreadPool *pool) {
+  this->nodes.clear();
+  this->order.resize(boxes.size());
+
+  if (boxes.empty()) {
+    return;
+  }
+
+  iota(this->order.begin(), this->order.end(), 0);
+
+  BuildState state;
+  state.boxes = &boxes;
+  state.leafSize = std::clamp(leafSize, (size_t)1, (size_t)BVH_MAX_LEAF);
+  state.pool = pool;
+
+  state.centroids.resize(boxes.size());
+  for (size_t i = 0; i < boxes.size(); i++) {
+    state.centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+  }
+
+  // A binary tree with n leaves has at most 2n - 1 nodes. Allocating them
+  // up front lets threads fill in nodes without locking
+  this->nodes.resize(boxes.size() * 2);
+  state.nodeCount = 1;
+
+  this->buildNode(state, 0, 0, (uint32_t)boxes.size(), 0);
+
+  if (pool) {
+    pool->wait();
+  }
+
+  this->nodes.resize(state.nodeCount);
+}
+
+const vector<BVHNode> &BVH::getNodes() const { return this->nodes; }
+
+const vector<uint32_t> &BVH::getOrder() const { return this->order; }
+
+BoundingBox BVH::getBounds() const {
+  return this->nodes.empty() ? BoundingBox{} : this->nodes[0].bounds;
+}
+
+size_t BVH::cull(const Frustum &frustum, const BoundsList &bounds,
+                 vector<uint8_t> &visible) const {
+  visible.assign(this->order.size(), 0);
+
+  if (this->nodes.empty()) {
+    return 0;
+  }
+
+  size_t visibleCount = 0;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  int size = 0;
+  stack[size++] = 0;
+
+  while (size > 0) {
+    const BVHNode &node = this->nodes[stack[--size]];
+
+    switch (frustum.test(node.bounds)) {
+    case Containment::Outside:
+      break;
+
+    case Containment::Inside:
+      // Everything below the node is inside too
+      fill(visible.begin() + node.first,
+           visible.begin() + node.first + node.count, 1);
+      visibleCount += node.count;
+      break;
+
+    case Containment::Intersecting:
+      if (node.isLeaf()) {
+        visibleCount += bounds.cull(frustum, visible, node.first, node.count);
+      } else {
+        stack[size++] = node.left + 1;
+        stack[size++] = node.left;
+      }
+      break;
+    }
+  }
+
+  return visibleCount;
+}
+
+void BVH::buildNode(BuildState &state, uint32_t index, uint32_t first,
+                    uint32_t count, int depth) {
+  auto &boxes = *state.boxes;
+  auto &centroids = state.centroids;
+
+  BVHNode node;
+  node.first = first;
+  node.count = count;
+  node.left = 0;
+
+  BoundingBox centroidBounds;
+  for (uint32_t i = first; i < first + count; i++) {
+    node.bounds.add(boxes[this->order[i]]);
+    centroidBounds.add(centroids[this->order[i]]);
+  }
+
+  if (count <= state.leafSize) {
+    this->nodes[index] = node;
+    return;
+  }
+
+  auto begin = this->order.begin() + first;
+  auto end = begin + count;
+  auto middle = end;
+
+  vec3 extent = centroidBounds.max - centroidBounds.min;
+
+  if (depth < BVH_SAH_DEPTH) {
+    // Sort the primitives into bins along each axis, and find the split
+    // between bins with the lowest cost. The cost of a side is its number
+    // of primitives times its surface area
+    float bestCost = INFINITY;
+    int bestAxis = -1;
+    int bestSplit = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+      if (extent[axis] <= 0.0f) {
+        continue;
+      }
+
+      BoundingBox bins[SAH_BINS];
+      uint32_t binCounts[SAH_BINS] = {};
+      float scale = SAH_BINS / extent[axis];
+
+      for (uint32_t i = first; i < first + count; i++) {
+        uint32_t p = this->order[i];
+        int bin = std::min((int)((centroids[p][axis] -
+                             centroidBounds.min[axis]) * scale),
+                      SAH_BINS - 1);
+
+        bins[bin].add(boxes[p]);
+        binCounts[bin]++;
+      }
+
+      // The cost of the right side of each split, swept from the right
+      float rightCosts[SAH_BINS];
+      BoundingBox right;
+      uint32_t rightCount = 0;
+
+      for (int b = SAH_BINS - 1; b > 0; b--) {
+        right.add(bins[b]);
+        rightCount += binCounts[b];
+        rightCosts[b] = rightCount ? rightCount * getArea(right) : 0.0f;
+      }
+
+      BoundingBox left;
+      uint32_t leftCount = 0;
+
+      // Split s puts bins below s on the left
+      for (int s = 1; s < SAH_BINS; s++) {
+        left.add(bins[s - 1]);
+        leftCount += binCounts[s - 1];
+
+        if (leftCount == 0 || leftCount == count) {
+          continue;
+        }
+
+        float cost = leftCount * getArea(left) + rightCosts[s];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = s;
+        }
+      }
+    }
+
+    // A leaf is kept if testing its primitives is cheaper than testing
+    // two children and their primitives
+    float area = getArea(node.bounds);
+    float leafCost = (float)count;
+    float splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+
+    if (count <= BVH_MAX_LEAF && (bestAxis < 0 || splitCost >= leafCost)) {
+      this->nodes[index] = node;
+      return;
+    }
+
+    if (bestAxis >= 0) {
+      float scale = SAH_BINS / extent[bestAxis];
+      float minimum = centroidBounds.min[bestAxis];
+
+      middle = partition(begin, end, [&](uint32_t p) {
+        int bin = std::min((int)((centroids[p][bestAxis] - minimum) * scale),
+                      SAH_BINS - 1);
+        return bin < bestSplit;
+      });
+    }
+  }
+
+  // Split at the middle of the longest axis when there is no good split
+  if (middle == begin || middle == end) {
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+      axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+      axis = 2;
+    }
+
+    middle = begin + count / 2;
+    nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+      return centroids[a][axis] < centroids[b][axis];
+    });
+  }
+
+  uint32_t leftCount = (uint32_t)(middle - begin);
+  uint32_t left = state.nodeCount.fetch_add(2);
+
+  node.left = left;
+  this->nodes[index] = node;
+
+  if (state.pool && count >= PARALLEL_PRIMITIVES) {
+    state.pool->submit([this, &state, left, first, leftCount, depth] {
+      this->buildNode(state, left, first, leftCount, depth + 1);
+    });
+  } else {
+    this->buildNode(state, left, first, leftCount, depth + 1);
+  }
+
+  this->buildNode(state, left + 1, first + leftCount, count - leftCount,
+                  depth + 1);
+}
+
+float BVH::hitBox(const BoundingBox &box, const vec3 &origin,
+                  const vec3 &inverse, float distance) {
+  vec3 t0 = (box.min - origin) * inverse;
+  vec3 t1 = (box.max - origin) * inverse;
+
+  vec3 entry = glm::min(t0, t1);
+  vec3 leave = glm::max(t0, t1);
+
+  float enter = std::max(std::max(entry.x, entry.y), std::max(entry.z, 0.0f));
+  float exitAt = std::min(std::min(leave.x, leave.y), std::min(leave.z, distance));
+
+  return enter <= exitAt ? enter : INFINITY;
+}
+
+bool hitTriangle(const vec3 &origin, const vec3 &direction, const vec3 &a,
+                 const vec3 &b, const vec3 &c, float &distance) {
+  const float epsilon = 1e-7f;
+
+  vec3 edge1 = b - a;
+  vec3 edge2 = c - a;
+
+  vec3 p = cross(direction, edge2);
+  float determinant = dot(edge1, p);
+
+  // The ray is parallel to the triangle. Both sides are hit
+  if (std::abs(determinant) < epsilon) {
+    return false;
+  }
+
+  float inverse = 1.0f / determinant;
+
+  vec3 s = origin - a;
+  float u = dot(s, p) * inverse;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+
+  vec3 q = cross(s, edge1);
+  float v = dot(direction, q) * inverse;
+  if (v < 0.0f || u + v > 1.0f) {
+    return false;
+  }
+
+  float t = dot(edge2, q) * inverse;
+  if (t <= 0.0f || t >= distance) {
+    return false;
+  }
+
+  distance = t;
+  return true;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "helper/threadpool.hpp"
+#include "rendering/culling.hpp"
+
+// The most primitives a BVH node can hold before it is always split
+#define BVH_MAX_LEAF 16
+
+// Below this depth nodes are split at the middle instead of with the
+// surface area heuristic, which keeps the depth bounded for queries
+#define BVH_SAH_DEPTH 48
+
+// The size of the traversal stack. Enough for a tree split with the
+// heuristic down to BVH_SAH_DEPTH and at the middle below that
+#define BVH_STACK_SIZE 128
+
+// A node of a BVH. Every node covers a range of the BVH's primitive order,
+// so the primitives of a subtree are next to each other
+struct BVHNode {
+  BoundingBox bounds;
+
+  // The range of the node's primitives in getOrder()
+  uint32_t first;
+  uint32_t count;
+
+  // The index of the left child. The right child follows it. Zero for
+  // leaves, since the root is never a child
+  uint32_t left;
+
+  bool isLeaf() const { return this->left == 0; }
+};
+
+/* A bounding volume hierarchy over boxes, built with the surface area
+ * heuristic
+ *
+ * The primitives are reordered so that each node covers a contiguous
+ * range. Queries report positions in that order, which getOrder maps back
+ * to the boxes passed to build
+ */
+class BVH {
+public:
+  /* Builds the hierarchy. Replaces any previous one
+   * @param boxes The bounds of each primitive
+   * @param leafSize The number of primitives a leaf aims to hold
+   * @param pool If not nullptr, large subtrees are built on its threads.
+   * Must not be called from one of its threads
+   */
+  void build(const std::vector<BoundingBox> &boxes, size_t leafSize = 4,
+             ThreadPool *pool = nullptr);
+
+  // Returns the nodes. The root is the first node
+  // @returns The nodes
+  const std::vector<BVHNode> &getNodes() const;
+
+  // Returns the box index of each position in the BVH's order
+  // @returns The box index of each position
+  const std::vector<uint32_t> &getOrder() const;
+
+  // Returns the bounds of everything in the hierarchy
+  // @returns The bounds of the root
+  BoundingBox getBounds() const;
+
+  /* Finds the primitives that may be inside a frustum. Subtrees that are
+   * fully inside are accepted without testing them further, and the
+   * primitives of leaves that are partly inside are tested as a batch
+   * @param frustum The frustum, in the same space as the boxes
+   * @param bounds The primitive boxes in the BVH's order
+   * @param visible Set to 1 for each visible position in the BVH's order
+   * @returns The number of visible primitives
+   */
+  size_t cull(const Frustum &frustum, const BoundsList &bounds,
+              std::vector<uint8_t> &visible) const;
+
+  /* Finds the closest primitive hit by a ray
+   * @param origin The start of the ray
+   * @param direction The direction of the ray. Distances are in multiples
+   * of its length
+   * @param distance The furthest distance to look at. Set to the distance
+   * of the hit, if there is one
+   * @param intersect Called as intersect(position, distance) for the
+   * primitives of each leaf the ray reaches. It returns true and lowers
+   * distance if the primitive is hit closer than distance
+   * @returns True if a primitive was hit
+   */
+  template <typename Intersect>
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               float &distance, Intersect intersect) const;
+
+private:
+  // Data shared by the threads of a build
+  struct BuildState;
+
+  /* Builds a node and its subtree
+   * @param state The build's shared data
+   * @param node The index of the node
+   * @param first The first position of the node's primitives in the order
+   * @param count The number of primitives
+   * @param depth The depth of the node
+   */
+  void buildNode(BuildState &state, uint32_t node, uint32_t first,
+                 uint32_t count, int depth);
+
+  /* Returns the distance at which a ray enters a box
+   * @param box The box
+   * @param origin The start of the ray
+   * @param inverse One over each component of the ray's direction
+   * @param distance The furthest distance to look at
+   * @returns The entry distance, or INFINITY if the ray misses
+   */
+  static float hitBox(const BoundingBox &box, const glm::vec3 &origin,
+                      const glm::vec3 &inverse, float distance);
+
+  std::vector<BVHNode> nodes;
+  std::vector<uint32_t> order;
+};
+
+/* Tests a ray against a triangle with the Moller-Trumbore algorithm
+ * @param origin The start of the ray
+ * @param direction The direction of the ray
+ * @param a The first corner
+ * @param b The second corner
+ * @param c The third corner
+ * @param distance The furthest distance to look at. Set to the distance of
+ * the hit, if there is one
+ * @returns True if the triangle was hit closer than distance
+ */
+bool hitTriangle(const glm::vec3 &origin, const glm::vec3 &direction,
+                 const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c,
+                 float &distance);
+
+template <typename Intersect>
+bool BVH::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                  float &distance, Intersect intersect) const {
+  if (this->nodes.empty()) {
+    return false;
+  }
+
+  glm::vec3 inverse = 1.0f / direction;
+  bool hit = false;
+
+  // Nodes still to visit
+  uint32_t stack[BVH_STACK_SIZE];
+  int size = 0;
+
+  if (hitBox(this->nodes[0].bounds, origin, inverse, distance) != INFINITY) {
+    stack[size++] = 0;
+  }
+
+  while (size > 0) {
+    const BVHNode &node = this->nodes[stack[--size]];
+
+    if (node.isLeaf()) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        hit = intersect(i, distance) || hit;
+      }
+
+      continue;
+    }
+
+    // Visit the closer child first, so that later boxes are more likely
+    // to be further than the closest hit and skipped
+    float left = hitBox(this->nodes[node.left].bounds, origin, inverse,
+                        distance);
+    float right = hitBox(this->nodes[node.left + 1].bounds, origin, inverse,
+                         distance);
+
+    uint32_t closer = node.left, further = node.left + 1;
+    if (right < left) {
+      std::swap(closer, further);
+      std::swap(left, right);
+    }
+
+    if (right != INFINITY) {
+      stack[size++] = further;
+    }
+
+    if (left != INFINITY) {
+      stack[size++] = closer;
+    }
+  }
+
+  return hit;
+}
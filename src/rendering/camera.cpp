@@ -2,7 +2,8 @@
 
 using namespace glm;
 
-Camera::Camera(float FOV, float aspect, float near, float far) {
+Camera::Camera(float FOV, float aspect, float near, float far)
+    : FOV(FOV), nearPlane(near), farPlane(far) {
   this->P = perspective(radians(FOV), aspect, near, far);
 }
 
@@ -32,13 +33,36 @@ vec3 Camera::getUp() {
   return -up;
 }
 
-mat4 Camera::getMatrix() {
+mat4 Camera::getMatrix() { return this->P * this->getView(); }
+
+mat4 Camera::getTileMatrix(int x, int y, int width, int height, int imageWidth,
+                           int imageHeight) {
+  mat4 image = perspective(radians(this->FOV),
+                           imageWidth / (float)imageHeight, this->nearPlane,
+                           this->farPlane);
+
+  // Scales and moves the tile's part of the clip space onto all of it. The
+  // offsets are multiplied by w, so they hold after the divide
+  mat4 tile = mat4(1.0f);
+  tile[0][0] = imageWidth / (float)width;
+  tile[1][1] = imageHeight / (float)height;
+  tile[3][0] = (imageWidth - 2.0f * x - width) / (float)width;
+  tile[3][1] = (imageHeight - 2.0f * y - height) / (float)height;
+
+  return tile * image * this->getView();
+}
+
+mat4 Camera::getView() {
   // Use glm::lookAt to calculate the view matrix
   vec3 forward = this->getForward();
-  vec3 right = this->getRight();
   vec3 up = this->getUp();
 
-  mat4 V =
-      lookAt(this->transform.position, this->transform.position + forward, up);
-  return this->P * V;
+  return lookAt(this->transform.position, this->transform.position + forward,
+                up);
+}
+
+float Camera::getPixelSize(float distance, int screenHeight) {
+  // P[1][1] is one over the tangent of half the field of view, so the
+  // screen is 2 * distance / P[1][1] tall at the distance
+  return 2.0f * distance / (this->P[1][1] * (float)screenHeight);
 }
@@ -37,6 +37,28 @@ public:
   // @returns The perspective * view matrix
   glm::mat4 getMatrix();
 
+  /* Returns the perspective * view matrix of a tile of a larger image.
+   * The image has the camera's field of view but its own aspect ratio,
+   * and the tile's pixels fill the clip space. Tiles may reach past the
+   * edges of the image
+   * @param x The left of the tile in pixels
+   * @param y The bottom of the tile in pixels
+   * @param width The width of the tile in pixels
+   * @param height The height of the tile in pixels
+   * @param imageWidth The width of the image in pixels
+   * @param imageHeight The height of the image in pixels
+   * @returns The perspective * view matrix
+   */
+  glm::mat4 getTileMatrix(int x, int y, int width, int height, int imageWidth,
+                          int imageHeight);
+
+  /* Returns the world space size of a pixel at a distance from the camera
+   * @param distance The distance from the camera
+   * @param screenHeight The height of the screen in pixels
+   * @returns The size of a pixel
+   */
+  float getPixelSize(float distance, int screenHeight);
+
   /* Calculates the perspective matrix
    * @param FOV The field of view in degrees
    * @param aspect The aspect ratio calculated by (RESOLUTION_X/RESOLUTION_Y)
@@ -48,5 +70,11 @@ public:
   }
 
 private:
+  // Returns the view matrix
+  // @returns The view matrix
+  glm::mat4 getView();
+
   glm::mat4 P;
+
+  float FOV, nearPlane, farPlane;
 };
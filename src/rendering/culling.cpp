@@ -0,0 +1,209 @@
+#include "rendering/culling.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#define USE_AVX2
+#endif
+
+using namespace std;
+using namespace glm;
+
+void BoundingBox::add(const vec3 &point) {
+  this->min = glm::min(this->min, point);
+  this->max = glm::max(this->max, point);
+}
+
+void BoundingBox::add(const BoundingBox &box) {
+  this->min = glm::min(this->min, box.min);
+  this->max = glm::max(this->max, box.max);
+}
+
+bool BoundingBox::isValid() const {
+  return this->min.x <= this->max.x && this->min.y <= this->max.y &&
+         this->min.z <= this->max.z;
+}
+
+bool ScreenRect::isEmpty() const {
+  return this->width <= 0 || this->height <= 0;
+}
+
+Frustum::Frustum(const mat4 &matrix) {
+  // Gribb and Hartmann. Each plane is the fourth row of the matrix plus or
+  // minus one of the others. glm matrices are column major
+  vec4 rows[4];
+  for (int r = 0; r < 4; r++) {
+    rows[r] = vec4(matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r]);
+  }
+
+  this->planes[0] = rows[3] + rows[0];
+  this->planes[1] = rows[3] - rows[0];
+  this->planes[2] = rows[3] + rows[1];
+  this->planes[3] = rows[3] - rows[1];
+  this->planes[4] = rows[3] + rows[2];
+  this->planes[5] = rows[3] - rows[2];
+}
+
+Containment Frustum::test(const BoundingBox &box) const {
+  Containment result = Containment::Inside;
+
+  for (auto &plane : this->planes) {
+    vec3 normal = vec3(plane);
+
+    // The corners furthest along and against the normal
+    bvec3 facing = greaterThanEqual(normal, vec3(0.0f));
+    vec3 positive = glm::mix(box.min, box.max, facing);
+    vec3 negative = glm::mix(box.max, box.min, facing);
+
+    if (dot(normal, positive) + plane.w < 0.0f) {
+      return Containment::Outside;
+    }
+
+    if (dot(normal, negative) + plane.w < 0.0f) {
+      result = Containment::Intersecting;
+    }
+  }
+
+  return result;
+}
+
+void BoundsList::clear() {
+  this->minX.clear();
+  this->minY.clear();
+  this->minZ.clear();
+  this->maxX.clear();
+  this->maxY.clear();
+  this->maxZ.clear();
+}
+
+void BoundsList::add(const BoundingBox &box) {
+  this->minX.push_back(box.min.x);
+  this->minY.push_back(box.min.y);
+  this->minZ.push_back(box.min.z);
+  this->maxX.push_back(box.max.x);
+  this->maxY.push_back(box.max.y);
+  this->maxZ.push_back(box.max.z);
+}
+
+size_t BoundsList::size() const { return this->minX.size(); }
+
+size_t BoundsList::cull(const Frustum &frustum, vector<uint8_t> &visible) const {
+  visible.resize(this->size());
+  return this->cull(frustum, visible, 0, this->size());
+}
+
+size_t BoundsList::cull(const Frustum &frustum, vector<uint8_t> &visible,
+                        size_t first, size_t count) const {
+  size_t end = first + count;
+
+  size_t visibleCount = 0;
+  size_t i = first;
+
+  // For each plane, the corner of a box furthest along the plane's normal
+  // is found by taking the larger product per axis. The box is outside if
+  // that corner is behind the plane
+#ifdef USE_AVX2
+  for (; i + 8 <= end; i += 8) {
+    __m256 bx0 = _mm256_loadu_ps(&this->minX[i]);
+    __m256 by0 = _mm256_loadu_ps(&this->minY[i]);
+    __m256 bz0 = _mm256_loadu_ps(&this->minZ[i]);
+    __m256 bx1 = _mm256_loadu_ps(&this->maxX[i]);
+    __m256 by1 = _mm256_loadu_ps(&this->maxY[i]);
+    __m256 bz1 = _mm256_loadu_ps(&this->maxZ[i]);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (auto &plane : frustum.planes) {
+      __m256 a = _mm256_set1_ps(plane.x);
+      __m256 b = _mm256_set1_ps(plane.y);
+      __m256 c = _mm256_set1_ps(plane.z);
+
+      __m256 distance = _mm256_set1_ps(plane.w);
+      distance = _mm256_add_ps(
+          distance, _mm256_max_ps(_mm256_mul_ps(a, bx0), _mm256_mul_ps(a, bx1)));
+      distance = _mm256_add_ps(
+          distance, _mm256_max_ps(_mm256_mul_ps(b, by0), _mm256_mul_ps(b, by1)));
+      distance = _mm256_add_ps(
+          distance, _mm256_max_ps(_mm256_mul_ps(c, bz0), _mm256_mul_ps(c, bz1)));
+
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+
+    int mask = _mm256_movemask_ps(inside);
+    for (int j = 0; j < 8; j++) {
+      visible[i + j] = (mask >> j) & 1;
+      visibleCount += (mask >> j) & 1;
+    }
+  }
+#endif
+
+#ifdef USE_SSE2
+  for (; i + 4 <= end; i += 4) {
+    __m128 bx0 = _mm_loadu_ps(&this->minX[i]);
+    __m128 by0 = _mm_loadu_ps(&this->minY[i]);
+    __m128 bz0 = _mm_loadu_ps(&this->minZ[i]);
+    __m128 bx1 = _mm_loadu_ps(&this->maxX[i]);
+    __m128 by1 = _mm_loadu_ps(&this->maxY[i]);
+    __m128 bz1 = _mm_loadu_ps(&this->maxZ[i]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (auto &plane : frustum.planes) {
+      __m128 a = _mm_set1_ps(plane.x);
+      __m128 b = _mm_set1_ps(plane.y);
+      __m128 c = _mm_set1_ps(plane.z);
+
+      __m128 distance = _mm_set1_ps(plane.w);
+      distance = _mm_add_ps(distance,
+                            _mm_max_ps(_mm_mul_ps(a, bx0), _mm_mul_ps(a, bx1)));
+      distance = _mm_add_ps(distance,
+                            _mm_max_ps(_mm_mul_ps(b, by0), _mm_mul_ps(b, by1)));
+      distance = _mm_add_ps(distance,
+                            _mm_max_ps(_mm_mul_ps(c, bz0), _mm_mul_ps(c, bz1)));
+
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    for (int j = 0; j < 4; j++) {
+      visible[i + j] = (mask >> j) & 1;
+      visibleCount += (mask >> j) & 1;
+    }
+  }
+#endif
+
+  for (; i < end; i++) {
+    bool inside = true;
+
+    for (auto &plane : frustum.planes) {
+      float distance = plane.w +
+                       std::max(plane.x * this->minX[i], plane.x * this->maxX[i]) +
+                       std::max(plane.y * this->minY[i], plane.y * this->maxY[i]) +
+                       std::max(plane.z * this->minZ[i], plane.z * this->maxZ[i]);
+
+      inside = inside && distance >= 0.0f;
+    }
+
+    visible[i] = inside ? 1 : 0;
+    visibleCount += inside ? 1 : 0;
+  }
+
+  return visibleCount;
+}
+
+void CullStats::add(const CullStats &other) {
+  this->meshes += other.meshes;
+  this->visibleMeshes += other.visibleMeshes;
+  this->chunks += other.chunks;
+  this->visibleChunks += other.visibleChunks;
+  this->occludedChunks += other.occludedChunks;
+  this->meshlets += other.meshlets;
+  this->visibleMeshlets += other.visibleMeshlets;
+}
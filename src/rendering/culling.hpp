@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// An axis aligned bounding box
+struct BoundingBox {
+  glm::vec3 min = glm::vec3(INFINITY);
+  glm::vec3 max = glm::vec3(-INFINITY);
+
+  // Grows the box to hold a point
+  // @param point The point
+  void add(const glm::vec3 &point);
+
+  // Grows the box to hold another box
+  // @param box The other box
+  void add(const BoundingBox &box);
+
+  // Returns true if the box holds at least one point
+  // @returns True if the box holds at least one point
+  bool isValid() const;
+};
+
+// A rectangle of pixels
+struct ScreenRect {
+  // The bottom left corner
+  int x = 0;
+  int y = 0;
+
+  int width = 0;
+  int height = 0;
+
+  // Returns true if the rectangle holds no pixels
+  // @returns True if the rectangle holds no pixels
+  bool isEmpty() const;
+};
+
+// Where a box is compared to a frustum
+enum class Containment { Outside, Intersecting, Inside };
+
+/* The six planes of a view frustum, extracted from a projection matrix.
+ * Points inside have a positive distance to every plane. The planes are
+ * not normalized, since only the sign of the distance is used
+ */
+struct Frustum {
+  // Left, right, bottom, top, near and far. xyz is the normal, w the
+  // distance
+  glm::vec4 planes[6];
+
+  /* Extracts the planes of a matrix. Passing projection * view gives world
+   * space planes, and projection * view * model gives the planes in the
+   * model's space, so its boxes don't need to be transformed
+   * @param matrix The matrix
+   */
+  Frustum(const glm::mat4 &matrix);
+
+  /* Tests a single box against the planes
+   * @param box The box, in the same space as the planes
+   * @returns Whether the box is outside, partly inside or fully inside
+   */
+  Containment test(const BoundingBox &box) const;
+};
+
+/* Bounding boxes stored as a structure of arrays, so that several boxes
+ * are tested against a frustum at once with SSE or AVX
+ */
+class BoundsList {
+public:
+  // Removes every box
+  void clear();
+
+  // Adds a box
+  // @param box The box
+  void add(const BoundingBox &box);
+
+  // Returns the number of boxes
+  // @returns The number of boxes
+  size_t size() const;
+
+  /* Tests every box against a frustum. Boxes that intersect the frustum
+   * are visible, so boxes close to a corner can be kept even if they are
+   * outside of it
+   * @param frustum The frustum, in the same space as the boxes
+   * @param visible Set to 1 for visible boxes and 0 for culled ones
+   * @returns The number of visible boxes
+   */
+  size_t cull(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+  /* Tests a range of boxes against a frustum
+   * @param frustum The frustum, in the same space as the boxes
+   * @param visible Entries first to first + count are set to 1 for visible
+   * boxes and 0 for culled ones. Must hold at least first + count entries
+   * @param first The first box to test
+   * @param count The number of boxes to test
+   * @returns The number of visible boxes in the range
+   */
+  size_t cull(const Frustum &frustum, std::vector<uint8_t> &visible,
+              size_t first, size_t count) const;
+
+private:
+  std::vector<float> minX, minY, minZ;
+  std::vector<float> maxX, maxY, maxZ;
+};
+
+// The number of items checked and drawn by a cull
+struct CullStats {
+  size_t meshes = 0;
+  size_t visibleMeshes = 0;
+
+  size_t chunks = 0;
+  size_t visibleChunks = 0;
+
+  // Chunks inside the frustum that were hidden by occluders
+  size_t occludedChunks = 0;
+
+  // The meshlets of the visible chunks, and how many of them are inside
+  // the frustum and face the camera. Zero if meshlets were not culled
+  size_t meshlets = 0;
+  size_t visibleMeshlets = 0;
+
+  // Adds the counts of another cull
+  // @param other The other counts
+  void add(const CullStats &other);
+};
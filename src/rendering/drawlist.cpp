@@ -0,0 +1,79 @@
+#include "rendering/drawlist.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace std;
+
+bool DrawKey::operator<(const DrawKey &other) const {
+  return tie(this->textures[0], this->textures[1], this->textures[2],
+             this->arrays) < tie(other.textures[0], other.textures[1],
+                                 other.textures[2], other.arrays);
+}
+
+bool DrawKey::operator==(const DrawKey &other) const {
+  return !(*this < other) && !(other < *this);
+}
+
+void DrawList::clear() {
+  this->pending.clear();
+  this->commands.clear();
+  this->draws.clear();
+  this->materials.clear();
+  this->batches.clear();
+}
+
+uint32_t DrawList::addMaterial(const DrawMaterial &material) {
+  this->materials.push_back(material);
+  return (uint32_t)this->materials.size() - 1;
+}
+
+void DrawList::add(const DrawKey &key, const DrawCommand &command,
+                   const DrawData &data) {
+  this->pending.push_back(Pending{key, command, data});
+}
+
+void DrawList::build() {
+  // Draws with the same textures end up next to each other. Stable, so
+  // the order within a batch is the order the draws were added in
+  stable_sort(this->pending.begin(), this->pending.end(),
+              [](const Pending &a, const Pending &b) { return a.key < b.key; });
+
+  this->commands.clear();
+  this->draws.clear();
+  this->batches.clear();
+
+  this->commands.reserve(this->pending.size());
+  this->draws.reserve(this->pending.size());
+
+  for (auto &draw : this->pending) {
+    if (this->batches.empty() || !(this->batches.back().key == draw.key)) {
+      this->batches.push_back(DrawBatch{draw.key, this->commands.size(), 0});
+    }
+
+    // The base instance is the index of the draw's data
+    DrawCommand command = draw.command;
+    command.instanceCount = 1;
+    command.baseInstance = (uint32_t)this->draws.size();
+
+    this->commands.push_back(command);
+    this->draws.push_back(draw.data);
+    this->batches.back().count++;
+  }
+
+  this->pending.clear();
+}
+
+const vector<DrawCommand> &DrawList::getCommands() const {
+  return this->commands;
+}
+
+const vector<DrawData> &DrawList::getDraws() const { return this->draws; }
+
+const vector<DrawMaterial> &DrawList::getMaterials() const {
+  return this->materials;
+}
+
+const vector<DrawBatch> &DrawList::getBatches() const {
+  return this->batches;
+}
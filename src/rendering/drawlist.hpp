@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Builds the commands of indirect draws
+ *
+ * Every draw reads its model matrix and material from shader storage.
+ * The draw index is passed as the base instance of the command, which an
+ * instanced vertex attribute turns into the index of the draw
+ */
+
+// A single glMultiDrawElementsIndirect command. Matches
+// DrawElementsIndirectCommand
+struct DrawCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t baseVertex;
+  uint32_t baseInstance;
+};
+
+// Per draw data. Matches the std430 layout of Draw in the indirect shaders
+struct DrawData {
+  float model[16];
+  uint32_t material;
+  uint32_t padding[3];
+};
+
+// Per material data. Matches the std430 layout of Material in lighting.frag
+struct DrawMaterial {
+  float diffusedColor[4];
+  float specularColor[4];
+  float alphaValue;
+  uint32_t mask;
+
+  // Layers of the textures that are in texture arrays
+  float diffusedLayer;
+  float specularLayer;
+  float alphaLayer;
+
+  uint32_t padding[3];
+};
+
+// The textures a draw binds. Draws can only share a multi draw if they
+// bind the same textures
+struct DrawKey {
+  // Texture IDs of the diffuse, specular and alpha slots. Zero if unused
+  uint32_t textures[3];
+
+  // Bit n is set if slot n is a texture array
+  uint32_t arrays;
+
+  bool operator<(const DrawKey &other) const;
+  bool operator==(const DrawKey &other) const;
+};
+
+// Draws that are submitted with one multi draw
+struct DrawBatch {
+  DrawKey key;
+
+  // Range of the batch's commands
+  size_t first;
+  size_t count;
+};
+
+class DrawList {
+public:
+  // Removes every draw and material
+  void clear();
+
+  /* Adds a material
+   * @param material The material
+   * @returns The index of the material
+   */
+  uint32_t addMaterial(const DrawMaterial &material);
+
+  /* Adds a draw
+   * @param key The textures the draw binds
+   * @param command The index range to draw. instanceCount and baseInstance
+   * are filled in by build
+   * @param data The model matrix and material of the draw
+   */
+  void add(const DrawKey &key, const DrawCommand &command,
+           const DrawData &data);
+
+  // Sorts the draws by their textures and splits them into batches
+  void build();
+
+  // Returns the draw commands, in batch order. Valid after build
+  // @returns The draw commands
+  const std::vector<DrawCommand> &getCommands() const;
+
+  // Returns the per draw data, in the same order as the commands. Valid
+  // after build
+  // @returns The per draw data
+  const std::vector<DrawData> &getDraws() const;
+
+  // Returns the materials
+  // @returns The materials
+  const std::vector<DrawMaterial> &getMaterials() const;
+
+  // Returns the batches. Valid after build
+  // @returns The batches
+  const std::vector<DrawBatch> &getBatches() const;
+
+private:
+  struct Pending {
+    DrawKey key;
+    DrawCommand command;
+    DrawData data;
+  };
+
+  std::vector<Pending> pending;
+
+  std::vector<DrawCommand> commands;
+  std::vector<DrawData> draws;
+  std::vector<DrawMaterial> materials;
+  std::vector<DrawBatch> batches;
+};
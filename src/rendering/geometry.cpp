@@ -0,0 +1,248 @@
+#include "rendering/geometry.hpp"
+
+#include "helper/log.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+// The size of a vertex over all of the attribute buffers
+#define VERTEX_BYTES (sizeof(float) * (3 + 3 + 2 + 3))
+
+// The sizes the buffers start with
+#define INITIAL_VERTICES (64 * 1024)
+#define INITIAL_INDICES (192 * 1024)
+#define INITIAL_DRAWS 1024
+
+/* Copies data between buffers without changing the vertex array object or
+ * the array buffer binding
+ * @param from The buffer to copy from
+ * @param to The buffer to copy to
+ * @param size The number of bytes to copy from the start of the buffer
+ */
+static void copyBuffer(Buffer &from, Buffer &to, size_t size) {
+  glBindBuffer(GL_COPY_READ_BUFFER, from.getID());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, to.getID());
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+}
+
+/* Writes data into part of a buffer
+ * @param to The buffer to write to
+ * @param offset The byte offset to write at
+ * @param size The number of bytes to write
+ * @param data The data to write
+ */
+static void writeBuffer(Buffer &to, size_t offset, size_t size,
+                        const void *data) {
+  glBindBuffer(GL_COPY_WRITE_BUFFER, to.getID());
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+/* Creates a larger buffer holding the contents of an old one. Allocated
+ * ranges can be anywhere in the old buffer, so all of it is copied
+ * @param old The old buffer, or nullptr
+ * @param oldSize The size of the old buffer in bytes
+ * @param size The size of the new buffer in bytes
+ * @returns The new buffer
+ */
+template <typename T>
+static shared_ptr<T> resizeBuffer(shared_ptr<T> old, size_t oldSize,
+                                  size_t size) {
+  auto buffer = T::createImmutable(size, nullptr);
+
+  if (old && oldSize > 0) {
+    copyBuffer(*old, *buffer, oldSize);
+  }
+
+  return buffer;
+}
+
+GeometryBuffer::GeometryBuffer() {
+  this->grow(INITIAL_VERTICES, INITIAL_INDICES);
+  this->reserveDraws(INITIAL_DRAWS);
+}
+
+GeometryRange GeometryBuffer::add(const vector<float> &positions,
+                                  const vector<float> &normals,
+                                  const vector<float> &uvs,
+                                  const vector<float> &colors,
+                                  const vector<uint32_t> &indices) {
+  size_t vertices = positions.size() / 3;
+
+  GeometryRange range;
+
+  // Grow the pool until both ranges fit. Growing keeps the offsets of
+  // existing ranges, so only the failed allocation is retried
+  while (!this->vertexAllocator.allocate(vertices, range.vertices)) {
+    size_t capacity = this->vertexAllocator.getCapacity();
+    this->grow(capacity + max(capacity, vertices),
+               this->indexAllocator.getCapacity());
+  }
+
+  while (!this->indexAllocator.allocate(indices.size(), range.indices)) {
+    size_t capacity = this->indexAllocator.getCapacity();
+    this->grow(this->vertexAllocator.getCapacity(),
+               capacity + max(capacity, indices.size()));
+  }
+
+  range.firstVertex = (uint32_t)range.vertices.offset;
+  range.vertexCount = (uint32_t)vertices;
+  range.firstIndex = (uint32_t)range.indices.offset;
+  range.indexCount = (uint32_t)indices.size();
+
+  writeBuffer(*this->positions, range.firstVertex * sizeof(float) * 3,
+              positions.size() * sizeof(float), positions.data());
+  writeBuffer(*this->normals, range.firstVertex * sizeof(float) * 3,
+              normals.size() * sizeof(float), normals.data());
+  writeBuffer(*this->uvs, range.firstVertex * sizeof(float) * 2,
+              uvs.size() * sizeof(float), uvs.data());
+  writeBuffer(*this->colors, range.firstVertex * sizeof(float) * 3,
+              colors.size() * sizeof(float), colors.data());
+  writeBuffer(*this->indices, range.firstIndex * sizeof(uint32_t),
+              indices.size() * sizeof(uint32_t), indices.data());
+
+  return range;
+}
+
+void GeometryBuffer::remove(const GeometryRange &range) {
+  this->vertexAllocator.free(range.vertices);
+  this->indexAllocator.free(range.indices);
+}
+
+void GeometryBuffer::reserveDraws(size_t draws) {
+  if (draws <= this->drawCapacity) {
+    return;
+  }
+
+  this->drawCapacity = max(draws, this->drawCapacity * 2);
+
+  // Entry i holds i, so the base instance of a draw becomes its index
+  vector<uint32_t> values(this->drawCapacity);
+  iota(values.begin(), values.end(), 0);
+
+  glBindVertexArray(0);
+  this->drawIndices = BufferData::create(values.size() * sizeof(uint32_t),
+                                         values.data());
+
+  this->setupArrays();
+}
+
+void GeometryBuffer::bind() { this->vao->bind(); }
+
+void GeometryBuffer::unbind() { this->vao->unbind(); }
+
+void GeometryBuffer::bindPositions() { this->positionVao->bind(); }
+
+void GeometryBuffer::unbindPositions() { this->positionVao->unbind(); }
+
+RangeAllocator::Stats GeometryBuffer::getVertexStats() {
+  return this->vertexAllocator.getStats();
+}
+
+RangeAllocator::Stats GeometryBuffer::getIndexStats() {
+  return this->indexAllocator.getStats();
+}
+
+size_t GeometryBuffer::getBytesUsed() {
+  return this->vertexAllocator.getUsed() * VERTEX_BYTES +
+         this->indexAllocator.getUsed() * sizeof(uint32_t);
+}
+
+size_t GeometryBuffer::getBytesAllocated() {
+  return this->vertexAllocator.getCapacity() * VERTEX_BYTES +
+         this->indexAllocator.getCapacity() * sizeof(uint32_t);
+}
+
+shared_ptr<GeometryBuffer> GeometryBuffer::get() {
+  static weak_ptr<GeometryBuffer> shared;
+
+  auto geometry = shared.lock();
+  if (!geometry) {
+    geometry = shared_ptr<GeometryBuffer>(new GeometryBuffer);
+    shared = geometry;
+  }
+
+  return geometry;
+}
+
+void GeometryBuffer::grow(size_t vertices, size_t indices) {
+  // Creating the index buffer binds it, which would change the element
+  // buffer of a bound vertex array object
+  glBindVertexArray(0);
+
+  size_t oldVertices = this->vertexAllocator.getCapacity();
+  size_t oldIndices = this->indexAllocator.getCapacity();
+
+  if (vertices != oldVertices) {
+    this->positions = resizeBuffer(this->positions,
+                                   oldVertices * sizeof(float) * 3,
+                                   vertices * sizeof(float) * 3);
+    this->normals = resizeBuffer(this->normals,
+                                 oldVertices * sizeof(float) * 3,
+                                 vertices * sizeof(float) * 3);
+    this->uvs = resizeBuffer(this->uvs, oldVertices * sizeof(float) * 2,
+                             vertices * sizeof(float) * 2);
+    this->colors = resizeBuffer(this->colors,
+                                oldVertices * sizeof(float) * 3,
+                                vertices * sizeof(float) * 3);
+  }
+
+  if (indices != oldIndices) {
+    this->indices = resizeBuffer(this->indices, oldIndices * sizeof(uint32_t),
+                                 indices * sizeof(uint32_t));
+  }
+
+  if (oldVertices != 0) {
+    info("Geometry buffer grew to %zu vertices, %zu indices\n", vertices,
+         indices);
+  }
+
+  this->vertexAllocator.grow(vertices);
+  this->indexAllocator.grow(indices);
+
+  // The draw indices are created after the first grow
+  if (this->drawIndices) {
+    this->setupArrays();
+  }
+}
+
+void GeometryBuffer::setupArrays() {
+  this->vao = BufferArray::create();
+  this->vao->bind();
+
+  this->positions->bind();
+  this->vao->setAttribute(0, 3, GL_FLOAT, 0, 0);
+
+  this->normals->bind();
+  this->vao->setAttribute(1, 3, GL_FLOAT, 0, 0);
+
+  this->uvs->bind();
+  this->vao->setAttribute(4, 2, GL_FLOAT, 0, 0);
+
+  this->colors->bind();
+  this->vao->setAttribute(5, 3, GL_FLOAT, 0, 0);
+
+  this->drawIndices->bind();
+  this->vao->setAttributeI(6, 1, GL_UNSIGNED_INT, 0, 0);
+  this->vao->setDivisor(6, 1);
+
+  this->indices->bind();
+
+  this->vao->unbind();
+
+  // Position only data
+  this->positionVao = BufferArray::create();
+  this->positionVao->bind();
+
+  this->positions->bind();
+  this->positionVao->setAttribute(0, 3, GL_FLOAT, 0, 0);
+
+  this->drawIndices->bind();
+  this->positionVao->setAttributeI(6, 1, GL_UNSIGNED_INT, 0, 0);
+  this->positionVao->setDivisor(6, 1);
+
+  this->indices->bind();
+
+  this->positionVao->unbind();
+}
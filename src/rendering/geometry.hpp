@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "helper/allocator.hpp"
+#include "platform/buffer.hpp"
+#include "platform/opengl.hpp"
+
+// Where a mesh's vertices and indices are in a GeometryBuffer
+struct GeometryRange {
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+
+  // The ranges of the pool's allocators. Used to free the mesh
+  RangeAllocator::Allocation vertices;
+  RangeAllocator::Allocation indices;
+};
+
+/* Holds the vertices and indices of many meshes in one set of buffers, so
+ * they can be drawn with a single vertex array object and a multi draw.
+ * Vertex and index ranges are handed out by a RangeAllocator each, so the
+ * space of removed meshes is reused. The buffers use immutable storage and
+ * are replaced by larger ones when an allocation does not fit
+ *
+ * Attributes:
+ *   0 Position   vec3
+ *   1 Normal     vec3
+ *   4 UV         vec2
+ *   5 Color      vec3
+ *   6 Draw index uint, one per instance. Indirect draws pass the index of
+ *     their draw data as the base instance
+ */
+class GeometryBuffer {
+private:
+  // Creates empty buffers
+  GeometryBuffer();
+
+public:
+  /* Uploads a mesh. Must be called from the OpenGL thread
+   * @param positions Three floats per vertex
+   * @param normals Three floats per vertex
+   * @param uvs Two floats per vertex
+   * @param colors Three floats per vertex
+   * @param indices Three indices per triangle, relative to the mesh's first
+   * vertex
+   * @returns Where the mesh was put
+   */
+  GeometryRange add(const std::vector<float> &positions,
+                    const std::vector<float> &normals,
+                    const std::vector<float> &uvs,
+                    const std::vector<float> &colors,
+                    const std::vector<uint32_t> &indices);
+
+  /* Frees the space of a mesh so later meshes can use it
+   * @param range Where the mesh was put
+   */
+  void remove(const GeometryRange &range);
+
+  /* Makes sure the draw index attribute has an entry for every draw
+   * @param draws The number of draws
+   */
+  void reserveDraws(size_t draws);
+
+  // Binds the vertex array object with every attribute
+  void bind();
+  // Unbinds the vertex array object with every attribute
+  void unbind();
+
+  // Binds the vertex array object that only has positions
+  void bindPositions();
+  // Unbinds the vertex array object that only has positions
+  void unbindPositions();
+
+  // Returns the statistics of the vertex allocator, in vertices
+  // @returns The statistics of the vertex allocator
+  RangeAllocator::Stats getVertexStats();
+  // Returns the statistics of the index allocator, in indices
+  // @returns The statistics of the index allocator
+  RangeAllocator::Stats getIndexStats();
+
+  // Returns the number of bytes used by meshes
+  // @returns The number of bytes used by meshes
+  size_t getBytesUsed();
+  // Returns the size of the buffers in bytes
+  // @returns The size of the buffers in bytes
+  size_t getBytesAllocated();
+
+  // Returns the geometry buffer shared by every mesh. It is created when
+  // needed and freed when no mesh uses it
+  // @returns The shared geometry buffer
+  static std::shared_ptr<GeometryBuffer> get();
+
+private:
+  /* Moves the data into larger buffers
+   * @param vertices The number of vertices to make room for
+   * @param indices The number of indices to make room for
+   */
+  void grow(size_t vertices, size_t indices);
+
+  // Recreates the vertex array objects for the current buffers
+  void setupArrays();
+
+  std::shared_ptr<BufferArray> vao;
+  std::shared_ptr<BufferArray> positionVao;
+
+  std::shared_ptr<BufferData> positions;
+  std::shared_ptr<BufferData> normals;
+  std::shared_ptr<BufferData> uvs;
+  std::shared_ptr<BufferData> colors;
+  std::shared_ptr<BufferData> drawIndices;
+  std::shared_ptr<BufferIndex> indices;
+
+  RangeAllocator vertexAllocator;
+  RangeAllocator indexAllocator;
+
+  size_t drawCapacity = 0;
+};
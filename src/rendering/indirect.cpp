@@ -0,0 +1,93 @@
+#include "rendering/indirect.hpp"
+
+#include "rendering/geometry.hpp"
+
+using namespace std;
+
+// Shader storage binding points of the per draw data and materials
+#define DRAW_BUFFER_LOCATION 3
+#define MATERIAL_BUFFER_LOCATION 4
+
+IndirectDraw::IndirectDraw() {
+  this->draws = BufferStorage::create(GL_DYNAMIC_DRAW);
+  this->materials = BufferStorage::create(GL_DYNAMIC_DRAW);
+  this->commands = BufferIndirect::create();
+}
+
+void IndirectDraw::clear() { this->list.clear(); }
+
+void IndirectDraw::add(shared_ptr<Model> model) { model->addDraws(this->list); }
+
+void IndirectDraw::draw(shared_ptr<Shader> shader) {
+  this->list.build();
+
+  auto &commands = this->list.getCommands();
+  auto &draws = this->list.getDraws();
+  auto &materials = this->list.getMaterials();
+
+  if (commands.empty()) {
+    return;
+  }
+
+  shader->bind();
+
+  // Upload this frame's draws
+  this->draws->setData(draws.size() * sizeof(DrawData), draws.data());
+  this->draws->setLocation(DRAW_BUFFER_LOCATION);
+
+  this->materials->setData(materials.size() * sizeof(DrawMaterial),
+                           materials.data());
+  this->materials->setLocation(MATERIAL_BUFFER_LOCATION);
+
+  this->commands->setData(commands.size() * sizeof(DrawCommand),
+                          commands.data());
+
+  // Each texture slot has a unit for textures and one for texture arrays,
+  // since samplers of different types can't share a unit
+  const char *samplers[] = {"matDiffuse",      "matSpecular",
+                            "matAlpha",        "matDiffuseArray",
+                            "matSpecularArray", "matAlphaArray"};
+
+  for (int t = 0; t < 6; t++) {
+    if (shader->hasUniform(samplers[t])) {
+      shader->setUniformInt(samplers[t], t);
+    }
+  }
+
+  auto geometry = GeometryBuffer::get();
+  geometry->reserveDraws(draws.size());
+  geometry->bind();
+
+  this->commands->bind();
+
+  for (auto &batch : this->list.getBatches()) {
+    for (int slot = 0; slot < 3; slot++) {
+      GLuint texture = batch.key.textures[slot];
+
+      if (texture == 0) {
+        continue;
+      }
+
+      bool isArray = batch.key.arrays & (1 << slot);
+
+      glActiveTexture(GL_TEXTURE0 + slot + (isArray ? 3 : 0));
+      glBindTexture(isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+    }
+
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void *)(batch.first * sizeof(DrawCommand)), (GLsizei)batch.count,
+        sizeof(DrawCommand));
+  }
+
+  this->commands->unbind();
+  geometry->unbind();
+}
+
+size_t IndirectDraw::getDrawCount() {
+  return this->list.getCommands().size();
+}
+
+size_t IndirectDraw::getBatchCount() {
+  return this->list.getBatches().size();
+}
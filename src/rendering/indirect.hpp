@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+
+#include "platform/buffer.hpp"
+#include "platform/shader.hpp"
+#include "rendering/drawlist.hpp"
+#include "rendering/model.hpp"
+
+/* Draws many models with glMultiDrawElementsIndirect. The per draw data
+ * and materials are uploaded to shader storage, and every draw that binds
+ * the same textures is submitted with one multi draw. With texture arrays
+ * that is only a few multi draws for the whole scene
+ *
+ * The shader must read its model matrix and material from the buffers, as
+ * solid/indirect.vert and solid/indirect.frag do
+ */
+class IndirectDraw {
+private:
+  IndirectDraw();
+
+public:
+  // Removes every draw. Called before the models of a frame are added
+  void clear();
+
+  // Adds every mesh of a model
+  // @param model The model
+  void add(std::shared_ptr<Model> model);
+
+  /* Uploads the draws and submits them
+   * @param shader The shader to use when drawing
+   */
+  void draw(std::shared_ptr<Shader> shader);
+
+  // Returns the number of draws submitted by the last draw call
+  // @returns The number of draws
+  size_t getDrawCount();
+
+  // Returns the number of multi draws issued by the last draw call
+  // @returns The number of multi draws
+  size_t getBatchCount();
+
+  inline static auto create() {
+    return std::shared_ptr<IndirectDraw>(new IndirectDraw);
+  }
+
+private:
+  DrawList list;
+
+  std::shared_ptr<BufferStorage> draws;
+  std::shared_ptr<BufferStorage> materials;
+  std::shared_ptr<BufferIndirect> commands;
+};
@@ -0,0 +1,113 @@
+#include "rendering/loader.hpp"
+
+#include "helper/log.hpp"
+
+#include <chrono>
+
+using namespace std;
+
+AssetLoader::AssetLoader(size_t threads, bool textureArrays) {
+  this->pool = ThreadPool::create(threads);
+  this->textures = TextureQueue::create(this->pool);
+  this->buildPool = ThreadPool::create(threads);
+
+  if (textureArrays) {
+    this->textures->setBuckets(TextureBuckets::create());
+  }
+}
+
+AssetLoader::~AssetLoader() {
+  // The workers use this object and the texture queue, so they have to
+  // stop first
+  this->textures->cancel();
+  this->pool->stop();
+
+  // Parses that are still running wait for their builds
+  this->buildPool->stop();
+}
+
+shared_ptr<Model> AssetLoader::loadModel(const string &path,
+                                         const string &base) {
+  auto model = shared_ptr<Model>(new Model);
+
+  this->total++;
+
+  this->pool->submit([this, model, path, base] {
+    auto data = Model::parse(path, base, this->buildPool.get());
+    auto textures = data->getTextures();
+
+    this->total += data->meshes.size() + textures.size();
+    this->loaded++;
+
+    for (size_t i = 0; i < data->meshes.size(); i++) {
+      this->queueUpload([this, model, data, i] {
+        model->addMesh(*data, i);
+
+        // The vertex data is on the GPU now
+        data->meshes[i] = ModelData::MeshData{};
+
+        this->loaded++;
+      });
+    }
+
+    // Textures can arrive before the meshes that use them. The model
+    // applies them when the meshes are added
+    for (auto &[texture, usage] : textures) {
+      this->textures->load(
+          texture,
+          [this, model, texture = texture](shared_ptr<Texture> uploaded) {
+            model->setTexture(texture, uploaded);
+            this->loaded++;
+          },
+          usage);
+    }
+  });
+
+  return model;
+}
+
+void AssetLoader::update(double budget) {
+  auto start = chrono::steady_clock::now();
+
+  while (true) {
+    function<void()> upload;
+
+    {
+      lock_guard<mutex> lock(this->uploadLock);
+
+      if (this->uploads.empty()) {
+        break;
+      }
+
+      upload = move(this->uploads.front());
+      this->uploads.pop_front();
+    }
+
+    upload();
+
+    // Stop once the frame's budget is used up
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (elapsed.count() >= budget) {
+      return;
+    }
+  }
+
+  // Spend the rest of the budget on textures
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  this->textures->update(budget - elapsed.count());
+}
+
+bool AssetLoader::isLoading() { return this->loaded < this->total; }
+
+size_t AssetLoader::getLoaded() { return this->loaded; }
+
+size_t AssetLoader::getTotal() { return this->total; }
+
+shared_ptr<TextureQueue> AssetLoader::getTextureQueue() {
+  return this->textures;
+}
+
+void AssetLoader::queueUpload(function<void()> upload) {
+  lock_guard<mutex> lock(this->uploadLock);
+  this->uploads.push_back(move(upload));
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "helper/threadpool.hpp"
+#include "platform/texturequeue.hpp"
+#include "rendering/model.hpp"
+
+/* Loads models and textures in the background. Files are parsed and
+ * decoded on worker threads, while the OpenGL uploads are done on the
+ * OpenGL thread by update. Models can be drawn while they are loading.
+ * Meshes appear as they are uploaded and use their material's flat colors
+ * until their textures arrive
+ */
+class AssetLoader {
+private:
+  /* Starts the worker threads
+   * @param threads The number of worker threads. Zero uses one less than the
+   * number of hardware threads
+   * @param textureArrays Packs textures into texture arrays bucketed by
+   * size and format, so draws need fewer texture binds
+   */
+  AssetLoader(size_t threads = 0, bool textureArrays = false);
+
+public:
+  // Stops the worker threads. Unfinished work is dropped
+  ~AssetLoader();
+
+  /* Starts loading a model and its textures. Returns immediately
+   * @param path The model file path
+   * @param base The base folder to use when looking for the material file
+   * @returns The model. It has no meshes until update uploads them
+   */
+  std::shared_ptr<Model> loadModel(const std::string &path,
+                                   const std::string &base = "./");
+
+  /* Uploads finished work to the GPU. Must be called from the OpenGL
+   * thread. At least one upload is done each call
+   * @param budget The time in seconds to spend uploading
+   */
+  void update(double budget);
+
+  // Returns true if there is work that has not been uploaded
+  // @returns True if there is work that has not been uploaded
+  bool isLoading();
+
+  // Returns the number of finished items (model files, meshes, textures)
+  // @returns The number of finished items
+  size_t getLoaded();
+  // Returns the number of known items. This grows as model files are parsed
+  // @returns The number of known items
+  size_t getTotal();
+
+  // Returns the queue textures are decoded and uploaded with. It holds
+  // the texture load statistics
+  // @returns The texture queue
+  std::shared_ptr<TextureQueue> getTextureQueue();
+
+  /* Starts the worker threads
+   * @param threads The number of worker threads. Zero uses one less than the
+   * number of hardware threads
+   * @param textureArrays Packs textures into texture arrays bucketed by
+   * size and format, so draws need fewer texture binds
+   */
+  inline static auto create(size_t threads = 0, bool textureArrays = false) {
+    return std::shared_ptr<AssetLoader>(
+        new AssetLoader{threads, textureArrays});
+  }
+
+private:
+  // Queues work that has to be done on the OpenGL thread
+  // @param upload The work to do
+  void queueUpload(std::function<void()> upload);
+
+  std::shared_ptr<ThreadPool> pool;
+  std::shared_ptr<TextureQueue> textures;
+
+  // Builds the mesh hierarchies of every model being parsed. The parse
+  // waits for the build, so it can't be run on the pool it is waiting for
+  std::shared_ptr<ThreadPool> buildPool;
+
+  std::mutex uploadLock;
+  std::deque<std::function<void()>> uploads;
+
+  std::atomic<size_t> loaded{0};
+  std::atomic<size_t> total{0};
+};
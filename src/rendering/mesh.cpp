@@ -1,57 +1,200 @@
 #include "helper/log.hpp"
 #include "rendering/mesh.hpp"
 
+#include <algorithm>
+
 using namespace std;
 using namespace glm;
 
-#define USE_DIFFUSE_TEXTURE (1 << 0)
-#define USE_SPECULAR_TEXTURE (1 << 1)
-#define USE_ALPHA_TEXTURE (1 << 2)
+Mesh::Mesh(const vector<float> &positions, const vector<float> &normals,
+  const vector<float> &uvs, const vector<float> &colors,
+  const vector<uint32_t> &indices, const vector<Meshlet> &meshlets,
+  const vector<MeshLOD> &lods)
+    : meshlets(meshlets) {
 
-#define POSITION_OFFSET 0
-#define NORMAL_OFFSET 1
-#define UV_OFFSET 2
-#define COLOR_OFFSET 3
+  // The levels of detail use the same vertices, so their indices follow
+  // the full mesh's indices in the same range
+  this->lods.push_back(LODRange{0, (uint32_t)indices.size(), 0.0f});
 
-#define GET_POSITION(base) (base[POSITION_OFFSET])
-#define GET_NORMAL(base) (base[NORMAL_OFFSET])
-#define GET_UV(base) (base[UV_OFFSET])
-#define GET_COLOR(base) (base[COLOR_OFFSET])
+  vector<uint32_t> allIndices = indices;
+  for (auto &lod : lods) {
+    this->lods.push_back(LODRange{(uint32_t)allIndices.size(),
+                                  (uint32_t)lod.indices.size(), lod.error});
+    allIndices.insert(allIndices.end(), lod.indices.begin(),
+                      lod.indices.end());
+  }
 
-Mesh::Mesh(const vector<float> &positions, const vector<float> &normals,
-  const vector<float> &uvs, const vector<float> &colors) :
-  count(positions.size() / 3) {
+  // Upload model data
+  this->geometry = GeometryBuffer::get();
+  this->range =
+      this->geometry->add(positions, normals, uvs, colors, allIndices);
 
-  this->vao = BufferArray::create();
+  // Group the meshlets into chunks that are culled on their own. A chunk
+  // holds whole meshlets, so it can be a little smaller than the limit
+  const uint32_t chunkIndices = MESH_CHUNK_TRIANGLES * 3;
 
-  // Upload model data
-  this->vao->bind();
+  for (size_t m = 0; m < this->meshlets.size(); m++) {
+    auto &meshlet = this->meshlets[m];
+
+    if (this->chunks.empty() ||
+        this->chunks.back().indexCount + meshlet.indexCount > chunkIndices) {
+      MeshChunk chunk{};
+      chunk.firstIndex = meshlet.firstIndex;
+      chunk.firstMeshlet = (uint32_t)m;
+      this->chunks.push_back(chunk);
+    }
+
+    auto &chunk = this->chunks.back();
+    chunk.indexCount += meshlet.indexCount;
+    chunk.meshletCount++;
+
+    for (size_t i = meshlet.firstIndex;
+         i < meshlet.firstIndex + meshlet.indexCount; i++) {
+      const float *p = &positions[indices[i] * 3];
+      chunk.bounds.add(vec3(p[0], p[1], p[2]));
+    }
+  }
+
+  for (auto &chunk : this->chunks) {
+    this->bounds.add(chunk.bounds);
+  }
+}
+
+Mesh::~Mesh() { this->geometry->remove(this->range); }
+
+void Mesh::draw() { this->draw(0, this->meshlets.size()); }
+
+void Mesh::draw(size_t firstMeshlet, size_t meshletCount) {
+  DrawCommand command = this->getCommand(firstMeshlet, meshletCount);
+
+  // Draw
+  this->geometry->bind();
+
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+      (void *)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+
+  this->geometry->unbind();
+}
+
+void Mesh::draw(const vector<pair<size_t, size_t>> &runs) {
+  this->fillMultiDraw(runs);
+
+  // Draw
+  this->geometry->bind();
+
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, this->counts.data(),
+                                GL_UNSIGNED_INT, this->offsets.data(),
+                                (GLsizei)this->counts.size(),
+                                this->baseVertices.data());
+
+  this->geometry->unbind();
+}
+
+void Mesh::drawPositions() { this->drawPositions(0, this->meshlets.size()); }
+
+void Mesh::drawPositions(size_t firstMeshlet, size_t meshletCount) {
+  DrawCommand command = this->getCommand(firstMeshlet, meshletCount);
+
+  // Draw
+  this->geometry->bindPositions();
+
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+      (void *)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
 
-  // Position data
-  this->buffers[0] =
-      BufferData::create(sizeof(float) * positions.size(), positions.data());
-  this->vao->setAttribute(0, 3, GL_FLOAT, 0, 0);
+  this->geometry->unbindPositions();
+}
+
+void Mesh::drawPositions(const vector<pair<size_t, size_t>> &runs) {
+  this->fillMultiDraw(runs);
+
+  // Draw
+  this->geometry->bindPositions();
 
-  // Normal data
-  this->buffers[1] =
-      BufferData::create(sizeof(float) * normals.size(), normals.data());
-  this->vao->setAttribute(1, 3, GL_FLOAT, 0, 0);
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, this->counts.data(),
+                                GL_UNSIGNED_INT, this->offsets.data(),
+                                (GLsizei)this->counts.size(),
+                                this->baseVertices.data());
 
-  // UV data
-  this->buffers[2] = BufferData::create(sizeof(float) * uvs.size(), uvs.data());
-  this->vao->setAttribute(4, 2, GL_FLOAT, 0, 0);
+  this->geometry->unbindPositions();
+}
+
+void Mesh::fillMultiDraw(const vector<pair<size_t, size_t>> &runs) {
+  this->counts.clear();
+  this->offsets.clear();
+  this->baseVertices.clear();
 
-  // Color data
-  this->buffers[3] =
-      BufferData::create(sizeof(float) * colors.size(), colors.data());
-  this->vao->setAttribute(5, 3, GL_FLOAT, 0, 0);
+  for (auto &[first, count] : runs) {
+    DrawCommand command = this->getCommand(first, count);
+
+    this->counts.push_back((GLsizei)command.count);
+    this->offsets.push_back(
+        (const void *)(command.firstIndex * sizeof(uint32_t)));
+    this->baseVertices.push_back(command.baseVertex);
+  }
 }
 
-void Mesh::draw() {
+DrawCommand Mesh::getCommand() {
+  return this->getCommand(0, this->meshlets.size());
+}
+
+DrawCommand Mesh::getCommand(size_t firstMeshlet, size_t meshletCount) {
+  DrawCommand command{};
+  command.baseVertex = (int32_t)this->range.firstVertex;
+  command.firstIndex = this->range.firstIndex;
+
+  // Meshlets are stored in order, so a run of them is one range of indices
+  if (meshletCount > 0) {
+    auto &first = this->meshlets[firstMeshlet];
+    auto &last = this->meshlets[firstMeshlet + meshletCount - 1];
+
+    command.firstIndex += first.firstIndex;
+    command.count = last.firstIndex + last.indexCount - first.firstIndex;
+  }
+
+  return command;
+}
+
+const BoundingBox &Mesh::getBounds() { return this->bounds; }
+
+void Mesh::drawLOD(size_t lod) {
+  DrawCommand command = this->getLODCommand(lod);
+
+  // Draw
+  this->geometry->bind();
+
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+      (void *)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+
+  this->geometry->unbind();
+}
+
+void Mesh::drawLODPositions(size_t lod) {
+  DrawCommand command = this->getLODCommand(lod);
+
   // Draw
-  this->vao->bind();
+  this->geometry->bindPositions();
+
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+      (void *)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+
+  this->geometry->unbindPositions();
+}
+
+DrawCommand Mesh::getLODCommand(size_t lod) {
+  DrawCommand command{};
+  command.baseVertex = (int32_t)this->range.firstVertex;
+  command.firstIndex = this->range.firstIndex + this->lods[lod].firstIndex;
+  command.count = this->lods[lod].indexCount;
+
+  return command;
+}
+
+const vector<LODRange> &Mesh::getLODs() { return this->lods; }
 
-  glDrawArrays(GL_TRIANGLES, 0, this->count);
+const vector<MeshChunk> &Mesh::getChunks() { return this->chunks; }
 
-  this->vao->unbind();
-}
\ No newline at end of file
+const vector<Meshlet> &Mesh::getMeshlets() { return this->meshlets; }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -8,25 +10,144 @@
 #include "platform/opengl.hpp"
 #include "platform/shader.hpp"
 #include "platform/texture.hpp"
+#include "rendering/culling.hpp"
+#include "rendering/drawlist.hpp"
+#include "rendering/geometry.hpp"
+#include "rendering/meshlet.hpp"
+#include "rendering/simplify.hpp"
 
-// Manages vertex data
+// The most triangles in each culling chunk of a mesh
+#define MESH_CHUNK_TRIANGLES 512
+
+// A run of a mesh's meshlets that is culled on its own
+struct MeshChunk {
+  // The range of the chunk in the mesh's indices
+  uint32_t firstIndex;
+  uint32_t indexCount;
+
+  // The range of the chunk in the mesh's meshlets
+  uint32_t firstMeshlet;
+  uint32_t meshletCount;
+
+  BoundingBox bounds;
+};
+
+// Where a level of detail of a mesh is in its indices
+struct LODRange {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+
+  // How far the level may be from the full mesh, in model units
+  float error;
+};
+
+// Manages vertex data. The vertices and indices are stored in the shared
+// GeometryBuffer, so meshes can be drawn together with indirect draws
 class Mesh {
 private:
   Mesh(const std::vector<float> &positions, const std::vector<float> &normals,
-    const std::vector<float> &uvs, const std::vector<float> &colors);
+    const std::vector<float> &uvs, const std::vector<float> &colors,
+    const std::vector<uint32_t> &indices,
+    const std::vector<Meshlet> &meshlets, const std::vector<MeshLOD> &lods);
 
 public:
+  // Frees the mesh's space in the GeometryBuffer
+  ~Mesh();
+
   void draw();
 
+  /* Draws a run of meshlets
+   * @param firstMeshlet The first meshlet to draw
+   * @param meshletCount The number of meshlets to draw
+   */
+  void draw(size_t firstMeshlet, size_t meshletCount);
+
+  /* Draws several runs of meshlets with one multi draw
+   * @param runs The first meshlet and meshlet count of each run
+   */
+  void draw(const std::vector<std::pair<size_t, size_t>> &runs);
+
+  // Draws the mesh using only the position stream. Used for passes
+  // that do not need normals, UVs or colors (count and depth passes)
+  void drawPositions();
+
+  /* Draws a run of meshlets using only the position stream
+   * @param firstMeshlet The first meshlet to draw
+   * @param meshletCount The number of meshlets to draw
+   */
+  void drawPositions(size_t firstMeshlet, size_t meshletCount);
+
+  /* Draws several runs of meshlets with one multi draw, using only the
+   * position stream
+   * @param runs The first meshlet and meshlet count of each run
+   */
+  void drawPositions(const std::vector<std::pair<size_t, size_t>> &runs);
+
+  // Returns the indirect draw command of the mesh. instanceCount and
+  // baseInstance are left for the DrawList to fill in
+  // @returns The draw command
+  DrawCommand getCommand();
+
+  /* Returns the indirect draw command of a run of meshlets
+   * @param firstMeshlet The first meshlet to draw
+   * @param meshletCount The number of meshlets to draw
+   * @returns The draw command
+   */
+  DrawCommand getCommand(size_t firstMeshlet, size_t meshletCount);
+
+  // Draws a level of detail
+  // @param lod The level. Zero is the full mesh
+  void drawLOD(size_t lod);
+
+  // Draws a level of detail using only the position stream
+  // @param lod The level. Zero is the full mesh
+  void drawLODPositions(size_t lod);
+
+  // Returns the indirect draw command of a level of detail
+  // @param lod The level. Zero is the full mesh
+  // @returns The draw command
+  DrawCommand getLODCommand(size_t lod);
+
+  // Returns the levels of detail of the mesh. The first is the full mesh
+  // @returns The levels of detail
+  const std::vector<LODRange> &getLODs();
+
+  // Returns the bounds of the mesh in model space
+  // @returns The bounds of the mesh
+  const BoundingBox &getBounds();
+
+  // Returns the culling chunks of the mesh
+  // @returns The culling chunks
+  const std::vector<MeshChunk> &getChunks();
+
+  // Returns the meshlets of the mesh, in the order of the indices
+  // @returns The meshlets
+  const std::vector<Meshlet> &getMeshlets();
+
   inline static auto create(const std::vector<float> &positions, const std::vector<float> &normals,
-    const std::vector<float> &uvs, const std::vector<float> &colors) {
-    return std::shared_ptr<Mesh>(new Mesh{positions, normals, uvs, colors});
+    const std::vector<float> &uvs, const std::vector<float> &colors,
+    const std::vector<uint32_t> &indices,
+    const std::vector<Meshlet> &meshlets,
+    const std::vector<MeshLOD> &lods = {}) {
+    return std::shared_ptr<Mesh>(new Mesh{positions, normals, uvs, colors, indices, meshlets, lods});
   }
 
 private:
-  std::shared_ptr<BufferArray> vao;
+  /* Fills the arrays of a multi draw with runs of meshlets
+   * @param runs The first meshlet and meshlet count of each run
+   */
+  void fillMultiDraw(const std::vector<std::pair<size_t, size_t>> &runs);
+
+  std::shared_ptr<GeometryBuffer> geometry;
+  GeometryRange range;
+
+  BoundingBox bounds;
+  std::vector<MeshChunk> chunks;
+  std::vector<Meshlet> meshlets;
+  std::vector<LODRange> lods;
 
-  // Holds buffers. Position, Normal, UV, and Color
-  std::array<std::shared_ptr<BufferData>, 4> buffers;
-  const GLsizei count;
-};
\ No newline at end of file
+  // Reused by the multi draws
+  std::vector<GLsizei> counts;
+  std::vector<const void *> offsets;
+  std::vector<GLint> baseVertices;
+};
@@ -0,0 +1,315 @@
+#include "rendering/meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#define USE_AVX2
+#endif
+
+using namespace std;
+using namespace glm;
+
+/* Finds the bounding sphere and normal cone of a range of triangles
+ * @param positions Three floats per vertex
+ * @param indices Three indices per triangle
+ * @param first The first triangle
+ * @param end One past the last triangle
+ * @returns The meshlet
+ */
+static Meshlet finishMeshlet(const vector<float> &positions,
+                             const vector<uint32_t> &indices, size_t first,
+                             size_t end) {
+  Meshlet meshlet{};
+  meshlet.firstIndex = (uint32_t)(first * 3);
+  meshlet.indexCount = (uint32_t)((end - first) * 3);
+
+  auto corner = [&](size_t i) {
+    const float *p = &positions[indices[i] * 3];
+    return vec3(p[0], p[1], p[2]);
+  };
+
+  size_t firstIndex = first * 3, endIndex = end * 3;
+
+  // The sphere is centered on the bounding box. It is a little larger than
+  // the smallest sphere, but cheap to find
+  BoundingBox box;
+  for (size_t i = firstIndex; i < endIndex; i++) {
+    box.add(corner(i));
+  }
+
+  meshlet.center = (box.min + box.max) * 0.5f;
+
+  float radius = 0.0f;
+  for (size_t i = firstIndex; i < endIndex; i++) {
+    radius = std::max(radius, length(corner(i) - meshlet.center));
+  }
+
+  meshlet.radius = radius;
+
+  // The cone is around the average normal, and is wide enough to hold the
+  // normal of every triangle. Degenerate triangles have no facing
+  vector<vec3> normals;
+  normals.reserve(end - first);
+
+  vec3 sum = vec3(0.0f);
+  for (size_t i = firstIndex; i < endIndex; i += 3) {
+    vec3 a = corner(i), b = corner(i + 1), c = corner(i + 2);
+    vec3 normal = cross(b - a, c - a);
+
+    float area = length(normal);
+    if (area > 0.0f) {
+      normals.push_back(normal / area);
+      sum += normal / area;
+    }
+  }
+
+  meshlet.coneCutoff = 1.0f;
+
+  float sumLength = length(sum);
+  if (sumLength < 1e-6f) {
+    return meshlet;
+  }
+
+  meshlet.coneAxis = sum / sumLength;
+
+  float minDot = 1.0f;
+  for (auto &normal : normals) {
+    minDot = std::min(minDot, dot(normal, meshlet.coneAxis));
+  }
+
+  // A cone wider than a hemisphere always has a triangle facing the camera
+  if (minDot > 0.0f) {
+    meshlet.coneCutoff = sqrt(1.0f - minDot * minDot);
+  }
+
+  return meshlet;
+}
+
+vector<Meshlet> buildMeshlets(const vector<float> &positions,
+                              const vector<uint32_t> &indices) {
+  vector<Meshlet> meshlets;
+
+  // The meshlet each vertex was last added to
+  vector<uint32_t> added(positions.size() / 3, UINT32_MAX);
+
+  size_t triangles = indices.size() / 3;
+  size_t first = 0;
+  size_t vertices = 0;
+  uint32_t current = 0;
+
+  auto countNew = [&](size_t triangle) {
+    const uint32_t *corners = &indices[triangle * 3];
+    size_t count = 0;
+
+    for (int v = 0; v < 3; v++) {
+      bool repeated = (v > 0 && corners[v] == corners[0]) ||
+                      (v > 1 && corners[v] == corners[1]);
+
+      if (!repeated && added[corners[v]] != current) {
+        count++;
+      }
+    }
+
+    return count;
+  };
+
+  // Triangles are added in order until one no longer fits
+  for (size_t t = 0; t < triangles; t++) {
+    size_t fresh = countNew(t);
+
+    if (t > first && (vertices + fresh > MESHLET_MAX_VERTICES ||
+                      t - first >= MESHLET_MAX_TRIANGLES)) {
+      meshlets.push_back(finishMeshlet(positions, indices, first, t));
+
+      current++;
+      first = t;
+      vertices = 0;
+      fresh = countNew(t);
+    }
+
+    for (int v = 0; v < 3; v++) {
+      added[indices[t * 3 + v]] = current;
+    }
+
+    vertices += fresh;
+  }
+
+  if (first < triangles) {
+    meshlets.push_back(finishMeshlet(positions, indices, first, triangles));
+  }
+
+  return meshlets;
+}
+
+void MeshletList::clear() {
+  this->centerX.clear();
+  this->centerY.clear();
+  this->centerZ.clear();
+  this->radius.clear();
+  this->axisX.clear();
+  this->axisY.clear();
+  this->axisZ.clear();
+  this->cutoff.clear();
+}
+
+void MeshletList::add(const Meshlet &meshlet) {
+  this->centerX.push_back(meshlet.center.x);
+  this->centerY.push_back(meshlet.center.y);
+  this->centerZ.push_back(meshlet.center.z);
+  this->radius.push_back(meshlet.radius);
+  this->axisX.push_back(meshlet.coneAxis.x);
+  this->axisY.push_back(meshlet.coneAxis.y);
+  this->axisZ.push_back(meshlet.coneAxis.z);
+  this->cutoff.push_back(meshlet.coneCutoff);
+}
+
+size_t MeshletList::size() const { return this->centerX.size(); }
+
+size_t MeshletList::cull(const Frustum &frustum, const vec3 &camera,
+                         vector<uint8_t> &visible, size_t first,
+                         size_t count) const {
+  // Spheres need the true distance to each plane, so the planes are
+  // normalized first
+  vec4 planes[6];
+  for (int p = 0; p < 6; p++) {
+    planes[p] = frustum.planes[p] / length(vec3(frustum.planes[p]));
+  }
+
+  size_t end = first + count;
+
+  size_t visibleCount = 0;
+  size_t i = first;
+
+  // A meshlet is visible if its sphere is not behind any plane and the
+  // camera is not inside the region its cone faces away from
+#ifdef USE_AVX2
+  __m256 cameraX = _mm256_set1_ps(camera.x);
+  __m256 cameraY = _mm256_set1_ps(camera.y);
+  __m256 cameraZ = _mm256_set1_ps(camera.z);
+
+  for (; i + 8 <= end; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&this->centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&this->centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&this->centerZ[i]);
+    __m256 r = _mm256_loadu_ps(&this->radius[i]);
+    __m256 negativeR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (auto &plane : planes) {
+      __m256 distance = _mm256_set1_ps(plane.w);
+      distance = _mm256_add_ps(distance,
+                               _mm256_mul_ps(_mm256_set1_ps(plane.x), cx));
+      distance = _mm256_add_ps(distance,
+                               _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+      distance = _mm256_add_ps(distance,
+                               _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+
+      inside = _mm256_and_ps(inside,
+                             _mm256_cmp_ps(distance, negativeR, _CMP_GE_OQ));
+    }
+
+    __m256 dx = _mm256_sub_ps(cx, cameraX);
+    __m256 dy = _mm256_sub_ps(cy, cameraY);
+    __m256 dz = _mm256_sub_ps(cz, cameraZ);
+
+    __m256 along = _mm256_mul_ps(dx, _mm256_loadu_ps(&this->axisX[i]));
+    along = _mm256_add_ps(along,
+                          _mm256_mul_ps(dy, _mm256_loadu_ps(&this->axisY[i])));
+    along = _mm256_add_ps(along,
+                          _mm256_mul_ps(dz, _mm256_loadu_ps(&this->axisZ[i])));
+
+    __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+        _mm256_mul_ps(dz, dz)));
+
+    __m256 limit = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(&this->cutoff[i]), distance), r);
+
+    inside = _mm256_andnot_ps(_mm256_cmp_ps(along, limit, _CMP_GE_OQ), inside);
+
+    int mask = _mm256_movemask_ps(inside);
+    for (int j = 0; j < 8; j++) {
+      visible[i + j] = (mask >> j) & 1;
+      visibleCount += (mask >> j) & 1;
+    }
+  }
+#endif
+
+#ifdef USE_SSE2
+  __m128 cameraX4 = _mm_set1_ps(camera.x);
+  __m128 cameraY4 = _mm_set1_ps(camera.y);
+  __m128 cameraZ4 = _mm_set1_ps(camera.z);
+
+  for (; i + 4 <= end; i += 4) {
+    __m128 cx = _mm_loadu_ps(&this->centerX[i]);
+    __m128 cy = _mm_loadu_ps(&this->centerY[i]);
+    __m128 cz = _mm_loadu_ps(&this->centerZ[i]);
+    __m128 r = _mm_loadu_ps(&this->radius[i]);
+    __m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (auto &plane : planes) {
+      __m128 distance = _mm_set1_ps(plane.w);
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.x), cx));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeR));
+    }
+
+    __m128 dx = _mm_sub_ps(cx, cameraX4);
+    __m128 dy = _mm_sub_ps(cy, cameraY4);
+    __m128 dz = _mm_sub_ps(cz, cameraZ4);
+
+    __m128 along = _mm_mul_ps(dx, _mm_loadu_ps(&this->axisX[i]));
+    along = _mm_add_ps(along, _mm_mul_ps(dy, _mm_loadu_ps(&this->axisY[i])));
+    along = _mm_add_ps(along, _mm_mul_ps(dz, _mm_loadu_ps(&this->axisZ[i])));
+
+    __m128 distance = _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+        _mm_mul_ps(dz, dz)));
+
+    __m128 limit =
+        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&this->cutoff[i]), distance), r);
+
+    inside = _mm_andnot_ps(_mm_cmpge_ps(along, limit), inside);
+
+    int mask = _mm_movemask_ps(inside);
+    for (int j = 0; j < 4; j++) {
+      visible[i + j] = (mask >> j) & 1;
+      visibleCount += (mask >> j) & 1;
+    }
+  }
+#endif
+
+  for (; i < end; i++) {
+    vec3 center = vec3(this->centerX[i], this->centerY[i], this->centerZ[i]);
+    vec3 axis = vec3(this->axisX[i], this->axisY[i], this->axisZ[i]);
+
+    bool inside = true;
+
+    for (auto &plane : planes) {
+      inside = inside &&
+               dot(vec3(plane), center) + plane.w >= -this->radius[i];
+    }
+
+    vec3 direction = center - camera;
+    bool facingAway = dot(direction, axis) >=
+                      this->cutoff[i] * length(direction) + this->radius[i];
+
+    bool shown = inside && !facingAway;
+    visible[i] = shown ? 1 : 0;
+    visibleCount += shown ? 1 : 0;
+  }
+
+  return visibleCount;
+}
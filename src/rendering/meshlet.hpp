@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "rendering/culling.hpp"
+
+// The most vertices and triangles a meshlet can hold
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+/* A small run of a mesh's triangles with bounds tight enough to cull it on
+ * its own. Besides a bounding sphere it has a cone holding the normals of
+ * its triangles, so meshlets whose triangles all face away from the camera
+ * are skipped before back-face culling would throw them away on the GPU
+ */
+struct Meshlet {
+  // The range of the meshlet in the mesh's indices
+  uint32_t firstIndex;
+  uint32_t indexCount;
+
+  glm::vec3 center;
+  float radius;
+
+  // The average normal of the triangles. The meshlet faces away from the
+  // camera if dot(center - camera, axis) >= cutoff * |center - camera| +
+  // radius. The cutoff is 1 if the normals are too spread out to ever cull
+  glm::vec3 coneAxis;
+  float coneCutoff;
+};
+
+/* Splits a mesh's triangles into meshlets. Triangles are not reordered, so
+ * each meshlet is a range of the indices. Triangles next to each other
+ * should be close in space, as they are after sorting them with a BVH
+ * @param positions Three floats per vertex
+ * @param indices Three indices per triangle
+ * @returns The meshlets, in the order of the indices
+ */
+std::vector<Meshlet> buildMeshlets(const std::vector<float> &positions,
+                                   const std::vector<uint32_t> &indices);
+
+/* The bounds and cones of meshlets stored as a structure of arrays, so
+ * that several meshlets are tested at once with SSE or AVX
+ */
+class MeshletList {
+public:
+  // Removes every meshlet
+  void clear();
+
+  // Adds a meshlet
+  // @param meshlet The meshlet
+  void add(const Meshlet &meshlet);
+
+  // Returns the number of meshlets
+  // @returns The number of meshlets
+  size_t size() const;
+
+  /* Tests a range of meshlets against a frustum and their cones against
+   * the camera position
+   * @param frustum The frustum, in the same space as the meshlets
+   * @param camera The camera position, in the same space as the meshlets
+   * @param visible Entries first to first + count are set to 1 for visible
+   * meshlets and 0 for culled ones. Must hold at least first + count
+   * entries
+   * @param first The first meshlet to test
+   * @param count The number of meshlets to test
+   * @returns The number of visible meshlets in the range
+   */
+  size_t cull(const Frustum &frustum, const glm::vec3 &camera,
+              std::vector<uint8_t> &visible, size_t first,
+              size_t count) const;
+
+private:
+  std::vector<float> centerX, centerY, centerZ, radius;
+  std::vector<float> axisX, axisY, axisZ, cutoff;
+};
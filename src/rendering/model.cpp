@@ -2,9 +2,18 @@
 #include <tiny_obj_loader.hpp>
 
 #include "helper/log.hpp"
+#include "helper/threadpool.hpp"
+#include "platform/texturequeue.hpp"
 #include "rendering/model.hpp"
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
 #include <map>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
 
@@ -12,7 +21,61 @@ using namespace tinyobj;
 using namespace std;
 using namespace glm;
 
-Model::Model(const string &path, const string &base) {
+// Identifies a unique vertex of a material. Faces that share a vertex
+// share its index
+struct VertexKey {
+  int vertex;
+  int normal;
+  int uv;
+
+  bool operator==(const VertexKey &other) const {
+    return this->vertex == other.vertex && this->normal == other.normal &&
+           this->uv == other.uv;
+  }
+};
+
+struct VertexKeyHash {
+  size_t operator()(const VertexKey &key) const {
+    size_t hash = (size_t)key.vertex * 73856093u;
+    hash ^= (size_t)key.normal * 19349663u;
+    hash ^= (size_t)key.uv * 83492791u;
+    return hash;
+  }
+};
+
+/* Builds the hierarchy of a mesh's triangles, and puts the triangles in the
+ * order of its leaves. The chunks the mesh is culled in are runs of
+ * triangles, so this makes each chunk cover a small part of the model
+ * @param mesh The mesh
+ * @param pool Builds large subtrees in parallel
+ */
+static void buildTriangleTree(ModelData::MeshData &mesh, ThreadPool *pool) {
+  size_t triangles = mesh.indices.size() / 3;
+
+  vector<BoundingBox> boxes(triangles);
+  for (size_t t = 0; t < triangles; t++) {
+    for (size_t v = 0; v < 3; v++) {
+      const float *p = &mesh.positions[mesh.indices[t * 3 + v] * 3];
+      boxes[t].add(vec3(p[0], p[1], p[2]));
+    }
+  }
+
+  mesh.bvh.build(boxes, 4, pool);
+
+  auto &order = mesh.bvh.getOrder();
+  vector<uint32_t> sorted(mesh.indices.size());
+
+  for (size_t t = 0; t < triangles; t++) {
+    for (size_t v = 0; v < 3; v++) {
+      sorted[t * 3 + v] = mesh.indices[order[t] * 3 + v];
+    }
+  }
+
+  mesh.indices = move(sorted);
+}
+
+shared_ptr<ModelData> Model::parse(const string &path, const string &base,
+                                   ThreadPool *pool) {
   info("Loading model: %s\n", path.c_str());
 
   // Adapted from
@@ -43,11 +106,11 @@ Model::Model(const string &path, const string &base) {
   unordered_map<int, vector<float>> normals;
   unordered_map<int, vector<float>> uvs;
   unordered_map<int, vector<float>> colors;
-  unordered_map<int, Material> mats;
+  unordered_map<int, vector<uint32_t>> indices;
+  unordered_map<int, unordered_map<VertexKey, uint32_t, VertexKeyHash>>
+      vertices;
 
-  unordered_map<string, shared_ptr<Texture>> diffuseTextures;
-  unordered_map<string, shared_ptr<Texture>> specularTextures;
-  unordered_map<string, shared_ptr<Texture>> alphaTextures;
+  auto data = make_shared<ModelData>();
 
   bool hasUVs = attrib.texcoords.size() != 0;
   bool hasColors = attrib.colors.size() != 0;
@@ -66,6 +129,20 @@ Model::Model(const string &path, const string &base) {
 
         int mat = shapes[s].mesh.material_ids[f];
 
+        // Reuse the vertex if the material already has it
+        auto &known = vertices[mat];
+        VertexKey key{idx.vertex_index, idx.normal_index, idx.texcoord_index};
+
+        auto found = known.find(key);
+        if (found != known.end()) {
+          indices[mat].push_back(found->second);
+          continue;
+        }
+
+        uint32_t vertex = (uint32_t)known.size();
+        known.emplace(key, vertex);
+        indices[mat].push_back(vertex);
+
         auto &pos = positions[mat];
         auto &norm = normals[mat];
         auto &uv = uvs[mat];
@@ -105,68 +182,249 @@ Model::Model(const string &path, const string &base) {
     }
   }
 
-  // Unpack and process material data
+  // The lookup is only needed while unpacking
+  vertices.clear();
+
+  double buildTime = 0.0;
+  double simplifyTime = 0.0;
+
+  // Unpack material data
   info("Material count: %i\n", materials.size());
   for (size_t mat = 0; mat < materials.size(); mat++) {
-    auto m = materials[mat];
+    auto &m = materials[mat];
+    ModelData::MaterialData material;
 
-    // Unpack texture data
-    string diffuseTexture = m.diffuse_texname;
-    string specularTexture = m.specular_texname;
-    string alphaTexture = m.alpha_texname;
+    // Texture paths are relative to the base folder
+    if (!m.diffuse_texname.empty()) {
+      material.diffused = base + m.diffuse_texname;
+    }
 
-    // See if the textures exists and if it needs to be
-    // uploaded to the GPU
+    if (!m.specular_texname.empty()) {
+      material.specular = base + m.specular_texname;
+    }
 
-    // Texture exists and needs to be uploaded
+    if (!m.alpha_texname.empty()) {
+      material.alpha = base + m.alpha_texname;
+    }
 
-    mats[mat] = Material{};
+    for (size_t c = 0; c < 3; c++) {
+      material.diffusedColor[c] = m.diffuse[c];
+      material.specularColor[c] = m.specular[c];
+    }
 
-    // Diffused
-    if (!diffuseTexture.empty()) {
-      if (diffuseTextures.find(diffuseTexture) == diffuseTextures.end()) {
-        diffuseTextures[diffuseTexture] = Texture::create(base + diffuseTexture);
-      }
-      mats[mat].diffused = diffuseTextures[diffuseTexture];
-      mats[mat].mask |= Material::MASK_USE_DIFFUSED;
-    } else {
-      mats[mat].diffusedColor.values[0] = m.diffuse[0];
-      mats[mat].diffusedColor.values[1] = m.diffuse[1];
-      mats[mat].diffusedColor.values[2] = m.diffuse[2];
+    material.alphaValue = m.dissolve;
+
+    data->materials.push_back(material);
+
+    // Each material get's it's own mesh. Vertices without a material
+    // are not drawn
+    if (positions[mat].empty()) {
+      continue;
     }
 
-    // Specular
-    if (!specularTexture.empty()) {
-      if (specularTextures.find(specularTexture) == specularTextures.end()) {
-        specularTextures[specularTexture] = Texture::create(base + specularTexture);
+    ModelData::MeshData mesh;
+    mesh.positions = move(positions[mat]);
+    mesh.normals = move(normals[mat]);
+    mesh.uvs = move(uvs[mat]);
+    mesh.colors = move(colors[mat]);
+    mesh.indices = move(indices[mat]);
+    mesh.material = mat;
+
+    auto start = chrono::steady_clock::now();
+    buildTriangleTree(mesh, pool);
+    mesh.meshlets = buildMeshlets(mesh.positions, mesh.indices);
+    buildTime += chrono::duration<double>(chrono::steady_clock::now() - start)
+                     .count();
+
+    // The levels are simplified from the sorted triangles, which keeps
+    // their triangles close in space too
+    start = chrono::steady_clock::now();
+    mesh.lods = buildLODs(mesh.positions, mesh.indices);
+    simplifyTime +=
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (!mesh.lods.empty()) {
+      string counts = to_string(mesh.indices.size() / 3);
+      for (auto &lod : mesh.lods) {
+        counts += ", " + to_string(lod.indices.size() / 3);
       }
-      mats[mat].specular = specularTextures[specularTexture];
-      mats[mat].mask |= Material::MASK_USE_SPECULAR;
-    } else {
-      mats[mat].specularColor.values[0] = m.specular[0];
-      mats[mat].specularColor.values[1] = m.specular[1];
-      mats[mat].specularColor.values[2] = m.specular[2];
+
+      info("LOD triangles of material %zu: %s\n", mat, counts.c_str());
     }
 
-    // Alpha
-    if (!alphaTexture.empty()) {
-      if (alphaTextures.find(alphaTexture) == alphaTextures.end()) {
-        alphaTextures[alphaTexture] = Texture::create(base + alphaTexture);
+    data->meshes.push_back(move(mesh));
+  }
+
+  info("Built triangle hierarchies and meshlets in %.1f ms\n",
+       buildTime * 1000.0);
+  info("Simplified levels of detail in %.1f ms\n", simplifyTime * 1000.0);
+
+  return data;
+}
+
+map<string, TextureUsage> ModelData::getTextures() const {
+  map<string, TextureUsage> textures;
+
+  for (auto &material : this->materials) {
+    for (auto &texture : {material.diffused, material.specular}) {
+      if (!texture.empty()) {
+        textures[texture] = TextureUsage::Color;
       }
-      mats[mat].alpha = alphaTextures[alphaTexture];
-      mats[mat].mask |= Material::MASK_USE_ALPHA;
-    } else {
-      mats[mat].alphaValue = m.dissolve;
     }
   }
 
-  // Create meshes
-  for (auto [i, m] : mats) {
-    auto mesh = Mesh::create(positions[i], normals[i], uvs[i], colors[i]);
+  for (auto &material : this->materials) {
+    if (!material.alpha.empty()) {
+      textures.emplace(material.alpha, TextureUsage::Alpha);
+    }
+  }
+
+  return textures;
+}
+
+Model::Model() {}
+
+Model::Model(const string &path, const string &base) {
+  // The hierarchies are built and the textures decoded on the same threads
+  auto pool = ThreadPool::create();
+  auto data = Model::parse(path, base, pool.get());
+
+  for (size_t i = 0; i < data->meshes.size(); i++) {
+    this->addMesh(*data, i);
+  }
+
+  // Decode the textures in parallel and upload them as they finish. Each
+  // texture is only loaded once, even if it is used by several materials
+  // or texture slots
+  auto queue = TextureQueue::create(pool);
+
+  for (auto &[texture, usage] : data->getTextures()) {
+    queue->load(
+        texture,
+        [this, texture = texture](shared_ptr<Texture> uploaded) {
+          this->setTexture(texture, uploaded);
+        },
+        usage);
+  }
+
+  queue->finish();
+}
+
+void Model::addMesh(const ModelData &data, size_t mesh) {
+  auto &m = data.meshes[mesh];
+  auto &source = data.materials[m.material];
+
+  // Until the textures are set, the material's colors are used
+  Material material{};
+
+  for (size_t c = 0; c < 3; c++) {
+    material.diffusedColor.values[c] = source.diffusedColor[c];
+    material.specularColor.values[c] = source.specularColor[c];
+  }
+
+  material.alphaValue = source.alphaValue;
+
+  auto uploaded = Mesh::create(m.positions, m.normals, m.uvs, m.colors,
+                               m.indices, m.meshlets, m.lods);
+
+  // The mesh's chunks follow the chunks of the meshes before it
+  this->firstChunks.push_back(this->chunkBoxes.size());
+  for (auto &chunk : uploaded->getChunks()) {
+    this->chunkBoxes.push_back(chunk.bounds);
+    this->chunkMeshes.push_back((uint32_t)this->meshes.size());
+  }
+
+  this->firstMeshlets.push_back(this->meshletBounds.size());
+  for (auto &meshlet : uploaded->getMeshlets()) {
+    this->meshletBounds.add(meshlet);
+  }
+
+  // Nothing added since the last cull is known to be culled
+  this->isCulled = false;
+  this->isMeshletCulled = false;
+  this->chunkTreeDirty = true;
+
+  this->shapes.push_back(Shape{m.positions, m.indices, m.bvh});
+
+  this->meshes.push_back(uploaded);
+  this->meshLODs.push_back(0);
+  this->materials.push_back(material);
+  this->materialSources.push_back(source);
+  this->drawOrderDirty = true;
+
+  // Use any textures that were uploaded before the mesh
+  for (auto &[path, texture] : this->textures) {
+    this->applyTexture(this->materials.size() - 1, path, texture);
+  }
+}
+
+void Model::setTexture(const string &path, shared_ptr<Texture> texture) {
+  this->textures[path] = texture;
+
+  for (size_t i = 0; i < this->materials.size(); i++) {
+    this->applyTexture(i, path, texture);
+  }
+}
+
+void Model::applyTexture(size_t material, const string &path,
+                         shared_ptr<Texture> texture) {
+  auto &mat = this->materials[material];
+  auto &source = this->materialSources[material];
+  bool isArray = texture->getArray() != nullptr;
+
+  if (source.diffused == path) {
+    mat.diffused = texture;
+    mat.mask |= Material::MASK_USE_DIFFUSED;
+
+    if (isArray) {
+      mat.mask |= Material::MASK_DIFFUSED_ARRAY;
+    }
+  }
+
+  if (source.specular == path) {
+    mat.specular = texture;
+    mat.mask |= Material::MASK_USE_SPECULAR;
+
+    if (isArray) {
+      mat.mask |= Material::MASK_SPECULAR_ARRAY;
+    }
+  }
+
+  if (source.alpha == path) {
+    mat.alpha = texture;
+    mat.mask |= Material::MASK_USE_ALPHA;
 
-    this->meshes.push_back(mesh);
-    this->materials.push_back(m);
+    if (isArray) {
+      mat.mask |= Material::MASK_ALPHA_ARRAY;
+    }
   }
+
+  this->drawOrderDirty = true;
+}
+
+void Model::sortDrawOrder() {
+  auto getID = [](const shared_ptr<Texture> &texture) {
+    return texture ? texture->getID() : 0;
+  };
+
+  this->drawOrder.resize(this->meshes.size());
+  for (size_t i = 0; i < this->drawOrder.size(); i++) {
+    this->drawOrder[i] = i;
+  }
+
+  // The transparency is order independent, so the order can be anything
+  sort(this->drawOrder.begin(), this->drawOrder.end(),
+       [&](size_t a, size_t b) {
+         auto &ma = this->materials[a];
+         auto &mb = this->materials[b];
+
+         return make_tuple(getID(ma.diffused), getID(ma.specular),
+                           getID(ma.alpha)) <
+                make_tuple(getID(mb.diffused), getID(mb.specular),
+                           getID(mb.alpha));
+       });
+
+  this->drawOrderDirty = false;
 }
 
 void Model::draw(std::shared_ptr<Shader> shader) {
@@ -176,16 +434,75 @@ void Model::draw(std::shared_ptr<Shader> shader) {
   mat4 M = this->transform.getMatrix();
   shader->setUniformMatrix("M", M);
 
-  for (size_t i = 0; i < meshes.size(); i++) {
-    int t = 0;
+  // Passes that only need positions skip the material setup and use the
+  // position only stream
+  if (shader->usesOnlyPosition()) {
+    for (size_t i = 0; i < this->meshes.size(); i++) {
+      auto &visible = this->getVisibleRuns(i);
+
+      if (visible.empty()) {
+        continue;
+      }
+
+      if (this->meshLODs[i] > 0) {
+        this->meshes[i]->drawLODPositions(this->meshLODs[i]);
+      } else {
+        this->meshes[i]->drawPositions(visible);
+      }
+    }
+
+    return;
+  }
+
+  // Each texture slot has a unit for textures and one for texture arrays,
+  // since samplers of different types can't share a unit
+  const char *samplers[] = {"matDiffuse",      "matSpecular",
+                            "matAlpha",        "matDiffuseArray",
+                            "matSpecularArray", "matAlphaArray"};
+
+  for (int t = 0; t < 6; t++) {
+    if (shader->hasUniform(samplers[t])) {
+      shader->setUniformInt(samplers[t], t);
+    }
+  }
+
+  if (this->drawOrderDirty) {
+    this->sortDrawOrder();
+  }
+
+  // The texture bound to each unit. Meshes that share textures or texture
+  // arrays don't bind them again
+  GLuint bound[6] = {};
+
+  auto bindTexture = [&](shared_ptr<Texture> &texture, int slot,
+                         const char *layerName) {
+    int unit = slot;
+
+    if (texture->getArray()) {
+      unit += 3;
+
+      if (shader->hasUniform(layerName)) {
+        shader->setUniformFloat(layerName, (float)texture->getLayer());
+      }
+    }
+
+    if (bound[unit] != texture->getID()) {
+      texture->bind(unit);
+      bound[unit] = texture->getID();
+    }
+  };
+
+  for (size_t i : this->drawOrder) {
     auto &mesh = this->meshes[i];
     auto &mat = this->materials[i];
 
+    auto &visible = this->getVisibleRuns(i);
+    if (visible.empty()) {
+      continue;
+    }
+
     if (mat.mask & Material::MASK_USE_DIFFUSED) {
-      if (shader->hasUniform("matDiffuse")) {
-        shader->setUniformInt("matDiffuse", t);
-      }
-      mat.diffused->bind(t++);
+      bindTexture(mat.diffused, 0, "matDiffuseLayer");
     } else {
       if (shader->hasUniform("matDiffuseColor")) {
         shader->setUniformVec3("matDiffuseColor", { mat.diffusedColor.r, mat.diffusedColor.g, mat.diffusedColor.b });
@@ -193,10 +510,7 @@ void Model::draw(std::shared_ptr<Shader> shader) {
     }
 
     if (mat.mask & Material::MASK_USE_SPECULAR) {
-      if (shader->hasUniform("matSpecular")) {
-        shader->setUniformInt("matSpecular", t);
-      }
-      mat.specular->bind(t++);
+      bindTexture(mat.specular, 1, "matSpecularLayer");
     } else {
       if (shader->hasUniform("matSpecularColor")) {
         shader->setUniformVec3("matSpecularColor", { mat.specularColor.r, mat.specularColor.g, mat.specularColor.b });
@@ -204,10 +518,7 @@ void Model::draw(std::shared_ptr<Shader> shader) {
     }
 
     if (mat.mask & Material::MASK_USE_ALPHA) {
-      if (shader->hasUniform("matAlpha")) {
-        shader->setUniformInt("matAlpha", t);
-      }
-      mat.alpha->bind(t++);
+      bindTexture(mat.alpha, 2, "matAlphaLayer");
     } else {
       if (shader->hasUniform("matAlphaValue")) {
         shader->setUniformFloat("matAlphaValue", mat.alphaValue);
@@ -218,6 +529,490 @@ void Model::draw(std::shared_ptr<Shader> shader) {
       shader->setUniformUInt("matMask", mat.mask);
     }
 
-    mesh->draw();
+    if (shader->hasUniform("matIndex")) {
+      shader->setUniformUInt("matIndex", i);
+    }
+
+    if (this->meshLODs[i] > 0) {
+      mesh->drawLOD(this->meshLODs[i]);
+    } else {
+      mesh->draw(visible);
+    }
   }
-}
\ No newline at end of file
+}
+
+void Model::addDraws(DrawList &list) {
+  auto getID = [](const shared_ptr<Texture> &texture) {
+    return texture ? (uint32_t)texture->getID() : 0u;
+  };
+
+  auto getLayer = [](const shared_ptr<Texture> &texture) {
+    return texture ? (float)texture->getLayer() : 0.0f;
+  };
+
+  DrawData data{};
+  mat4 M = this->transform.getMatrix();
+  memcpy(data.model, value_ptr(M), sizeof(data.model));
+
+  for (size_t i = 0; i < this->meshes.size(); i++) {
+    auto &mat = this->materials[i];
+
+    auto &visible = this->getVisibleRuns(i);
+    if (visible.empty()) {
+      continue;
+    }
+
+    DrawMaterial material{};
+
+    for (size_t c = 0; c < 3; c++) {
+      material.diffusedColor[c] = mat.diffusedColor.values[c];
+      material.specularColor[c] = mat.specularColor.values[c];
+    }
+
+    material.alphaValue = mat.alphaValue;
+    material.mask = mat.mask;
+    material.diffusedLayer = getLayer(mat.diffused);
+    material.specularLayer = getLayer(mat.specular);
+    material.alphaLayer = getLayer(mat.alpha);
+
+    DrawKey key{};
+    key.textures[0] = getID(mat.diffused);
+    key.textures[1] = getID(mat.specular);
+    key.textures[2] = getID(mat.alpha);
+    key.arrays = ((mat.mask & Material::MASK_DIFFUSED_ARRAY) ? 1 : 0) |
+                 ((mat.mask & Material::MASK_SPECULAR_ARRAY) ? 2 : 0) |
+                 ((mat.mask & Material::MASK_ALPHA_ARRAY) ? 4 : 0);
+
+    data.material = list.addMaterial(material);
+
+    if (this->meshLODs[i] > 0) {
+      list.add(key, this->meshes[i]->getLODCommand(this->meshLODs[i]), data);
+      continue;
+    }
+
+    for (auto &[first, count] : visible) {
+      list.add(key, this->meshes[i]->getCommand(first, count), data);
+    }
+  }
+}
+
+void Model::cull(const mat4 &PV) {
+  // The frustum is moved into model space instead of moving every box
+  // into world space
+  Frustum frustum(PV * this->transform.getMatrix());
+
+  if (this->chunkTreeDirty) {
+    this->chunkTree.build(this->chunkBoxes);
+
+    this->chunkBounds.clear();
+    for (uint32_t chunk : this->chunkTree.getOrder()) {
+      this->chunkBounds.add(this->chunkBoxes[chunk]);
+    }
+
+    this->chunkTreeDirty = false;
+  }
+
+  this->cullStats = CullStats{};
+  this->cullStats.chunks = this->chunkBoxes.size();
+  this->cullStats.visibleChunks =
+      this->chunkTree.cull(frustum, this->chunkBounds, this->visibleNodes);
+  this->isCulled = true;
+  this->isMeshletCulled = false;
+
+  // Back from the tree's order to the order of the chunks
+  auto &order = this->chunkTree.getOrder();
+  this->visibleChunks.resize(order.size());
+
+  for (size_t i = 0; i < order.size(); i++) {
+    this->visibleChunks[order[i]] = this->visibleNodes[i];
+  }
+
+  this->cullStats.meshes = this->meshes.size();
+  this->cullStats.visibleMeshes = this->countVisibleMeshes();
+}
+
+void Model::addOccluders(OcclusionBuffer &buffer, const mat4 &PV,
+                         size_t budget) {
+  mat4 PVM = PV * this->transform.getMatrix();
+
+  // The screen area of each visible chunk
+  vector<pair<int, size_t>> candidates;
+
+  for (size_t c = 0; c < this->chunkBoxes.size(); c++) {
+    if (this->isCulled && !this->visibleChunks[c]) {
+      continue;
+    }
+
+    // Chunks reaching past the near plane would mostly be skipped by the
+    // buffer anyway
+    OcclusionRect rect;
+    if (!buffer.projectBox(this->chunkBoxes[c], PVM, rect) ||
+        rect.minX > rect.maxX || rect.minY > rect.maxY) {
+      continue;
+    }
+
+    int area = (rect.maxX - rect.minX + 1) * (rect.maxY - rect.minY + 1);
+    candidates.emplace_back(area, c);
+  }
+
+  sort(candidates.begin(), candidates.end(),
+       [](auto &a, auto &b) { return a.first > b.first; });
+
+  size_t triangles = 0;
+
+  for (auto &[area, c] : candidates) {
+    uint32_t mesh = this->chunkMeshes[c];
+    auto &chunk = this->meshes[mesh]->getChunks()[c - this->firstChunks[mesh]];
+
+    if (triangles + chunk.indexCount / 3 > budget) {
+      break;
+    }
+
+    auto &shape = this->shapes[mesh];
+    buffer.addOccluders(shape.positions, shape.indices, chunk.firstIndex,
+                        chunk.indexCount, PVM);
+
+    triangles += chunk.indexCount / 3;
+  }
+}
+
+void Model::cullOcclusion(const OcclusionBuffer &buffer, const mat4 &PV) {
+  mat4 PVM = PV * this->transform.getMatrix();
+
+  // Hidden chunks stay hidden until the next cull, so without one the
+  // chunks can't be tested
+  if (!this->isCulled) {
+    return;
+  }
+
+  size_t occluded = 0;
+
+  for (size_t c = 0; c < this->chunkBoxes.size(); c++) {
+    if (this->visibleChunks[c] && !buffer.isVisible(this->chunkBoxes[c], PVM)) {
+      this->visibleChunks[c] = 0;
+      occluded++;
+    }
+  }
+
+  this->cullStats.occludedChunks = occluded;
+  this->cullStats.visibleChunks -= occluded;
+  this->cullStats.meshes = this->meshes.size();
+  this->cullStats.visibleMeshes = this->countVisibleMeshes();
+}
+
+void Model::cullMeshlets(const mat4 &PV, const vec3 &camera,
+                         ThreadPool *pool) {
+  if (!this->isCulled) {
+    return;
+  }
+
+  // Both the frustum and the camera are moved into model space
+  mat4 M = this->transform.getMatrix();
+  Frustum frustum(PV * M);
+  vec3 localCamera = vec3(inverse(M) * vec4(camera, 1.0f));
+
+  // Only the meshlets of visible chunks are tested. A chunk's meshlets
+  // are next to each other, so each chunk is one range
+  this->meshletRanges.clear();
+  size_t tested = 0;
+
+  for (size_t c = 0; c < this->chunkBoxes.size(); c++) {
+    if (!this->visibleChunks[c]) {
+      continue;
+    }
+
+    uint32_t mesh = this->chunkMeshes[c];
+    auto &chunk = this->meshes[mesh]->getChunks()[c - this->firstChunks[mesh]];
+
+    this->meshletRanges.emplace_back(
+        this->firstMeshlets[mesh] + chunk.firstMeshlet, chunk.meshletCount);
+    tested += chunk.meshletCount;
+  }
+
+  this->visibleMeshlets.assign(this->meshletBounds.size(), 0);
+
+  // Each task culls a share of the ranges. Tasks write to different
+  // meshlets, so they don't need locks
+  size_t threads = pool ? pool->getThreadCount() : 1;
+  size_t tasks = std::min(this->meshletRanges.size(),
+                          std::max(threads, (size_t)1));
+  size_t rangesPerTask =
+      tasks > 0 ? (this->meshletRanges.size() + tasks - 1) / tasks : 0;
+
+  vector<size_t> visibleCounts(tasks, 0);
+
+  for (size_t task = 0; task < tasks; task++) {
+    auto cullRanges = [this, &frustum, &localCamera, &visibleCounts, task,
+                       rangesPerTask] {
+      size_t first = task * rangesPerTask;
+      size_t last = std::min(first + rangesPerTask, this->meshletRanges.size());
+
+      for (size_t r = first; r < last; r++) {
+        auto &[firstMeshlet, count] = this->meshletRanges[r];
+        visibleCounts[task] += this->meshletBounds.cull(
+            frustum, localCamera, this->visibleMeshlets, firstMeshlet, count);
+      }
+    };
+
+    if (pool && tasks > 1) {
+      pool->submit(cullRanges);
+    } else {
+      cullRanges();
+    }
+  }
+
+  if (pool && tasks > 1) {
+    pool->wait();
+  }
+
+  this->isMeshletCulled = true;
+
+  this->cullStats.meshlets = tested;
+  this->cullStats.visibleMeshlets = 0;
+  for (size_t count : visibleCounts) {
+    this->cullStats.visibleMeshlets += count;
+  }
+
+  this->cullStats.visibleMeshes = this->countVisibleMeshes();
+}
+
+void Model::selectLODs(Camera &camera, int screenHeight, float maxError) {
+  mat4 M = this->transform.getMatrix();
+
+  // Errors are in model units, so they are scaled into world units
+  float scale = std::max(std::max(length(vec3(M[0])), length(vec3(M[1]))),
+                         length(vec3(M[2])));
+
+  this->lodStats = LODStats{};
+
+  for (size_t i = 0; i < this->meshes.size(); i++) {
+    auto &mesh = this->meshes[i];
+    auto &lods = mesh->getLODs();
+
+    // The distance to the closest point of the sphere around the mesh
+    auto &bounds = mesh->getBounds();
+    vec3 center = vec3(M * vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+    float radius = length(bounds.max - bounds.min) * 0.5f * scale;
+    float distance = std::max(
+        length(center - camera.transform.position) - radius, 0.0f);
+
+    float allowed = maxError * camera.getPixelSize(distance, screenHeight);
+
+    size_t chosen = 0;
+    for (size_t lod = lods.size() - 1; lod > 0; lod--) {
+      if (lods[lod].error * scale <= allowed) {
+        chosen = lod;
+        break;
+      }
+    }
+
+    this->meshLODs[i] = (uint8_t)chosen;
+
+    auto &visible = this->getVisibleRuns(i);
+    if (visible.empty()) {
+      continue;
+    }
+
+    size_t fullIndices = 0;
+    for (auto &[first, count] : visible) {
+      fullIndices += mesh->getCommand(first, count).count;
+    }
+
+    this->lodStats.meshes[chosen]++;
+    this->lodStats.fullTriangles += fullIndices / 3;
+    this->lodStats.triangles +=
+        (chosen > 0 ? lods[chosen].indexCount : fullIndices) / 3;
+  }
+}
+
+LODStats Model::getLODStats() { return this->lodStats; }
+
+ScreenRect Model::getScreenRect(const mat4 &PV, int width, int height) {
+  mat4 PVM = PV * this->transform.getMatrix();
+
+  vec2 minimum(INFINITY);
+  vec2 maximum(-INFINITY);
+  bool isBehind = false;
+
+  auto addBox = [&](const BoundingBox &box) {
+    for (int c = 0; c < 8; c++) {
+      vec3 corner((c & 1) ? box.max.x : box.min.x,
+                  (c & 2) ? box.max.y : box.min.y,
+                  (c & 4) ? box.max.z : box.min.z);
+
+      // Corners behind the camera don't project to the screen, so the box
+      // may cover any pixel
+      vec4 clip = PVM * vec4(corner, 1.0f);
+      if (clip.w <= 1e-5f) {
+        isBehind = true;
+        return;
+      }
+
+      minimum = glm::min(minimum, vec2(clip) / clip.w);
+      maximum = glm::max(maximum, vec2(clip) / clip.w);
+    }
+  };
+
+  for (size_t i = 0; i < this->meshes.size(); i++) {
+    if (this->getVisibleRuns(i).empty()) {
+      continue;
+    }
+
+    // Simplified levels are drawn whole, and their triangles can span
+    // chunks, so only the mesh's bounds hold them
+    if (!this->isCulled || this->meshLODs[i] > 0) {
+      addBox(this->meshes[i]->getBounds());
+      continue;
+    }
+
+    auto &chunks = this->meshes[i]->getChunks();
+    for (size_t c = 0; c < chunks.size(); c++) {
+      if (this->visibleChunks[this->firstChunks[i] + c]) {
+        addBox(chunks[c].bounds);
+      }
+    }
+  }
+
+  if (isBehind) {
+    return ScreenRect{0, 0, width, height};
+  }
+
+  if (minimum.x > 1.0f || minimum.y > 1.0f || maximum.x < -1.0f ||
+      maximum.y < -1.0f) {
+    return ScreenRect{};
+  }
+
+  minimum = glm::clamp(minimum, vec2(-1.0f), vec2(1.0f));
+  maximum = glm::clamp(maximum, vec2(-1.0f), vec2(1.0f));
+
+  // Rounded outwards with a pixel to spare, so that rasterization rules
+  // never put a covered pixel outside
+  int minX = std::max((int)floor((minimum.x * 0.5f + 0.5f) * width) - 1, 0);
+  int minY = std::max((int)floor((minimum.y * 0.5f + 0.5f) * height) - 1, 0);
+  int maxX = std::min((int)ceil((maximum.x * 0.5f + 0.5f) * width) + 1, width);
+  int maxY =
+      std::min((int)ceil((maximum.y * 0.5f + 0.5f) * height) + 1, height);
+
+  return ScreenRect{minX, minY, maxX - minX, maxY - minY};
+}
+
+void LODStats::add(const LODStats &other) {
+  for (size_t lod = 0; lod <= MESH_LOD_LEVELS; lod++) {
+    this->meshes[lod] += other.meshes[lod];
+  }
+
+  this->triangles += other.triangles;
+  this->fullTriangles += other.fullTriangles;
+}
+
+CullStats Model::getCullStats() { return this->cullStats; }
+
+vector<vec4> Model::getSpecularColors() {
+  vector<vec4> colors;
+  colors.reserve(this->materials.size());
+
+  for (auto &material : this->materials) {
+    auto &color = material.specularColor;
+    colors.push_back(vec4(color.r, color.g, color.b, 0.0f));
+  }
+
+  return colors;
+}
+
+size_t Model::countVisibleMeshes() {
+  size_t visible = 0;
+
+  for (size_t i = 0; i < this->meshes.size(); i++) {
+    if (!this->getVisibleRuns(i).empty()) {
+      visible++;
+    }
+  }
+
+  return visible;
+}
+
+bool Model::raycast(const vec3 &origin, const vec3 &direction,
+                    float &distance) {
+  // Move the ray into model space. Distances are in multiples of the
+  // direction, so they don't change
+  mat4 inverseM = inverse(this->transform.getMatrix());
+  vec3 localOrigin = vec3(inverseM * vec4(origin, 1.0f));
+  vec3 localDirection = vec3(inverseM * vec4(direction, 0.0f));
+
+  bool hit = false;
+
+  for (auto &shape : this->shapes) {
+    auto &positions = shape.positions;
+    auto &indices = shape.indices;
+
+    auto corner = [&](uint32_t triangle, int v) {
+      const float *p = &positions[indices[triangle * 3 + v] * 3];
+      return vec3(p[0], p[1], p[2]);
+    };
+
+    hit = shape.bvh.raycast(localOrigin, localDirection, distance,
+                            [&](uint32_t triangle, float &closest) {
+                              return hitTriangle(
+                                  localOrigin, localDirection,
+                                  corner(triangle, 0), corner(triangle, 1),
+                                  corner(triangle, 2), closest);
+                            }) ||
+          hit;
+  }
+
+  return hit;
+}
+
+const vector<pair<size_t, size_t>> &Model::getVisibleRuns(size_t mesh) {
+  auto &chunks = this->meshes[mesh]->getChunks();
+  size_t meshlets = this->meshes[mesh]->getMeshlets().size();
+
+  this->runs.clear();
+
+  if (!this->isCulled) {
+    if (meshlets > 0) {
+      this->runs.emplace_back(0, meshlets);
+    }
+
+    return this->runs;
+  }
+
+  // Neighbouring visible meshlets are drawn with one draw
+  auto addRun = [this](size_t first, size_t count) {
+    if (!this->runs.empty() &&
+        this->runs.back().first + this->runs.back().second == first) {
+      this->runs.back().second += count;
+    } else {
+      this->runs.emplace_back(first, count);
+    }
+  };
+
+  const uint8_t *visible =
+      this->visibleChunks.data() + this->firstChunks[mesh];
+  const uint8_t *visibleMeshlets =
+      this->isMeshletCulled
+          ? this->visibleMeshlets.data() + this->firstMeshlets[mesh]
+          : nullptr;
+
+  for (size_t c = 0; c < chunks.size(); c++) {
+    if (!visible[c]) {
+      continue;
+    }
+
+    auto &chunk = chunks[c];
+
+    if (!visibleMeshlets) {
+      addRun(chunk.firstMeshlet, chunk.meshletCount);
+      continue;
+    }
+
+    for (size_t m = chunk.firstMeshlet;
+         m < chunk.firstMeshlet + chunk.meshletCount; m++) {
+      if (visibleMeshlets[m]) {
+        addRun(m, 1);
+      }
+    }
+  }
+
+  return this->runs;
+}
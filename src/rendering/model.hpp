@@ -1,7 +1,10 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
@@ -9,11 +12,83 @@
 #include "platform/opengl.hpp"
 #include "platform/shader.hpp"
 #include "platform/texture.hpp"
+#include "rendering/bvh.hpp"
+#include "rendering/camera.hpp"
+#include "rendering/culling.hpp"
+#include "rendering/drawlist.hpp"
+#include "rendering/meshlet.hpp"
+#include "rendering/occlusion.hpp"
+#include "rendering/simplify.hpp"
 #include "rendering/transform.hpp"
 #include "rendering/mesh.hpp"
 
+// Model data read from a file that has not been uploaded to the GPU yet
+struct ModelData {
+  struct MeshData {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<float> colors;
+
+    // Three indices per triangle. Vertices shared by triangles are only
+    // stored once. The triangles are in the order of the leaves of bvh,
+    // so triangles next to each other are close in space
+    std::vector<uint32_t> indices;
+
+    // A hierarchy over the triangles. Position i of its order is
+    // triangle i
+    BVH bvh;
+
+    // The triangles split into meshlets
+    std::vector<Meshlet> meshlets;
+
+    // Simplified levels of the triangles, from the most detailed
+    std::vector<MeshLOD> lods;
+
+    // Index into materials
+    size_t material;
+  };
+
+  struct MaterialData {
+    // Texture paths. Empty if the material does not use the texture
+    std::string diffused;
+    std::string specular;
+    std::string alpha;
+
+    float diffusedColor[3];
+    float specularColor[3];
+    float alphaValue;
+  };
+
+  std::vector<MeshData> meshes;
+  std::vector<MaterialData> materials;
+
+  /* Returns every texture used by the materials, without duplicates. A
+   * texture used for color anywhere is loaded as a color texture
+   * @returns The texture paths and what they are used for
+   */
+  std::map<std::string, TextureUsage> getTextures() const;
+};
+
+// The levels of detail chosen by a LOD selection
+struct LODStats {
+  // The number of visible meshes drawn at each level
+  size_t meshes[MESH_LOD_LEVELS + 1] = {};
+
+  // The triangles drawn, and the triangles the full meshes would draw
+  size_t triangles = 0;
+  size_t fullTriangles = 0;
+
+  // Adds the counts of another selection
+  // @param other The other counts
+  void add(const LODStats &other);
+};
+
 class Model {
 private:
+  // Creates an empty model. Meshes and textures are added later
+  Model();
+
   /* Creates a model from a file
    * @param path The model file path
    * @param base The base folder to use when looking for the material file
@@ -21,10 +96,111 @@ private:
   Model(const std::string &path, const std::string &base = "./");
 
 public:
-  // Draws the model using the given shader
-  // @param shader The shader to use when drawing
+  /* Draws the model using the given shader. If the shader only reads
+   * vertex positions, materials are skipped and the position only
+   * stream is used
+   * @param shader The shader to use when drawing
+   */
   void draw(std::shared_ptr<Shader> shader);
 
+  /* Adds a draw and a material for every mesh to an indirect draw list
+   * @param list The draw list
+   */
+  void addDraws(DrawList &list);
+
+  /* Tests the chunks of every mesh against the view frustum. Until this
+   * is called again, draw and addDraws only draw the visible chunks
+   * @param PV The camera's perspective * view matrix
+   */
+  void cull(const glm::mat4 &PV);
+
+  /* Adds the triangles of the visible chunks that cover the most of the
+   * screen to an occlusion buffer
+   * @param buffer The occlusion buffer
+   * @param PV The camera's perspective * view matrix
+   * @param budget The most triangles to add
+   */
+  void addOccluders(OcclusionBuffer &buffer, const glm::mat4 &PV,
+                    size_t budget);
+
+  /* Hides the visible chunks that are behind the occluders of a rendered
+   * occlusion buffer. Call after cull, since the chunks outside of the
+   * frustum aren't tested again
+   * @param buffer The occlusion buffer
+   * @param PV The camera's perspective * view matrix
+   */
+  void cullOcclusion(const OcclusionBuffer &buffer, const glm::mat4 &PV);
+
+  /* Tests the meshlets of the visible chunks against the view frustum and
+   * hides the ones that face away from the camera. Call after cull and
+   * cullOcclusion. The model's scale must be the same on every axis, or
+   * the normal cones don't hold
+   * @param PV The camera's perspective * view matrix
+   * @param camera The camera position in world space
+   * @param pool If not nullptr, the meshlets are split between its
+   * threads
+   */
+  void cullMeshlets(const glm::mat4 &PV, const glm::vec3 &camera,
+                    ThreadPool *pool = nullptr);
+
+  /* Picks the level of detail of each mesh. The coarsest level whose error
+   * covers at most maxError pixels at the mesh's closest point is used.
+   * Meshes drawn with a simplified level are not culled by chunk or
+   * meshlet, only as a whole. Call after culling
+   * @param camera The camera
+   * @param screenHeight The height of the screen in pixels
+   * @param maxError The most pixels a level's error may cover
+   */
+  void selectLODs(Camera &camera, int screenHeight, float maxError);
+
+  // Returns the levels chosen by the last LOD selection
+  // @returns The levels chosen by the last LOD selection
+  LODStats getLODStats();
+
+  /* Finds the pixels the model may cover from the bounds of what draw
+   * would draw. Call after culling and LOD selection
+   * @param PV The camera's perspective * view matrix
+   * @param width The width of the screen in pixels
+   * @param height The height of the screen in pixels
+   * @returns The rectangle. Empty if nothing is drawn, and the whole screen
+   * if the bounds reach behind the camera
+   */
+  ScreenRect getScreenRect(const glm::mat4 &PV, int width, int height);
+
+  // Returns the counts of the last cull
+  // @returns The counts of the last cull
+  CullStats getCullStats();
+
+  /* Returns the flat specular color of each material, in the order draw
+   * numbers them with matIndex. Specular textures are not included
+   * @returns The colors. The fourth component is unused
+   */
+  std::vector<glm::vec4> getSpecularColors();
+
+  /* Finds the closest triangle of the model hit by a ray
+   * @param origin The start of the ray in world space
+   * @param direction The direction of the ray in world space. Distances
+   * are in multiples of its length
+   * @param distance The furthest distance to look at. Set to the distance
+   * of the hit, if there is one
+   * @returns True if a triangle was hit
+   */
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               float &distance);
+
+  /* Reads a model and material file. The loader runs this on its own
+   * threads, so it must not use OpenGL
+   * @param path The model file path
+   * @param base The base folder to use when looking for the material file
+   * @param pool If not nullptr, large parts of the mesh hierarchies are
+   * built on its threads. Each build waits for the pool, so it can't be the
+   * pool parse is running on
+   * @returns The model data
+   */
+  static std::shared_ptr<ModelData> parse(const std::string &path,
+                                          const std::string &base = "./",
+                                          ThreadPool *pool = nullptr);
+
   Transform transform;
 
   /* Creates a model from a file
@@ -36,6 +212,30 @@ public:
   }
 
 private:
+  friend class AssetLoader;
+
+  /* Uploads a mesh. If its textures have not been set yet, the mesh
+   * uses the material's flat colors until setTexture is called
+   * @param data The model data that holds the mesh
+   * @param mesh The index of the mesh in data
+   */
+  void addMesh(const ModelData &data, size_t mesh);
+
+  /* Sets a texture on every material that uses the given path, including
+   * the materials of meshes that are added later
+   * @param path The texture path
+   * @param texture The uploaded texture
+   */
+  void setTexture(const std::string &path, std::shared_ptr<Texture> texture);
+
+  /* Sets a texture on a material if the material uses the given path
+   * @param material The index of the material
+   * @param path The texture path
+   * @param texture The uploaded texture
+   */
+  void applyTexture(size_t material, const std::string &path,
+                    std::shared_ptr<Texture> texture);
+
   // Each material get's it's own mesh
   std::vector<std::shared_ptr<Mesh>> meshes;
 
@@ -64,9 +264,89 @@ private:
     static constexpr unsigned int MASK_USE_SPECULAR = (1 << 1);
     static constexpr unsigned int MASK_USE_ALPHA = (1 << 2);
 
+    // Set if the texture is a layer of a texture array
+    static constexpr unsigned int MASK_DIFFUSED_ARRAY = (1 << 3);
+    static constexpr unsigned int MASK_SPECULAR_ARRAY = (1 << 4);
+    static constexpr unsigned int MASK_ALPHA_ARRAY = (1 << 5);
+
     unsigned int mask = 0;
   };
 
+  // Sorts the meshes by the textures they bind, so that meshes using the
+  // same texture arrays are drawn one after another
+  void sortDrawOrder();
+
+  /* Finds the runs of visible meshlets of a mesh. Every meshlet is
+   * visible if the model has not been culled
+   * @param mesh The index of the mesh
+   * @returns The first meshlet and meshlet count of each run
+   */
+  const std::vector<std::pair<size_t, size_t>> &getVisibleRuns(size_t mesh);
+
+  // Counts the meshes with at least one visible chunk
+  // @returns The number of visible meshes
+  size_t countVisibleMeshes();
+
   // Holds material data
   std::vector<Material> materials;
-};
\ No newline at end of file
+
+  // The data each material was created from
+  std::vector<ModelData::MaterialData> materialSources;
+
+  // Uploaded textures by path
+  std::unordered_map<std::string, std::shared_ptr<Texture>> textures;
+
+  // The order the meshes are drawn in, and whether it needs to be sorted
+  // again because a mesh or texture was added
+  std::vector<size_t> drawOrder;
+  bool drawOrderDirty = false;
+
+  // The bounds of every mesh's chunks in model space, and the index of
+  // each mesh's first chunk
+  std::vector<BoundingBox> chunkBoxes;
+  std::vector<size_t> firstChunks;
+
+  // The mesh each chunk belongs to
+  std::vector<uint32_t> chunkMeshes;
+
+  // The bounds and cones of every mesh's meshlets in model space, and the
+  // index of each mesh's first meshlet
+  MeshletList meshletBounds;
+  std::vector<size_t> firstMeshlets;
+
+  // A hierarchy over the chunks, and the chunk bounds in its order. It is
+  // rebuilt by cull after meshes are added
+  BVH chunkTree;
+  BoundsList chunkBounds;
+  bool chunkTreeDirty = false;
+
+  // The triangles of each mesh, kept for ray queries
+  struct Shape {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    BVH bvh;
+  };
+
+  std::vector<Shape> shapes;
+
+  // The result of the last cull, by chunk and in the tree's order
+  std::vector<uint8_t> visibleChunks;
+  std::vector<uint8_t> visibleNodes;
+  bool isCulled = false;
+  CullStats cullStats;
+
+  // The level of detail of each mesh, and the counts of the selection
+  std::vector<uint8_t> meshLODs;
+  LODStats lodStats;
+
+  // The result of the last meshlet cull. Only valid if the chunks have not
+  // been culled again since
+  std::vector<uint8_t> visibleMeshlets;
+  bool isMeshletCulled = false;
+
+  // The visible chunks as ranges of meshlets. Reused by cullMeshlets
+  std::vector<std::pair<size_t, size_t>> meshletRanges;
+
+  // Reused by getVisibleRuns
+  std::vector<std::pair<size_t, size_t>> runs;
+};
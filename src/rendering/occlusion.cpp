@@ -0,0 +1,337 @@
+#include "rendering/occlusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+using namespace std;
+using namespace glm;
+
+// Points closer than this to the camera plane are treated as crossing the
+// near plane, even if the projection's near plane is closer
+#define MIN_W 1e-5f
+
+// Allows for rounding differences between rasterized and projected depths
+#define DEPTH_BIAS 1e-5f
+
+OcclusionBuffer::OcclusionBuffer(int width, int height,
+                                 shared_ptr<ThreadPool> pool) {
+  this->tilesX = (width + OCCLUSION_TILE - 1) / OCCLUSION_TILE;
+  this->tilesY = (height + OCCLUSION_TILE - 1) / OCCLUSION_TILE;
+  this->width = this->tilesX * OCCLUSION_TILE;
+  this->height = this->tilesY * OCCLUSION_TILE;
+  this->pool = pool;
+
+  this->depth.resize((size_t)this->width * this->height);
+  this->tileDepth.resize((size_t)this->tilesX * this->tilesY);
+
+  this->clear();
+}
+
+void OcclusionBuffer::clear() {
+  fill(this->depth.begin(), this->depth.end(), 1.0f);
+  fill(this->tileDepth.begin(), this->tileDepth.end(), 1.0f);
+  this->triangles.clear();
+}
+
+void OcclusionBuffer::addOccluders(const vector<float> &positions,
+                                   const vector<uint32_t> &indices,
+                                   size_t first, size_t count,
+                                   const mat4 &PVM) {
+  float halfWidth = this->width * 0.5f;
+  float halfHeight = this->height * 0.5f;
+
+  this->triangles.reserve(this->triangles.size() + count / 3);
+
+  for (size_t i = first; i + 3 <= first + count; i += 3) {
+    Triangle triangle;
+    bool crossesNear = false;
+
+    for (int v = 0; v < 3; v++) {
+      const float *p = &positions[indices[i + v] * 3];
+      vec4 clip = PVM * vec4(p[0], p[1], p[2], 1.0f);
+
+      // OpenGL clips the parts in front of the near plane, so they can't
+      // hide anything
+      if (clip.w < MIN_W || clip.z < -clip.w) {
+        crossesNear = true;
+        break;
+      }
+
+      float inverseW = 1.0f / clip.w;
+      triangle.x[v] = (clip.x * inverseW + 1.0f) * halfWidth;
+      triangle.y[v] = (clip.y * inverseW + 1.0f) * halfHeight;
+      triangle.z[v] = clip.z * inverseW;
+    }
+
+    // Clipping would make new triangles. Leaving the triangle out only
+    // makes the occluders smaller, which is always safe
+    if (!crossesNear) {
+      this->triangles.push_back(triangle);
+    }
+  }
+}
+
+void OcclusionBuffer::render() {
+  int tileRows = this->tilesY;
+
+  size_t threads = this->pool ? this->pool->getThreadCount() : 1;
+  int bands = (int)std::min((size_t)tileRows, std::max(threads, (size_t)1));
+  int rowsPerBand = (tileRows + bands - 1) / bands;
+
+  for (int band = 0; band < bands; band++) {
+    int minY = band * rowsPerBand * OCCLUSION_TILE;
+    int maxY = std::min((band + 1) * rowsPerBand * OCCLUSION_TILE, this->height);
+
+    if (minY >= maxY) {
+      continue;
+    }
+
+    // Bands don't share pixels or tiles, so they don't need locks
+    if (this->pool && bands > 1) {
+      this->pool->submit([this, minY, maxY] { this->renderBand(minY, maxY); });
+    } else {
+      this->renderBand(minY, maxY);
+    }
+  }
+
+  if (this->pool && bands > 1) {
+    this->pool->wait();
+  }
+}
+
+bool OcclusionBuffer::projectBox(const BoundingBox &box, const mat4 &PVM,
+                                 OcclusionRect &rect) const {
+  vec2 minimum(INFINITY);
+  vec2 maximum(-INFINITY);
+  float nearest = INFINITY;
+
+  for (int c = 0; c < 8; c++) {
+    vec3 corner((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y,
+                (c & 4) ? box.max.z : box.min.z);
+
+    vec4 clip = PVM * vec4(corner, 1.0f);
+    if (clip.w < MIN_W || clip.z < -clip.w) {
+      return false;
+    }
+
+    vec3 ndc = vec3(clip) / clip.w;
+    minimum = glm::min(minimum, vec2(ndc));
+    maximum = glm::max(maximum, vec2(ndc));
+    nearest = std::min(nearest, ndc.z);
+  }
+
+  // Every pixel whose center may be covered by the box
+  rect.minX = (int)floor((minimum.x + 1.0f) * this->width * 0.5f);
+  rect.minY = (int)floor((minimum.y + 1.0f) * this->height * 0.5f);
+  rect.maxX = (int)ceil((maximum.x + 1.0f) * this->width * 0.5f);
+  rect.maxY = (int)ceil((maximum.y + 1.0f) * this->height * 0.5f);
+
+  rect.minX = std::max(rect.minX, 0);
+  rect.minY = std::max(rect.minY, 0);
+  rect.maxX = std::min(rect.maxX, this->width - 1);
+  rect.maxY = std::min(rect.maxY, this->height - 1);
+
+  rect.depth = nearest;
+
+  return true;
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox &box, const mat4 &PVM) const {
+  OcclusionRect rect;
+
+  if (!this->projectBox(box, PVM, rect)) {
+    return true;
+  }
+
+  if (rect.minX > rect.maxX || rect.minY > rect.maxY) {
+    return false;
+  }
+
+  float depth = rect.depth - DEPTH_BIAS;
+
+  int minTileX = rect.minX / OCCLUSION_TILE;
+  int minTileY = rect.minY / OCCLUSION_TILE;
+  int maxTileX = rect.maxX / OCCLUSION_TILE;
+  int maxTileY = rect.maxY / OCCLUSION_TILE;
+
+  for (int ty = minTileY; ty <= maxTileY; ty++) {
+    for (int tx = minTileX; tx <= maxTileX; tx++) {
+      // Every pixel of the tile is in front of the box
+      if (this->tileDepth[ty * this->tilesX + tx] < depth) {
+        continue;
+      }
+
+      int x0 = std::max(tx * OCCLUSION_TILE, rect.minX);
+      int y0 = std::max(ty * OCCLUSION_TILE, rect.minY);
+      int x1 = std::min((tx + 1) * OCCLUSION_TILE - 1, rect.maxX);
+      int y1 = std::min((ty + 1) * OCCLUSION_TILE - 1, rect.maxY);
+
+      // The farthest pixel of the tile is in the rectangle
+      if (x1 - x0 == OCCLUSION_TILE - 1 && y1 - y0 == OCCLUSION_TILE - 1) {
+        return true;
+      }
+
+      for (int y = y0; y <= y1; y++) {
+        const float *row = &this->depth[(size_t)y * this->width];
+
+        for (int x = x0; x <= x1; x++) {
+          if (row[x] >= depth) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+size_t OcclusionBuffer::getTriangleCount() const {
+  return this->triangles.size();
+}
+
+int OcclusionBuffer::getWidth() const { return this->width; }
+
+int OcclusionBuffer::getHeight() const { return this->height; }
+
+const vector<float> &OcclusionBuffer::getDepth() const { return this->depth; }
+
+void OcclusionBuffer::renderBand(int minY, int maxY) {
+  for (auto &triangle : this->triangles) {
+    this->rasterize(triangle, minY, maxY);
+  }
+
+  // The farthest depth of each tile in the band
+  for (int ty = minY / OCCLUSION_TILE; ty * OCCLUSION_TILE < maxY; ty++) {
+    for (int tx = 0; tx < this->tilesX; tx++) {
+      float farthest = -INFINITY;
+
+      for (int y = 0; y < OCCLUSION_TILE; y++) {
+        const float *row = &this->depth[(size_t)(ty * OCCLUSION_TILE + y) *
+                                            this->width +
+                                        tx * OCCLUSION_TILE];
+
+        for (int x = 0; x < OCCLUSION_TILE; x++) {
+          farthest = std::max(farthest, row[x]);
+        }
+      }
+
+      this->tileDepth[ty * this->tilesX + tx] = farthest;
+    }
+  }
+}
+
+void OcclusionBuffer::rasterize(const Triangle &triangle, int minY, int maxY) {
+  float x0 = triangle.x[0], y0 = triangle.y[0], z0 = triangle.z[0];
+  float x1 = triangle.x[1], y1 = triangle.y[1], z1 = triangle.z[1];
+  float x2 = triangle.x[2], y2 = triangle.y[2], z2 = triangle.z[2];
+
+  // Twice the signed area. Both sides are rasterized, so clockwise
+  // triangles are flipped
+  float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+  if (area == 0.0f) {
+    return;
+  }
+
+  if (area < 0.0f) {
+    swap(x1, x2);
+    swap(y1, y2);
+    swap(z1, z2);
+    area = -area;
+  }
+
+  // The pixels whose centers may be inside, clipped to the band
+  int startX = std::max((int)floor(std::min({x0, x1, x2}) - 0.5f), 0);
+  int endX = std::min((int)ceil(std::max({x0, x1, x2}) - 0.5f), this->width - 1);
+  int startY = std::max((int)floor(std::min({y0, y1, y2}) - 0.5f), minY);
+  int endY = std::min((int)ceil(std::max({y0, y1, y2}) - 0.5f), maxY - 1);
+
+  if (startX > endX || startY > endY) {
+    return;
+  }
+
+  // Four pixels are done at a time, starting at a multiple of four. The
+  // width is a multiple of the tile size, so this never passes the row
+  startX &= ~3;
+
+  // Edge functions. Positive on the inside of each edge
+  float stepX0 = -(y2 - y1);
+  float stepX1 = -(y0 - y2);
+  float stepX2 = -(y1 - y0);
+
+  float px = startX + 0.5f;
+
+  // Depth is a plane in screen space. The edge functions divided by the
+  // area are the weights of the opposite corners
+  float inverseArea = 1.0f / area;
+  float stepXZ = (stepX0 * z0 + stepX1 * z1 + stepX2 * z2) * inverseArea;
+
+  for (int y = startY; y <= endY; y++) {
+    float *row = &this->depth[(size_t)y * this->width];
+
+    // Each row starts from its own position instead of stepping from the
+    // row before, so how the rows are split into bands doesn't change the
+    // result
+    float py = y + 0.5f;
+
+    int x = startX;
+    float edge0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+    float edge1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+    float edge2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+    float z = (edge0 * z0 + edge1 * z1 + edge2 * z2) * inverseArea;
+
+#ifdef USE_SSE2
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 e0 = _mm_add_ps(_mm_set1_ps(edge0),
+                           _mm_mul_ps(lanes, _mm_set1_ps(stepX0)));
+    __m128 e1 = _mm_add_ps(_mm_set1_ps(edge1),
+                           _mm_mul_ps(lanes, _mm_set1_ps(stepX1)));
+    __m128 e2 = _mm_add_ps(_mm_set1_ps(edge2),
+                           _mm_mul_ps(lanes, _mm_set1_ps(stepX2)));
+    __m128 zs = _mm_add_ps(_mm_set1_ps(z),
+                           _mm_mul_ps(lanes, _mm_set1_ps(stepXZ)));
+
+    const __m128 step0 = _mm_set1_ps(stepX0 * 4.0f);
+    const __m128 step1 = _mm_set1_ps(stepX1 * 4.0f);
+    const __m128 step2 = _mm_set1_ps(stepX2 * 4.0f);
+    const __m128 stepZ = _mm_set1_ps(stepXZ * 4.0f);
+
+    for (; x <= endX; x += 4) {
+      __m128 inside = _mm_and_ps(
+          _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+          _mm_cmpge_ps(e2, zero));
+
+      if (_mm_movemask_ps(inside) != 0) {
+        __m128 old = _mm_loadu_ps(&row[x]);
+        __m128 closer = _mm_min_ps(old, zs);
+
+        _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, closer),
+                                         _mm_andnot_ps(inside, old)));
+      }
+
+      e0 = _mm_add_ps(e0, step0);
+      e1 = _mm_add_ps(e1, step1);
+      e2 = _mm_add_ps(e2, step2);
+      zs = _mm_add_ps(zs, stepZ);
+    }
+#else
+    for (; x <= endX; x++) {
+      if (edge0 >= 0.0f && edge1 >= 0.0f && edge2 >= 0.0f) {
+        row[x] = std::min(row[x], z);
+      }
+
+      edge0 += stepX0;
+      edge1 += stepX1;
+      edge2 += stepX2;
+      z += stepXZ;
+    }
+#endif
+  }
+}
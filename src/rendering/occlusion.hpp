@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "helper/threadpool.hpp"
+#include "rendering/culling.hpp"
+
+// The size of the squares the buffer keeps a farthest depth for. Boxes
+// are tested against whole tiles before single pixels
+#define OCCLUSION_TILE 8
+
+// Where a box is on the screen of an OcclusionBuffer
+struct OcclusionRect {
+  // The pixels the box may cover, inclusive
+  int minX, minY, maxX, maxY;
+
+  // The depth of the box's nearest corner
+  float depth;
+};
+
+/* A small depth buffer that occluders are rasterized into on the CPU, so
+ * that the bounds of objects can be tested before they are drawn
+ *
+ * Depth is the normalized device z. Occluders only cover the pixels whose
+ * centers they hold, and boxes are visible if any pixel of the rectangle
+ * around them is as far or further than their nearest corner, so objects
+ * are never hidden by mistake
+ *
+ * Rasterizing is split into horizontal bands that run on a thread pool
+ */
+class OcclusionBuffer {
+private:
+  /* Creates an empty buffer
+   * @param width The width in pixels. Rounded up to a multiple of
+   * OCCLUSION_TILE
+   * @param height The height in pixels. Rounded up to a multiple of
+   * OCCLUSION_TILE
+   * @param pool Rasterizes bands in parallel. If nullptr, everything runs on
+   * the calling thread
+   */
+  OcclusionBuffer(int width, int height, std::shared_ptr<ThreadPool> pool);
+
+public:
+  // Removes every occluder and sets the buffer to the far plane
+  void clear();
+
+  /* Queues occluder triangles. Triangles that reach in front of the near
+   * plane are skipped
+   * @param positions Three floats per vertex
+   * @param indices Three indices per triangle
+   * @param first The first index to add
+   * @param count The number of indices to add
+   * @param PVM The perspective * view * model matrix
+   */
+  void addOccluders(const std::vector<float> &positions,
+                    const std::vector<uint32_t> &indices, size_t first,
+                    size_t count, const glm::mat4 &PVM);
+
+  // Rasterizes the queued occluders and updates the tile depths
+  void render();
+
+  /* Finds where a box is on the screen
+   * @param box The box, in model space
+   * @param PVM The perspective * view * model matrix
+   * @param rect Set to the box's pixels and nearest depth
+   * @returns False if the box reaches in front of the near plane, in which
+   * case it has no rectangle
+   */
+  bool projectBox(const BoundingBox &box, const glm::mat4 &PVM,
+                  OcclusionRect &rect) const;
+
+  /* Tests whether a box may be visible past the occluders
+   * @param box The box, in model space
+   * @param PVM The perspective * view * model matrix
+   * @returns False if the box is hidden by the occluders or is off screen
+   */
+  bool isVisible(const BoundingBox &box, const glm::mat4 &PVM) const;
+
+  // Returns the number of occluder triangles queued since the last clear
+  // @returns The number of occluder triangles
+  size_t getTriangleCount() const;
+
+  // Returns the width of the buffer
+  // @returns The width in pixels
+  int getWidth() const;
+  // Returns the height of the buffer
+  // @returns The height in pixels
+  int getHeight() const;
+
+  // Returns the depth of each pixel, row by row from the bottom
+  // @returns The depth of each pixel
+  const std::vector<float> &getDepth() const;
+
+  /* Creates an empty buffer
+   * @param width The width in pixels. Rounded up to a multiple of
+   * OCCLUSION_TILE
+   * @param height The height in pixels. Rounded up to a multiple of
+   * OCCLUSION_TILE
+   * @param pool Rasterizes bands in parallel. If nullptr, everything runs on
+   * the calling thread
+   */
+  inline static auto create(int width, int height,
+                            std::shared_ptr<ThreadPool> pool = nullptr) {
+    return std::shared_ptr<OcclusionBuffer>(
+        new OcclusionBuffer{width, height, pool});
+  }
+
+private:
+  // A triangle in pixel coordinates, with its normalized device depth
+  struct Triangle {
+    float x[3];
+    float y[3];
+    float z[3];
+  };
+
+  /* Rasterizes the rows of every triangle that are in a band, and then
+   * updates the band's tile depths
+   * @param minY The first row of the band. A multiple of OCCLUSION_TILE
+   * @param maxY One past the last row of the band
+   */
+  void renderBand(int minY, int maxY);
+
+  /* Rasterizes the rows of a triangle that are in a band
+   * @param triangle The triangle
+   * @param minY The first row of the band
+   * @param maxY One past the last row of the band
+   */
+  void rasterize(const Triangle &triangle, int minY, int maxY);
+
+  int width;
+  int height;
+
+  std::vector<float> depth;
+
+  // The farthest depth of each tile
+  std::vector<float> tileDepth;
+  int tilesX;
+  int tilesY;
+
+  std::vector<Triangle> triangles;
+
+  std::shared_ptr<ThreadPool> pool;
+};
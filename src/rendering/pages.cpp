@@ -0,0 +1,103 @@
+#include "rendering/pages.hpp"
+
+#include <thread>
+
+using namespace std;
+
+PageAllocator::PageAllocator(size_t tiles)
+    : tiles(tiles),
+      words(new atomic<uint32_t>[tiles * FRAGMENT_PAGE_STRIDE]) {
+  this->reset(0);
+}
+
+void PageAllocator::reset(size_t capacity) {
+  this->capacity = capacity;
+
+  for (size_t i = 0; i < this->tiles * FRAGMENT_PAGE_STRIDE; i++) {
+    this->words[i].store(0);
+  }
+
+  this->pages.store(0);
+  this->fallbacks.store(0);
+  this->dropped.store(0);
+}
+
+uint32_t PageAllocator::allocate(uint32_t tile) {
+  return this->find(tile, this->claim(tile));
+}
+
+uint32_t PageAllocator::claim(uint32_t tile) {
+  atomic<uint32_t> *words = &this->words[tile * FRAGMENT_PAGE_STRIDE];
+
+  uint32_t slot = words[0].fetch_add(1);
+  uint32_t page = slot / FRAGMENT_PAGE_SIZE;
+
+  if (slot % FRAGMENT_PAGE_SIZE == 0) {
+    uint32_t tag = ((page & 0x7FFu) + 1) << FRAGMENT_PAGE_INDEX_BITS;
+    words[1 + page % FRAGMENT_PAGE_RING].exchange(tag | this->takePage());
+  }
+
+  return slot;
+}
+
+uint32_t PageAllocator::find(uint32_t tile, uint32_t slot) {
+  uint32_t page = slot / FRAGMENT_PAGE_SIZE;
+
+  atomic<uint32_t> &entry =
+      this->words[tile * FRAGMENT_PAGE_STRIDE + 1 + page % FRAGMENT_PAGE_RING];
+  uint32_t tag = ((page & 0x7FFu) + 1) << FRAGMENT_PAGE_INDEX_BITS;
+
+  uint32_t index = FRAGMENT_PAGE_INDEX_MASK;
+  uint32_t node = slot % FRAGMENT_PAGE_SIZE;
+  bool found = false;
+
+  // The page can be missing if the fragment that takes it hasn't yet, or
+  // if the tile went around the ring since
+  for (int i = 0; i < FRAGMENT_PAGE_SPINS && !found; i++) {
+    uint32_t value = entry.load();
+
+    if ((value & ~FRAGMENT_PAGE_INDEX_MASK) == tag) {
+      index = value & FRAGMENT_PAGE_INDEX_MASK;
+      found = true;
+    } else {
+      this_thread::yield();
+    }
+  }
+
+  // The fragment takes the first node of a page of its own. The rest of
+  // that page and the fragment's slot in the tile's page go unused
+  if (!found) {
+    this->fallbacks++;
+    index = this->takePage();
+    node = 0;
+  }
+
+  if (index == FRAGMENT_PAGE_INDEX_MASK) {
+    this->dropped++;
+    return 0;
+  }
+
+  return (index + 1) * FRAGMENT_PAGE_SIZE + node;
+}
+
+size_t PageAllocator::getPageCount() { return this->pages.load(); }
+
+size_t PageAllocator::getFallbacks() { return this->fallbacks.load(); }
+
+size_t PageAllocator::getDropped() { return this->dropped.load(); }
+
+size_t PageAllocator::getNodeBound(size_t fragments, size_t tiles,
+                                   size_t fallbacks) {
+  return fragments + tiles * (FRAGMENT_PAGE_SIZE - 1) + FRAGMENT_PAGE_SIZE +
+         fallbacks * FRAGMENT_PAGE_SIZE;
+}
+
+uint32_t PageAllocator::takePage() {
+  uint32_t index = this->pages.fetch_add(1);
+
+  // The page after the index is used, since page zero is never used
+  bool fits = index < FRAGMENT_PAGE_INDEX_MASK &&
+              (index + 2) * (size_t)FRAGMENT_PAGE_SIZE <= this->capacity;
+
+  return fits ? index : FRAGMENT_PAGE_INDEX_MASK;
+}
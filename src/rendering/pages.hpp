@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The nodes in each page of the fragment list. The PAGE_ defines in
+// common/transparancy.frag must match these
+#define FRAGMENT_PAGE_SIZE 16
+
+// The latest pages of a tile that fragments can find their page in
+#define FRAGMENT_PAGE_RING 8
+
+// The words each tile has in the page buffer: its fragment count, then
+// the ring
+#define FRAGMENT_PAGE_STRIDE (1 + FRAGMENT_PAGE_RING)
+
+// How many times a fragment looks for its page before it takes a page of
+// its own
+#define FRAGMENT_PAGE_SPINS 1024
+
+// Ring entries hold a page index in their low bits, and which of the
+// tile's pages it is in the rest. The largest index marks a page that
+// didn't fit
+#define FRAGMENT_PAGE_INDEX_BITS 20
+#define FRAGMENT_PAGE_INDEX_MASK 0xFFFFFu
+
+/* Hands out list nodes in pages, the same way the transparent shader does
+ * with PAGED_ALLOCATION. Each tile counts its fragments, and the first
+ * fragment of each of the tile's pages takes the next page from a global
+ * counter. The other fragments of the page wait for it to show up in the
+ * tile's ring. The global counter is hit once per page instead of once per
+ * fragment, and a tile's fragments are next to each other in the list.
+ * A fragment whose page doesn't show up, because the tile went around the
+ * ring, takes a page of its own instead. allocate can be called from many
+ * threads at once
+ */
+class PageAllocator {
+private:
+  // Creates an allocator with no room
+  // @param tiles The number of tiles
+  PageAllocator(size_t tiles);
+
+public:
+  /* Starts a frame. Every tile is emptied
+   * @param capacity The nodes the list holds. Node zero ends the lists,
+   * so page zero is never handed out
+   */
+  void reset(size_t capacity);
+
+  /* Returns a node for a new fragment of a tile
+   * @param tile The tile of the fragment
+   * @returns The node. Zero if there was no room
+   */
+  uint32_t allocate(uint32_t tile);
+
+  /* The first half of allocate. Takes the tile's next slot, and the page
+   * for it if it is the first slot of a page
+   * @param tile The tile of the fragment
+   * @returns The slot
+   */
+  uint32_t claim(uint32_t tile);
+
+  /* The second half of allocate. Looks for the page of a slot in the
+   * tile's ring, or takes a page of its own if the page isn't there
+   * @param tile The tile of the fragment
+   * @param slot The slot from claim
+   * @returns The node. Zero if there was no room
+   */
+  uint32_t find(uint32_t tile, uint32_t slot);
+
+  // Returns the pages handed out this frame
+  // @returns The number of pages
+  size_t getPageCount();
+
+  // Returns the fragments that took a page of their own this frame
+  // @returns The number of fragments
+  size_t getFallbacks();
+
+  // Returns the fragments that got no node this frame
+  // @returns The number of fragments
+  size_t getDropped();
+
+  /* Returns the nodes the list needs so that no fragment is dropped for
+   * lack of room. Every tile can leave all but one node of its last page
+   * unused, and each fallback takes a whole page for one fragment and
+   * leaves its slot in the tile's page unused
+   * @param fragments The number of fragments
+   * @param tiles The number of tiles that can have fragments
+   * @param fallbacks The number of fragments expected to take a page of
+   * their own
+   * @returns The number of nodes
+   */
+  static size_t getNodeBound(size_t fragments, size_t tiles,
+                             size_t fallbacks = 0);
+
+  // Creates an allocator with no room
+  // @param tiles The number of tiles
+  inline static auto create(size_t tiles) {
+    return std::shared_ptr<PageAllocator>(new PageAllocator{tiles});
+  }
+
+private:
+  // Takes the next page from the global counter
+  // @returns The page's index. FRAGMENT_PAGE_INDEX_MASK if it doesn't fit
+  uint32_t takePage();
+
+  size_t tiles;
+  size_t capacity = 0;
+
+  // FRAGMENT_PAGE_STRIDE words per tile
+  std::unique_ptr<std::atomic<uint32_t>[]> words;
+
+  std::atomic<uint32_t> pages{0};
+  std::atomic<size_t> fallbacks{0};
+  std::atomic<size_t> dropped{0};
+};
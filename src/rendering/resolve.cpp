@@ -0,0 +1,59 @@
+#include "rendering/resolve.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace glm;
+
+// Returns the fragments sorted from the nearest to the furthest
+// @param fragments The fragments, in the order of the pixel's list
+// @returns The sorted fragments
+static vector<ResolveFragment>
+sortFragments(const vector<ResolveFragment> &fragments) {
+  vector<ResolveFragment> sorted = fragments;
+
+  // Stable, so fragments at the same depth keep their list order like in
+  // the shaders
+  stable_sort(sorted.begin(), sorted.end(),
+              [](const ResolveFragment &a, const ResolveFragment &b) {
+                return a.depth < b.depth;
+              });
+
+  return sorted;
+}
+
+ResolveResult resolveBackToFront(const vector<ResolveFragment> &fragments) {
+  ResolveResult result;
+
+  auto sorted = sortFragments(fragments);
+
+  for (auto fragment = sorted.rbegin(); fragment != sorted.rend(); fragment++) {
+    vec4 color = fragment->color;
+
+    result.color = vec3(color) * color.a + (1.0f - color.a) * result.color;
+    result.transmittance *= 1.0f - color.a;
+  }
+
+  return result;
+}
+
+ResolveResult resolveFrontToBack(const vector<ResolveFragment> &fragments,
+                                 float epsilon) {
+  ResolveResult result;
+
+  auto sorted = sortFragments(fragments);
+
+  for (size_t i = 0; i < sorted.size(); i++) {
+    vec4 color = sorted[i].color;
+
+    result.color += result.transmittance * color.a * vec3(color);
+    result.transmittance *= 1.0f - color.a;
+
+    if (result.transmittance < epsilon) {
+      result.skipped = sorted.size() - i - 1;
+      break;
+    }
+  }
+
+  return result;
+}
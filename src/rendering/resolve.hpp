@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// A transparent fragment of a pixel, as the resolve shaders read it
+struct ResolveFragment {
+  // Straight, not premultiplied, color and opacity
+  glm::vec4 color;
+  float depth;
+};
+
+// The transparent fragments of a pixel composited over black. The final
+// color is color + transmittance * the opaque color
+struct ResolveResult {
+  glm::vec3 color = glm::vec3(0.0f);
+  float transmittance = 1.0f;
+
+  // The fragments that were never composited
+  size_t skipped = 0;
+};
+
+/* Composites a pixel's fragments from the furthest to the nearest, the same
+ * way combine/shader.frag does without frontToBack. Fragments at the same
+ * depth keep their order in the list. This is the reference the shaders
+ * are checked against
+ * @param fragments The fragments, in the order of the pixel's list
+ * @returns The composited color
+ */
+ResolveResult resolveBackToFront(const std::vector<ResolveFragment> &fragments);
+
+/* Composites a pixel's fragments from the nearest to the furthest, the same
+ * way combine/shader.frag does with frontToBack. It stops once less than
+ * epsilon of what is behind would show through. For colors between 0 and
+ * 1, the final color is then within epsilon of resolveBackToFront's in
+ * every channel, whatever the opaque color is
+ * @param fragments The fragments, in the order of the pixel's list
+ * @param epsilon The transmittance to stop at
+ * @returns The composited color
+ */
+ResolveResult resolveFrontToBack(const std::vector<ResolveFragment> &fragments,
+                                 float epsilon);
@@ -0,0 +1,373 @@
+#include "rendering/simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+using namespace std;
+using namespace glm;
+
+// The sum of squared distances to a set of planes, stored as the upper
+// half of a symmetric 4x4 matrix
+struct Quadric {
+  double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+  double yy = 0.0, yz = 0.0, yw = 0.0;
+  double zz = 0.0, zw = 0.0;
+  double ww = 0.0;
+
+  // Adds the quadric of a plane
+  // @param plane The plane. xyz is the unit normal, w the distance
+  void addPlane(const dvec4 &plane) {
+    this->xx += plane.x * plane.x;
+    this->xy += plane.x * plane.y;
+    this->xz += plane.x * plane.z;
+    this->xw += plane.x * plane.w;
+    this->yy += plane.y * plane.y;
+    this->yz += plane.y * plane.z;
+    this->yw += plane.y * plane.w;
+    this->zz += plane.z * plane.z;
+    this->zw += plane.z * plane.w;
+    this->ww += plane.w * plane.w;
+  }
+
+  // Adds another quadric
+  // @param other The other quadric
+  void add(const Quadric &other) {
+    this->xx += other.xx;
+    this->xy += other.xy;
+    this->xz += other.xz;
+    this->xw += other.xw;
+    this->yy += other.yy;
+    this->yz += other.yz;
+    this->yw += other.yw;
+    this->zz += other.zz;
+    this->zw += other.zw;
+    this->ww += other.ww;
+  }
+
+  // Returns the sum of squared distances of a point to the planes
+  // @param p The point
+  // @returns The error
+  double evaluate(const vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+
+    double error = x * x * this->xx + 2.0 * x * y * this->xy +
+                   2.0 * x * z * this->xz + 2.0 * x * this->xw +
+                   y * y * this->yy + 2.0 * y * z * this->yz +
+                   2.0 * y * this->yw + z * z * this->zz +
+                   2.0 * z * this->zw + this->ww;
+
+    // Rounding can make the error a little negative
+    return std::max(error, 0.0);
+  }
+};
+
+// Moving vertex from onto vertex to, and what that costs
+struct Collapse {
+  float cost;
+  uint32_t from;
+  uint32_t to;
+};
+
+vector<MeshLOD> buildLODs(const vector<float> &positions,
+                          const vector<uint32_t> &indices) {
+  vector<MeshLOD> lods;
+
+  size_t vertexCount = positions.size() / 3;
+  size_t triangleCount = indices.size() / 3;
+
+  if (triangleCount * MESH_LOD_RATIO < MESH_LOD_MIN_TRIANGLES) {
+    return lods;
+  }
+
+  auto position = [&](uint32_t v) {
+    const float *p = &positions[v * 3];
+    return vec3(p[0], p[1], p[2]);
+  };
+
+  // Vertices that share a position are welded, so that the borders between
+  // them are found. More than one vertex at a position is a seam
+  vector<uint32_t> sorted(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    sorted[v] = v;
+  }
+
+  sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+    return memcmp(&positions[a * 3], &positions[b * 3], sizeof(float) * 3) < 0;
+  });
+
+  vector<uint32_t> welded(vertexCount);
+  vector<uint8_t> isSeam(vertexCount, 0);
+
+  for (size_t i = 0; i < vertexCount;) {
+    size_t end = i + 1;
+    while (end < vertexCount &&
+           memcmp(&positions[sorted[i] * 3], &positions[sorted[end] * 3],
+                  sizeof(float) * 3) == 0) {
+      end++;
+    }
+
+    for (size_t j = i; j < end; j++) {
+      welded[sorted[j]] = sorted[i];
+      isSeam[sorted[j]] = end - i > 1 ? 1 : 0;
+    }
+
+    i = end;
+  }
+
+  // Edges of the welded mesh that don't have exactly two triangles are on
+  // a border
+  vector<uint64_t> edges;
+  edges.reserve(triangleCount * 3);
+
+  for (size_t t = 0; t < triangleCount; t++) {
+    for (int e = 0; e < 3; e++) {
+      uint32_t a = welded[indices[t * 3 + e]];
+      uint32_t b = welded[indices[t * 3 + (e + 1) % 3]];
+
+      edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+    }
+  }
+
+  sort(edges.begin(), edges.end());
+
+  vector<uint8_t> isBorder(vertexCount, 0);
+
+  for (size_t i = 0; i < edges.size();) {
+    size_t end = i + 1;
+    while (end < edges.size() && edges[end] == edges[i]) {
+      end++;
+    }
+
+    if (end - i != 2) {
+      isBorder[edges[i] >> 32] = 1;
+      isBorder[edges[i] & 0xFFFFFFFF] = 1;
+    }
+
+    i = end;
+  }
+
+  edges = vector<uint64_t>();
+
+  // Seam and border vertices stay where they are. Vertices can move onto
+  // a border, but not onto a seam, since it would be unclear which of the
+  // seam's vertices to use
+  vector<uint8_t> isLocked(vertexCount), isTarget(vertexCount);
+
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    isLocked[v] = isSeam[v] || isBorder[welded[v]];
+    isTarget[v] = !isSeam[v];
+  }
+
+  // Each vertex starts with the planes of the triangles around it
+  vector<Quadric> quadrics(vertexCount);
+
+  for (size_t t = 0; t < triangleCount; t++) {
+    vec3 a = position(indices[t * 3]);
+    vec3 b = position(indices[t * 3 + 1]);
+    vec3 c = position(indices[t * 3 + 2]);
+
+    dvec3 normal = cross(dvec3(b - a), dvec3(c - a));
+    double area = length(normal);
+
+    if (area == 0.0) {
+      continue;
+    }
+
+    normal /= area;
+    dvec4 plane(normal, -dot(normal, dvec3(a)));
+
+    for (int v = 0; v < 3; v++) {
+      quadrics[indices[t * 3 + v]].addPlane(plane);
+    }
+  }
+
+  // The collapses run in passes. Each pass collapses the cheapest edges
+  // that don't share any triangles, and then removes the triangles that
+  // became lines
+  vector<uint32_t> current = indices;
+  double maxCost = 0.0;
+
+  vector<Collapse> collapses;
+  vector<uint32_t> firstTriangle(vertexCount + 1);
+  vector<uint32_t> vertexTriangles;
+  vector<uint32_t> remap(vertexCount);
+  vector<uint32_t> touched(vertexCount, 0);
+  uint32_t pass = 0;
+
+  size_t target = (size_t)(triangleCount * MESH_LOD_RATIO);
+
+  while (lods.size() < MESH_LOD_LEVELS && target >= MESH_LOD_MIN_TRIANGLES) {
+    size_t triangles = current.size() / 3;
+
+    if (triangles <= target) {
+      lods.push_back(MeshLOD{current, (float)sqrt(maxCost)});
+      target = (size_t)(triangles * MESH_LOD_RATIO);
+      continue;
+    }
+
+    pass++;
+
+    // The triangles around each vertex
+    fill(firstTriangle.begin(), firstTriangle.end(), 0);
+    for (uint32_t index : current) {
+      firstTriangle[index + 1]++;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+      firstTriangle[v + 1] += firstTriangle[v];
+    }
+
+    vertexTriangles.resize(current.size());
+    {
+      vector<uint32_t> next(firstTriangle.begin(), firstTriangle.end() - 1);
+      for (size_t i = 0; i < current.size(); i++) {
+        vertexTriangles[next[current[i]]++] = (uint32_t)(i / 3);
+      }
+    }
+
+    // The cheaper direction of each edge. Edges are seen from both of
+    // their triangles, so only one of the two is used
+    collapses.clear();
+
+    for (size_t t = 0; t < triangles; t++) {
+      for (int e = 0; e < 3; e++) {
+        uint32_t a = current[t * 3 + e];
+        uint32_t b = current[t * 3 + (e + 1) % 3];
+
+        if (a > b) {
+          continue;
+        }
+
+        Quadric sum = quadrics[a];
+        sum.add(quadrics[b]);
+
+        Collapse best{INFINITY, 0, 0};
+
+        if (!isLocked[a] && isTarget[b]) {
+          best = Collapse{(float)sum.evaluate(position(b)), a, b};
+        }
+
+        if (!isLocked[b] && isTarget[a]) {
+          float cost = (float)sum.evaluate(position(a));
+
+          if (cost < best.cost) {
+            best = Collapse{cost, b, a};
+          }
+        }
+
+        if (best.cost != INFINITY) {
+          collapses.push_back(best);
+        }
+      }
+    }
+
+    // Each collapse removes about two triangles. Stop close to the target
+    // so that the level isn't simplified further than asked
+    size_t wanted = (triangles - target + 1) / 2;
+    size_t collapsed = 0;
+
+    // Only the cheapest collapses can be used, so only those are sorted.
+    // Collapses that are passed over are found again next pass
+    auto cheaper = [](const Collapse &a, const Collapse &b) {
+      return a.cost < b.cost;
+    };
+
+    size_t considered =
+        std::min(collapses.size(), std::max(wanted * 4, collapses.size() / 8));
+    nth_element(collapses.begin(), collapses.begin() + considered,
+                collapses.end(), cheaper);
+    collapses.resize(considered);
+    sort(collapses.begin(), collapses.end(), cheaper);
+
+    for (uint32_t v = 0; v < vertexCount; v++) {
+      remap[v] = v;
+    }
+
+    for (auto &collapse : collapses) {
+      if (collapsed >= wanted) {
+        break;
+      }
+
+      uint32_t from = collapse.from, to = collapse.to;
+
+      if (touched[from] == pass || touched[to] == pass) {
+        continue;
+      }
+
+      // Triangles that would flip over are not allowed. Triangles holding
+      // both vertices become lines and are removed
+      vec3 moved = position(to);
+      bool flips = false;
+
+      for (uint32_t i = firstTriangle[from]; i < firstTriangle[from + 1]; i++) {
+        const uint32_t *triangle = &current[vertexTriangles[i] * 3];
+
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+          continue;
+        }
+
+        vec3 corners[3], changed[3];
+        for (int v = 0; v < 3; v++) {
+          corners[v] = position(triangle[v]);
+          changed[v] = triangle[v] == from ? moved : corners[v];
+        }
+
+        vec3 before = cross(corners[1] - corners[0], corners[2] - corners[0]);
+        vec3 after = cross(changed[1] - changed[0], changed[2] - changed[0]);
+
+        if (dot(before, after) <= 0.0f) {
+          flips = true;
+          break;
+        }
+      }
+
+      if (flips) {
+        continue;
+      }
+
+      // The triangles around the vertex can't be changed again this pass,
+      // or the flip test above would be out of date
+      for (uint32_t i = firstTriangle[from]; i < firstTriangle[from + 1]; i++) {
+        const uint32_t *triangle = &current[vertexTriangles[i] * 3];
+
+        for (int v = 0; v < 3; v++) {
+          touched[triangle[v]] = pass;
+        }
+      }
+
+      remap[from] = to;
+      quadrics[to].add(quadrics[from]);
+      maxCost = std::max(maxCost, (double)collapse.cost);
+      collapsed++;
+    }
+
+    if (collapsed == 0) {
+      break;
+    }
+
+    // Move the collapsed vertices and drop the triangles that became lines
+    size_t kept = 0;
+
+    for (size_t t = 0; t < triangles; t++) {
+      uint32_t a = remap[current[t * 3]];
+      uint32_t b = remap[current[t * 3 + 1]];
+      uint32_t c = remap[current[t * 3 + 2]];
+
+      if (a == b || b == c || a == c) {
+        continue;
+      }
+
+      current[kept * 3] = a;
+      current[kept * 3 + 1] = b;
+      current[kept * 3 + 2] = c;
+      kept++;
+    }
+
+    current.resize(kept * 3);
+  }
+
+  return lods;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The most simplified levels built for a mesh, on top of the full mesh
+#define MESH_LOD_LEVELS 4
+
+// The fraction of the previous level's triangles each level aims for
+#define MESH_LOD_RATIO 0.25f
+
+// Levels are not built below this many triangles
+#define MESH_LOD_MIN_TRIANGLES 256
+
+// A simplified version of a mesh's triangles. It uses a subset of the
+// mesh's vertices, so it only needs its own indices
+struct MeshLOD {
+  // Three indices per triangle, into the full mesh's vertices
+  std::vector<uint32_t> indices;
+
+  // How far the simplified surface may be from the full one, in model units
+  float error;
+};
+
+/* Builds a chain of simplified levels of a mesh with quadric error edge
+ * collapses. Each collapse moves a vertex onto a neighbour, so no vertices
+ * are made or changed. Vertices on borders and on seams where vertices
+ * share a position are never moved, so levels don't open holes at texture
+ * seams or between meshes
+ * @param positions Three floats per vertex
+ * @param indices Three indices per triangle
+ * @returns The levels, from the most to the least detailed. Empty if the
+ * mesh is too small or can't be simplified
+ */
+std::vector<MeshLOD> buildLODs(const std::vector<float> &positions,
+                               const std::vector<uint32_t> &indices);
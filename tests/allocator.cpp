@@ -0,0 +1,238 @@
+#include "helper/allocator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace std;
+
+// Allocations split a free block and leave the rest free
+static void testSplit() {
+  RangeAllocator allocator(1000);
+
+  RangeAllocator::Allocation a, b;
+  CHECK(allocator.allocate(100, a));
+  CHECK(allocator.allocate(200, b));
+
+  CHECK(a.offset == 0 && a.size == 100);
+  CHECK(b.offset == 100 && b.size == 200);
+
+  auto stats = allocator.getStats();
+  CHECK(stats.used == 300);
+  CHECK(stats.allocations == 2);
+  CHECK(stats.freeBlocks == 1);
+  CHECK(stats.largestFree == 700);
+  CHECK(stats.fragmentation == 0.0f);
+
+  // Zero is one unit
+  RangeAllocator::Allocation empty;
+  CHECK(allocator.allocate(0, empty));
+  CHECK(empty.size == 1);
+}
+
+// Freed ranges are merged with free neighbours on both sides
+static void testMerge() {
+  RangeAllocator allocator(1000);
+
+  RangeAllocator::Allocation a, b, c;
+  CHECK(allocator.allocate(100, a));
+  CHECK(allocator.allocate(100, b));
+  CHECK(allocator.allocate(100, c));
+
+  allocator.free(b);
+  CHECK(allocator.getStats().freeBlocks == 2);
+
+  // a merges with b after it
+  allocator.free(a);
+  auto stats = allocator.getStats();
+  CHECK(stats.freeBlocks == 2);
+  CHECK(stats.largestFree == 700);
+
+  // The space is one block again once c joins both sides
+  allocator.free(c);
+  stats = allocator.getStats();
+  CHECK(stats.freeBlocks == 1);
+  CHECK(stats.used == 0);
+  CHECK(stats.largestFree == 1000);
+  CHECK(stats.fragmentation == 0.0f);
+
+  // A hole is reused by a range that fits it
+  CHECK(allocator.allocate(100, a));
+  CHECK(allocator.allocate(100, b));
+  CHECK(allocator.allocate(100, c));
+  allocator.free(b);
+
+  RangeAllocator::Allocation d;
+  CHECK(allocator.allocate(50, d));
+  CHECK(d.offset == 100);
+}
+
+// Aligned ranges start on a multiple of the alignment, and the units
+// skipped stay free
+static void testAlignment() {
+  RangeAllocator allocator(1000);
+
+  RangeAllocator::Allocation a, b;
+  CHECK(allocator.allocate(3, a));
+  CHECK(allocator.allocate(10, b, 16));
+
+  CHECK(b.offset == 16);
+  CHECK(allocator.getUsed() == 13);
+  CHECK(allocator.getStats().freeBlocks == 2);
+
+  // The skipped units are handed out to a range that fits them
+  RangeAllocator::Allocation c;
+  CHECK(allocator.allocate(13, c));
+  CHECK(c.offset == 3);
+
+  // An aligned start needs no padding
+  RangeAllocator::Allocation d;
+  CHECK(allocator.allocate(16, d, 26));
+  CHECK(d.offset == 26);
+
+  allocator.free(a);
+  allocator.free(b);
+  allocator.free(c);
+  allocator.free(d);
+  CHECK(allocator.getStats().freeBlocks == 1);
+
+  mt19937 random(7);
+  vector<RangeAllocator::Allocation> allocations;
+
+  for (int i = 0; i < 200; i++) {
+    size_t alignment = (size_t)1 << (random() % 7);
+    RangeAllocator::Allocation allocation;
+
+    if (allocator.allocate(1 + random() % 5, allocation, alignment)) {
+      CHECK(allocation.offset % alignment == 0);
+      allocations.push_back(allocation);
+    }
+  }
+
+  for (auto &allocation : allocations) {
+    allocator.free(allocation);
+  }
+
+  CHECK(allocator.getStats().freeBlocks == 1);
+}
+
+// Fragmentation is the part of the free space outside the largest block
+static void testFragmentation() {
+  RangeAllocator allocator(100);
+
+  vector<RangeAllocator::Allocation> allocations(10);
+  for (auto &allocation : allocations) {
+    CHECK(allocator.allocate(10, allocation));
+  }
+
+  // Full
+  RangeAllocator::Allocation extra;
+  CHECK(!allocator.allocate(1, extra));
+  CHECK(allocator.getStats().fragmentation == 0.0f);
+
+  for (size_t i = 0; i < allocations.size(); i += 2) {
+    allocator.free(allocations[i]);
+  }
+
+  auto stats = allocator.getStats();
+  CHECK(stats.freeBlocks == 5);
+  CHECK(stats.largestFree == 10);
+  CHECK(fabsf(stats.fragmentation - 0.8f) < 1e-6f);
+
+  // 50 units are free, but not 11 in a row
+  CHECK(!allocator.allocate(11, extra));
+  CHECK(allocator.allocate(10, extra));
+}
+
+// Growing extends the free block at the end, or adds one after a used one
+static void testGrow() {
+  RangeAllocator allocator(100);
+
+  RangeAllocator::Allocation a, b;
+  CHECK(allocator.allocate(100, a));
+  CHECK(!allocator.allocate(50, b));
+
+  allocator.grow(150);
+  CHECK(allocator.getCapacity() == 150);
+  CHECK(allocator.allocate(50, b));
+  CHECK(b.offset == 100);
+
+  allocator.free(b);
+  allocator.grow(300);
+  auto stats = allocator.getStats();
+  CHECK(stats.freeBlocks == 1);
+  CHECK(stats.largestFree == 200);
+
+  // Shrinking is ignored
+  allocator.grow(10);
+  CHECK(allocator.getCapacity() == 300);
+}
+
+// Random allocations never overlap, and freeing them all leaves one block
+static void testRandom() {
+  const size_t capacity = 1 << 16;
+  RangeAllocator allocator(capacity);
+
+  mt19937 random(1);
+  vector<RangeAllocator::Allocation> live;
+  vector<bool> taken(capacity, false);
+
+  for (int i = 0; i < 20000; i++) {
+    if (!live.empty() && random() % 2 == 0) {
+      size_t index = random() % live.size();
+
+      for (size_t u = 0; u < live[index].size; u++) {
+        taken[live[index].offset + u] = false;
+      }
+
+      allocator.free(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+      continue;
+    }
+
+    RangeAllocator::Allocation allocation;
+    if (!allocator.allocate(1 + random() % 300, allocation)) {
+      continue;
+    }
+
+    bool overlaps = false;
+    for (size_t u = 0; u < allocation.size; u++) {
+      overlaps |= taken[allocation.offset + u];
+      taken[allocation.offset + u] = true;
+    }
+
+    CHECK(!overlaps);
+    CHECK(allocation.offset + allocation.size <= capacity);
+    live.push_back(allocation);
+  }
+
+  size_t used = 0;
+  for (auto &allocation : live) {
+    used += allocation.size;
+  }
+  CHECK(allocator.getUsed() == used);
+
+  for (auto &allocation : live) {
+    allocator.free(allocation);
+  }
+
+  auto stats = allocator.getStats();
+  CHECK(stats.used == 0);
+  CHECK(stats.freeBlocks == 1);
+  CHECK(stats.largestFree == capacity);
+}
+
+int main() {
+  testSplit();
+  testMerge();
+  testAlignment();
+  testFragmentation();
+  testGrow();
+  testRandom();
+
+  return finish();
+}
@@ -0,0 +1,105 @@
+#include "helper/blockcompress.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace std;
+
+// The lowest PSNR, in decibels, each format may encode the test image with
+#define MIN_PSNR_BC1 34.0
+#define MIN_PSNR_BC3 34.0
+#define MIN_PSNR_BC4 40.0
+#define MIN_PSNR_BC5 40.0
+
+/* Makes a test image of smooth gradients with some detail, a little like
+ * a photo. Each channel has its own pattern
+ * @param width The image width. Not a multiple of four, so the padding is
+ * checked too
+ * @param height The image height
+ * @param channels The number of channels
+ * @returns Tightly packed pixels
+ */
+static vector<unsigned char> makeImage(int width, int height, int channels) {
+  vector<unsigned char> pixels((size_t)width * height * channels);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < channels; c++) {
+        float u = x / (float)width, v = y / (float)height;
+        float value = 0.5f + 0.3f * sin(6.0f * u + 2.0f * c) * cos(5.0f * v) +
+                      0.15f * sin(40.0f * u * v + c);
+
+        pixels[((size_t)y * width + x) * channels + c] =
+            (unsigned char)lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+      }
+    }
+  }
+
+  return pixels;
+}
+
+/* Compresses and decompresses the test image and returns its PSNR
+ * @param format The block format
+ * @param channels The channels the format stores
+ * @returns The PSNR in decibels
+ */
+static double roundTrip(BlockFormat format, int channels) {
+  int width = 131, height = 97;
+  auto pixels = makeImage(width, height, channels);
+
+  auto blocks = compressImage(pixels.data(), width, height, channels, format);
+  CHECK(blocks.size() == getCompressedSize(format, width, height));
+
+  auto decoded =
+      decompressImage(blocks.data(), width, height, channels, format);
+  CHECK(decoded.size() == pixels.size());
+
+  return calculatePSNR(pixels.data(), decoded.data(), pixels.size());
+}
+
+int main() {
+  double bc1 = roundTrip(BlockFormat::BC1, 3);
+  double bc3 = roundTrip(BlockFormat::BC3, 4);
+  double bc4 = roundTrip(BlockFormat::BC4, 1);
+  double bc5 = roundTrip(BlockFormat::BC5, 2);
+
+  printf("PSNR: BC1 %.2f dB, BC3 %.2f dB, BC4 %.2f dB, BC5 %.2f dB\n", bc1,
+         bc3, bc4, bc5);
+
+  CHECK(bc1 >= MIN_PSNR_BC1);
+  CHECK(bc3 >= MIN_PSNR_BC3);
+  CHECK(bc4 >= MIN_PSNR_BC4);
+  CHECK(bc5 >= MIN_PSNR_BC5);
+
+  // A block of one color is stored exactly when the color is a 5:6:5 color
+  // expanded to 8 bits
+  vector<unsigned char> flat(16 * 4);
+  for (int i = 0; i < 16; i++) {
+    flat[i * 4 + 0] = 0x84;
+    flat[i * 4 + 1] = 0x86;
+    flat[i * 4 + 2] = 0x10;
+    flat[i * 4 + 3] = 255;
+  }
+
+  auto flatBlock = compressImage(flat.data(), 4, 4, 4, BlockFormat::BC1);
+  auto flatDecoded =
+      decompressImage(flatBlock.data(), 4, 4, 4, BlockFormat::BC1);
+  CHECK(std::isinf(calculatePSNR(flat.data(), flatDecoded.data(), flat.size())));
+
+  // BC4 stores the lowest and highest values of a block exactly
+  unsigned char values[16];
+  for (int i = 0; i < 16; i++) {
+    values[i] = (unsigned char)(i * 17);
+  }
+
+  auto valueBlock = compressImage(values, 4, 4, 1, BlockFormat::BC4);
+  auto valueDecoded =
+      decompressImage(valueBlock.data(), 4, 4, 1, BlockFormat::BC4);
+  CHECK(valueDecoded[0] == 0);
+  CHECK(valueDecoded[15] == 255);
+
+  return finish();
+}
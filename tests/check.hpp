@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+
+// Shared by the programs in tests/. Each program runs its checks in main
+// and returns finish(), which is non-zero if any check failed
+
+// Returns the number of failed checks
+// @returns The number of failed checks
+inline int &getFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+// Prints the check and where it is if it is false
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+      getFailures()++;                                                         \
+    }                                                                          \
+  } while (false)
+
+// Prints the result of the program
+// @returns The exit code of the program
+inline int finish() {
+  if (getFailures() > 0) {
+    printf("%d checks failed\n", getFailures());
+    return 1;
+  }
+
+  printf("All checks passed\n");
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include "helper/governor.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "check.hpp"
+
+using namespace std;
+
+// The GPU time of a frame at full resolution when the scene is heavy and
+// when it is light, in seconds
+#define HEAVY_TIME 0.016
+#define LIGHT_TIME 0.006
+
+// The budget the governor holds, in seconds
+#define BUDGET 0.010
+
+/* Runs frames whose GPU time goes with the number of pixels
+ * @param governor The governor
+ * @param fullTime The GPU time at full resolution
+ * @param frames The number of frames
+ * @returns The scale after the frames
+ */
+static float run(ResolutionGovernor &governor, double fullTime, int frames) {
+  float scale = governor.getScale();
+
+  for (int i = 0; i < frames; i++) {
+    scale = governor.update(fullTime * scale * scale);
+  }
+
+  return scale;
+}
+
+// A heavy scene shrinks the scale until it fits the budget, and a light
+// one grows it back
+static void testBudget() {
+  auto governor = ResolutionGovernor::create(BUDGET, 0.5f, 1.0f);
+
+  // Times that aren't known yet leave the scale alone
+  CHECK(governor->update(0.0) == 1.0f);
+
+  float heavy = run(*governor, HEAVY_TIME, 500);
+  CHECK(heavy < 1.0f);
+  CHECK(HEAVY_TIME * heavy * heavy <= BUDGET);
+
+  // The scale settles instead of bouncing
+  size_t changes = governor->getChangeCount();
+  CHECK(run(*governor, HEAVY_TIME, 500) == heavy);
+  CHECK(governor->getChangeCount() == changes);
+
+  CHECK(run(*governor, LIGHT_TIME, 500) == 1.0f);
+
+  // The scale never goes below the smallest
+  CHECK(run(*governor, 1.0, 500) == 0.5f);
+}
+
+// Every change is in the history, up to GOVERNOR_HISTORY of them
+static void testHistory() {
+  auto governor = ResolutionGovernor::create(BUDGET, 0.5f, 1.0f);
+
+  run(*governor, HEAVY_TIME, 500);
+
+  auto &history = governor->getHistory();
+  CHECK(history.size() == governor->getChangeCount());
+  CHECK(!history.empty());
+
+  float scale = 1.0f;
+  size_t frame = 0;
+
+  for (auto &change : history) {
+    CHECK(change.from == scale);
+    CHECK(change.frame > frame);
+
+    // Shrinking is only for times over the budget
+    CHECK((change.to < change.from) == (change.time > BUDGET));
+
+    scale = change.to;
+    frame = change.frame;
+  }
+
+  CHECK(scale == governor->getScale());
+
+  // Going back and forth makes more changes than are kept
+  for (int i = 0; i < GOVERNOR_HISTORY; i++) {
+    run(*governor, LIGHT_TIME, 100);
+    run(*governor, HEAVY_TIME, 100);
+  }
+
+  CHECK(governor->getChangeCount() > GOVERNOR_HISTORY);
+  CHECK(history.size() == GOVERNOR_HISTORY);
+  CHECK(history.back().to == governor->getScale());
+
+  // One line per change after the header
+  string path = "governor-test.csv";
+  CHECK(governor->saveHistory(path));
+
+  ifstream file(path);
+  string line;
+  size_t lines = 0;
+
+  getline(file, line);
+  CHECK(line == "frame,from,to,gpu_ms,budget_ms");
+
+  while (getline(file, line)) {
+    lines++;
+  }
+
+  CHECK(lines == GOVERNOR_HISTORY);
+
+  file.close();
+  remove(path.c_str());
+}
+
+int main() {
+  testBudget();
+  testHistory();
+
+  return finish();
+}
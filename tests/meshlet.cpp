@@ -0,0 +1,210 @@
+#include "rendering/meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "check.hpp"
+
+using namespace std;
+using namespace glm;
+
+// The rings and segments of the test mesh
+#define MESH_RINGS 96
+#define MESH_SEGMENTS 192
+
+// The quads on each side of the patches the triangles are ordered in
+#define PATCH_SIZE 5
+
+// A triangle mesh
+struct Mesh {
+  vector<float> positions;
+  vector<uint32_t> indices;
+};
+
+/* Makes a bumpy sphere with its triangles facing out. The triangles are
+ * ordered in small patches, so triangles next to each other are close
+ * like they are after sorting them with a BVH
+ * @returns The mesh
+ */
+static Mesh makeMesh() {
+  Mesh mesh;
+
+  for (int r = 0; r <= MESH_RINGS; r++) {
+    float theta = pi<float>() * r / MESH_RINGS;
+
+    for (int s = 0; s <= MESH_SEGMENTS; s++) {
+      float phi = 2.0f * pi<float>() * s / MESH_SEGMENTS;
+      float radius = 1.0f + 0.02f * sinf(theta * 13.0f) * cosf(phi * 11.0f);
+
+      mesh.positions.insert(mesh.positions.end(),
+                            {radius * sinf(theta) * cosf(phi),
+                             radius * cosf(theta),
+                             radius * sinf(theta) * sinf(phi)});
+    }
+  }
+
+  for (int pr = 0; pr < MESH_RINGS; pr += PATCH_SIZE) {
+    for (int ps = 0; ps < MESH_SEGMENTS; ps += PATCH_SIZE) {
+      for (int r = pr; r < std::min(pr + PATCH_SIZE, MESH_RINGS); r++) {
+        for (int s = ps; s < std::min(ps + PATCH_SIZE, MESH_SEGMENTS); s++) {
+          uint32_t a = r * (MESH_SEGMENTS + 1) + s;
+          uint32_t b = a + MESH_SEGMENTS + 1;
+
+          mesh.indices.insert(mesh.indices.end(),
+                              {a, a + 1, b, a + 1, b + 1, b});
+        }
+      }
+    }
+  }
+
+  return mesh;
+}
+
+/* Returns a corner of a triangle
+ * @param mesh The mesh
+ * @param index The index of the corner
+ * @returns The position of the corner
+ */
+static vec3 getCorner(const Mesh &mesh, size_t index) {
+  const float *p = &mesh.positions[mesh.indices[index] * 3];
+  return vec3(p[0], p[1], p[2]);
+}
+
+// Meshlets cover every triangle in order, stay in the limits, and their
+// spheres hold their triangles
+static void testBuild(const Mesh &mesh, const vector<Meshlet> &meshlets) {
+  uint32_t next = 0;
+
+  for (auto &meshlet : meshlets) {
+    CHECK(meshlet.firstIndex == next);
+    CHECK(meshlet.indexCount > 0);
+    CHECK(meshlet.indexCount / 3 <= MESHLET_MAX_TRIANGLES);
+
+    vector<uint32_t> vertices(mesh.indices.begin() + meshlet.firstIndex,
+                              mesh.indices.begin() + meshlet.firstIndex +
+                                  meshlet.indexCount);
+    sort(vertices.begin(), vertices.end());
+    vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+    CHECK(vertices.size() <= MESHLET_MAX_VERTICES);
+
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+      vec3 corner = getCorner(mesh, meshlet.firstIndex + i);
+      CHECK(length(corner - meshlet.center) <= meshlet.radius * 1.0001f);
+    }
+
+    next += meshlet.indexCount;
+  }
+
+  CHECK(next == mesh.indices.size());
+}
+
+/* Culls the meshlets from a camera and checks that no culled meshlet has a
+ * triangle facing the camera inside the frustum
+ * @param mesh The mesh
+ * @param meshlets The meshlets
+ * @param list The meshlets as a list
+ * @param camera The camera position
+ * @param target The point the camera looks at
+ * @returns The fraction of meshlets culled by their cones
+ */
+static float testCull(const Mesh &mesh, const vector<Meshlet> &meshlets,
+                      const MeshletList &list, const vec3 &camera,
+                      const vec3 &target) {
+  mat4 PV = perspective(radians(60.0f), 1.0f, 0.01f, 100.0f) *
+            lookAt(camera, target, vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum(PV);
+
+  vector<uint8_t> visible(list.size());
+  size_t count = list.cull(frustum, camera, visible, 0, list.size());
+
+  // Single meshlets are tested without SIMD, and must agree
+  vector<uint8_t> single(list.size());
+  size_t singleCount = 0;
+  for (size_t i = 0; i < list.size(); i++) {
+    singleCount += list.cull(frustum, camera, single, i, 1);
+  }
+
+  CHECK(count == singleCount);
+  CHECK(visible == single);
+
+  size_t coneCulled = 0;
+
+  for (size_t m = 0; m < meshlets.size(); m++) {
+    if (visible[m]) {
+      continue;
+    }
+
+    auto &meshlet = meshlets[m];
+    bool facing = false;
+    bool inside = false;
+
+    for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+      vec3 a = getCorner(mesh, meshlet.firstIndex + i);
+      vec3 b = getCorner(mesh, meshlet.firstIndex + i + 1);
+      vec3 c = getCorner(mesh, meshlet.firstIndex + i + 2);
+
+      facing = facing || dot(a - camera, cross(b - a, c - a)) < 0.0f;
+
+      for (vec3 corner : {a, b, c}) {
+        vec4 clip = PV * vec4(corner, 1.0f);
+        inside = inside || (fabsf(clip.x) <= clip.w &&
+                            fabsf(clip.y) <= clip.w &&
+                            fabsf(clip.z) <= clip.w);
+      }
+    }
+
+    // A meshlet in the frustum may only be culled if it faces away
+    CHECK(!(facing && inside));
+
+    coneCulled += inside;
+  }
+
+  return (float)coneCulled / meshlets.size();
+}
+
+int main() {
+  Mesh mesh = makeMesh();
+  vector<Meshlet> meshlets = buildMeshlets(mesh.positions, mesh.indices);
+
+  testBuild(mesh, meshlets);
+
+  MeshletList list;
+  for (auto &meshlet : meshlets) {
+    list.add(meshlet);
+  }
+
+  CHECK(list.size() == meshlets.size());
+
+  // From outside, about half of the sphere faces away. The cones of the
+  // meshlets near the outline are too wide to cull
+  float outside =
+      testCull(mesh, meshlets, list, vec3(0.0f, 0.5f, 4.0f), vec3(0.0f));
+  printf("%zu meshlets, %.1f%% culled by their cones from outside\n",
+         meshlets.size(), outside * 100.0f);
+  CHECK(outside > 0.25f);
+
+  // From inside, every triangle faces away
+  float inside = testCull(mesh, meshlets, list, vec3(0.1f, 0.0f, 0.0f),
+                          vec3(0.0f, 0.0f, -1.0f));
+  printf("%.1f%% culled by their cones from inside\n", inside * 100.0f);
+  CHECK(inside > 0.0f);
+
+  // Cameras all around the sphere
+  mt19937 random(5);
+  uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  for (int i = 0; i < 50; i++) {
+    vec3 camera = normalize(vec3(unit(random), unit(random), unit(random))) *
+                  (1.1f + (unit(random) + 1.0f) * 2.0f);
+    vec3 target = vec3(unit(random), unit(random), 0.0f) * 0.5f;
+
+    testCull(mesh, meshlets, list, camera, target);
+  }
+
+  return finish();
+}
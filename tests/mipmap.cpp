@@ -0,0 +1,224 @@
+#include "helper/mipmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace std;
+
+// This file is built once for each instruction set, like the mipmap
+// benchmark. Each build also links the scalar kernels under this name, so
+// the SIMD kernels can be compared with them
+std::vector<MipLevel> generateScalarMipChain(const unsigned char *pixels,
+                                             int width, int height,
+                                             int channels,
+                                             const MipSettings &settings);
+
+// How far the SIMD kernels can be from the scalar ones, in 8 bit steps.
+// FMA rounds differently, which can flip a value that is close to .5
+#define KERNEL_TOLERANCE 1
+
+/* Makes an image of smooth gradients with some noise
+ * @param width The image width
+ * @param height The image height
+ * @param channels The number of channels
+ * @returns Tightly packed pixels
+ */
+static vector<unsigned char> makeImage(int width, int height, int channels) {
+  mt19937 random(7);
+  vector<unsigned char> pixels((size_t)width * height * channels);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < channels; c++) {
+        float value = 0.5f + 0.2f * sinf(x * 0.07f * (c + 1)) +
+                      0.2f * cosf(y * 0.05f + c) +
+                      0.1f * ((random() % 256) / 255.0f - 0.5f);
+
+        pixels[((size_t)y * width + x) * channels + c] =
+            (unsigned char)(value * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  return pixels;
+}
+
+/* Returns the fraction of pixels whose channel passes the alpha test
+ * @param pixels Tightly packed pixels
+ * @param count The number of pixels
+ * @param channels The number of channels
+ * @param channel The alpha tested channel
+ * @param cutoff The alpha test reference value
+ * @returns The fraction
+ */
+static float getCoverage(const unsigned char *pixels, size_t count,
+                         int channels, int channel, float cutoff) {
+  size_t passed = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    passed += pixels[i * channels + channel] / 255.0f >= cutoff;
+  }
+
+  return (float)passed / count;
+}
+
+// The kernels this file was built with give the same levels as the
+// scalar ones
+static void testKernels() {
+  for (int channels = 1; channels <= 4; channels++) {
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+      vector<unsigned char> pixels = makeImage(131, 77, channels);
+
+      MipSettings settings;
+      settings.filter = filter;
+      settings.coverageChannel = channels == 4 ? 3 : -1;
+
+      auto levels = generateMipChain(pixels.data(), 131, 77, channels,
+                                     settings);
+      auto reference = generateScalarMipChain(pixels.data(), 131, 77,
+                                              channels, settings);
+
+      CHECK(levels.size() == reference.size());
+
+      for (size_t l = 0; l < min(levels.size(), reference.size()); l++) {
+        CHECK(levels[l].width == reference[l].width);
+        CHECK(levels[l].height == reference[l].height);
+        CHECK(levels[l].pixels.size() == reference[l].pixels.size());
+
+        int difference = 0;
+        for (size_t i = 0; i < min(levels[l].pixels.size(),
+                                   reference[l].pixels.size());
+             i++) {
+          difference = max(difference, abs(levels[l].pixels[i] -
+                                           reference[l].pixels[i]));
+        }
+
+        CHECK(difference <= KERNEL_TOLERANCE);
+      }
+    }
+  }
+}
+
+// A black and white checker averages to half the light, which is 188 in
+// sRGB. Averaging the sRGB values would give 128
+static void testSRGB() {
+  vector<unsigned char> pixels(8 * 8 * 3);
+
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) {
+      for (int c = 0; c < 3; c++) {
+        pixels[(y * 8 + x) * 3 + c] = (x + y) % 2 ? 255 : 0;
+      }
+    }
+  }
+
+  MipSettings settings;
+  settings.filter = MipFilter::Box;
+
+  auto levels = generateMipChain(pixels.data(), 8, 8, 3, settings);
+
+  for (auto &level : levels) {
+    for (unsigned char value : level.pixels) {
+      CHECK(abs(value - 188) <= 1);
+    }
+  }
+
+  settings.srgb = false;
+  levels = generateMipChain(pixels.data(), 8, 8, 3, settings);
+
+  for (unsigned char value : levels[0].pixels) {
+    CHECK(abs(value - 128) <= 1);
+  }
+}
+
+// Alpha masks keep the fraction of pixels that pass the opaque pass's
+// alpha test, where plain filtering thins them out
+static void testCoverage() {
+  // TEXTURE_ALPHA_CUTOFF. platform/texture.hpp uses OpenGL, so it isn't
+  // included here
+  const float cutoff = 0.9f;
+
+  // Thin opaque lines on a clear background, like leaves
+  int size = 256;
+  vector<unsigned char> pixels((size_t)size * size * 4, 0);
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      unsigned char *pixel = &pixels[((size_t)y * size + x) * 4];
+      pixel[0] = pixel[1] = pixel[2] = 200;
+      pixel[3] = (x + y / 3) % 7 == 0 || (x * 3 + y) % 11 == 0 ? 255 : 0;
+    }
+  }
+
+  float base = getCoverage(pixels.data(), (size_t)size * size, 4, 3, cutoff);
+
+  MipSettings settings;
+  settings.coverageChannel = 3;
+  settings.coverageCutoff = cutoff;
+
+  auto levels = generateMipChain(pixels.data(), size, size, 4, settings);
+
+  settings.coverageChannel = -1;
+  auto plain = generateMipChain(pixels.data(), size, size, 4, settings);
+
+  // Small levels can't hit the fraction with so few pixels
+  for (size_t l = 0; l < levels.size() && levels[l].width >= 16; l++) {
+    size_t count = (size_t)levels[l].width * levels[l].height;
+
+    CHECK(fabsf(getCoverage(levels[l].pixels.data(), count, 4, 3, cutoff) -
+                base) < 0.02f);
+    CHECK(getCoverage(plain[l].pixels.data(), count, 4, 3, cutoff) <
+          base * 0.5f);
+  }
+}
+
+// Odd and non-square sizes halve down to 1x1, rounding down, and a flat
+// image stays flat
+static void testSizes() {
+  int sizes[][2] = {{1, 1}, {2, 1}, {1, 9}, {37, 5}, {5, 37}, {255, 3},
+                    {64, 64}, {99, 100}};
+
+  for (auto &size : sizes) {
+    for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+      vector<unsigned char> pixels((size_t)size[0] * size[1] * 4, 90);
+
+      MipSettings settings;
+      settings.filter = filter;
+
+      auto levels = generateMipChain(pixels.data(), size[0], size[1], 4,
+                                     settings);
+
+      int width = size[0];
+      int height = size[1];
+
+      for (auto &level : levels) {
+        width = max(width / 2, 1);
+        height = max(height / 2, 1);
+
+        CHECK(level.width == width);
+        CHECK(level.height == height);
+        CHECK(level.pixels.size() == (size_t)width * height * 4);
+
+        for (unsigned char value : level.pixels) {
+          CHECK(abs(value - 90) <= 1);
+        }
+      }
+
+      CHECK(width == 1 && height == 1);
+    }
+  }
+}
+
+int main() {
+  testKernels();
+  testSRGB();
+  testCoverage();
+  testSizes();
+
+  return finish();
+}
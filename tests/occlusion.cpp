@@ -0,0 +1,206 @@
+#include "rendering/occlusion.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "check.hpp"
+
+using namespace std;
+using namespace glm;
+
+// The size of the buffers
+#define WIDTH 128
+#define HEIGHT 96
+
+// A camera at the origin looking down -z
+static mat4 getPVM() {
+  return perspective(radians(60.0f), (float)WIDTH / HEIGHT, 0.1f, 100.0f);
+}
+
+/* Adds a square facing the camera as two triangles
+ * @param buffer The buffer
+ * @param size Half the width of the square
+ * @param z The distance of the square, as a negative z
+ * @param flip Winds the triangles the other way
+ */
+static void addSquare(OcclusionBuffer &buffer, float size, float z,
+                      bool flip = false) {
+  vector<float> positions = {-size, -size, z, size, -size, z,
+                             size,  size,  z, -size, size, z};
+
+  vector<uint32_t> indices = {0, 1, 2, 0, 2, 3};
+  if (flip) {
+    indices = {0, 2, 1, 0, 3, 2};
+  }
+
+  buffer.addOccluders(positions, indices, 0, indices.size(), getPVM());
+}
+
+/* Returns a box
+ * @param center The center of the box
+ * @param size Half the size of the box
+ * @returns The box
+ */
+static BoundingBox makeBox(const vec3 &center, float size) {
+  BoundingBox box;
+  box.add(center - vec3(size));
+  box.add(center + vec3(size));
+  return box;
+}
+
+// An empty buffer hides nothing on screen, and everything to the side of it
+static void testEmpty() {
+  auto buffer = OcclusionBuffer::create(WIDTH, HEIGHT);
+  buffer->render();
+
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -10.0f), 0.5f), getPVM()));
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -99.0f), 0.5f), getPVM()));
+  CHECK(!buffer->isVisible(makeBox(vec3(100.0f, 0.0f, -10.0f), 0.5f),
+                           getPVM()));
+
+  // A box around the camera can't be projected, so it is kept
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f), 1.0f), getPVM()));
+}
+
+// Occluders write their depth to the pixels they cover and nowhere else
+static void testRaster() {
+  for (bool flip : {false, true}) {
+    auto buffer = OcclusionBuffer::create(WIDTH, HEIGHT);
+    addSquare(*buffer, 1.0f, -5.0f, flip);
+    buffer->render();
+
+    CHECK(buffer->getTriangleCount() == 2);
+
+    vec4 clip = getPVM() * vec4(0.0f, 0.0f, -5.0f, 1.0f);
+    float expected = clip.z / clip.w;
+
+    // The square covers the middle of the screen
+    auto &depth = buffer->getDepth();
+    float middle = depth[(HEIGHT / 2) * WIDTH + WIDTH / 2];
+    CHECK(fabsf(middle - expected) < 1e-4f);
+
+    // The corners are left at the far plane
+    CHECK(depth[0] == 1.0f);
+    CHECK(depth[(HEIGHT - 1) * WIDTH + WIDTH - 1] == 1.0f);
+
+    // Every pixel is the square's depth or the far plane
+    size_t covered = 0;
+    for (float d : depth) {
+      CHECK(d == 1.0f || fabsf(d - expected) < 1e-4f);
+      covered += d < 1.0f;
+    }
+
+    // The square is 2 / (2 * 5 * tan(30)) of the height on each side
+    float side = HEIGHT / (5.0f * tanf(radians(30.0f)));
+    CHECK(fabsf((float)covered - side * side) < 4.0f * side);
+  }
+}
+
+// Boxes are hidden only if they are behind the occluders everywhere
+static void testBoxes() {
+  auto buffer = OcclusionBuffer::create(WIDTH, HEIGHT);
+  addSquare(*buffer, 1.0f, -5.0f);
+  buffer->render();
+
+  mat4 PVM = getPVM();
+
+  // Behind the middle of the square
+  CHECK(!buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -10.0f), 0.5f), PVM));
+
+  // In front of the square
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -3.0f), 0.2f), PVM));
+
+  // Crossing the square
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -5.0f), 0.5f), PVM));
+
+  // Behind the square, but reaching past its edge
+  CHECK(buffer->isVisible(makeBox(vec3(1.8f, 0.0f, -10.0f), 0.5f), PVM));
+}
+
+// Occluders that reach in front of the near plane are left out
+static void testNearPlane() {
+  auto buffer = OcclusionBuffer::create(WIDTH, HEIGHT);
+
+  vector<float> positions = {-1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -5.0f,
+                             0.0f,  1.0f,  -5.0f};
+  vector<uint32_t> indices = {0, 1, 2};
+  buffer->addOccluders(positions, indices, 0, 3, getPVM());
+  buffer->render();
+
+  CHECK(buffer->getTriangleCount() == 0);
+  CHECK(buffer->isVisible(makeBox(vec3(0.0f, 0.0f, -10.0f), 0.5f), getPVM()));
+}
+
+// Rasterizing in bands on a pool gives the same depths as one thread, and
+// hidden boxes are always behind every pixel of their rectangle
+static void testRandom() {
+  auto pool = ThreadPool::create(4);
+  auto serial = OcclusionBuffer::create(WIDTH, HEIGHT);
+  auto parallel = OcclusionBuffer::create(WIDTH, HEIGHT, pool);
+
+  mt19937 random(3);
+  uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  vector<float> positions;
+  vector<uint32_t> indices;
+
+  for (uint32_t t = 0; t < 200; t++) {
+    vec3 center(unit(random) * 6.0f, unit(random) * 4.0f,
+                -12.0f + unit(random) * 6.0f);
+
+    for (uint32_t v = 0; v < 3; v++) {
+      vec3 p = center + vec3(unit(random), unit(random), unit(random) * 0.2f);
+      positions.insert(positions.end(), {p.x, p.y, p.z});
+      indices.push_back(t * 3 + v);
+    }
+  }
+
+  serial->addOccluders(positions, indices, 0, indices.size(), getPVM());
+  parallel->addOccluders(positions, indices, 0, indices.size(), getPVM());
+  serial->render();
+  parallel->render();
+
+  CHECK(serial->getDepth() == parallel->getDepth());
+
+  auto &depth = serial->getDepth();
+  size_t hidden = 0;
+
+  for (int i = 0; i < 2000; i++) {
+    vec3 center(unit(random) * 8.0f, unit(random) * 6.0f,
+                -14.0f + unit(random) * 8.0f);
+    BoundingBox box = makeBox(center, 0.05f + (unit(random) + 1.0f) * 0.3f);
+
+    OcclusionRect rect;
+    if (serial->isVisible(box, getPVM()) ||
+        !serial->projectBox(box, getPVM(), rect)) {
+      continue;
+    }
+
+    hidden++;
+
+    bool behind = true;
+    for (int y = rect.minY; y <= rect.maxY; y++) {
+      for (int x = rect.minX; x <= rect.maxX; x++) {
+        behind = behind && depth[(size_t)y * WIDTH + x] < rect.depth;
+      }
+    }
+
+    CHECK(behind);
+  }
+
+  // Some boxes have to be hidden for this to check anything
+  CHECK(hidden > 0);
+}
+
+int main() {
+  testEmpty();
+  testRaster();
+  testBoxes();
+  testNearPlane();
+  testRandom();
+
+  return finish();
+}
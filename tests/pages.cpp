@@ -0,0 +1,201 @@
+#include "rendering/pages.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace std;
+
+// The tiles of the test frame
+#define TILES 400
+
+// The threads that allocate at once
+#define THREADS 8
+
+// Marks a node no fragment has
+#define NO_TILE UINT32_MAX
+
+// The fragments of a frame, in the order they are drawn
+struct Frame {
+  vector<uint32_t> tiles;
+  size_t pages = 0;
+};
+
+/* Makes a frame where a third of the tiles are empty and the rest have up
+ * to 200 fragments
+ * @returns The frame
+ */
+static Frame makeFrame() {
+  mt19937 random(3);
+  Frame frame;
+
+  for (uint32_t tile = 0; tile < TILES; tile++) {
+    uint32_t count = random() % 3 == 0 ? 0 : random() % 200;
+
+    frame.tiles.insert(frame.tiles.end(), count, tile);
+    frame.pages += (count + FRAGMENT_PAGE_SIZE - 1) / FRAGMENT_PAGE_SIZE;
+  }
+
+  shuffle(frame.tiles.begin(), frame.tiles.end(), random);
+  return frame;
+}
+
+/* Checks that the nodes are past page zero, below the capacity, used once,
+ * and that no page has fragments of two tiles
+ * @param tiles The tile of each fragment
+ * @param nodes The node of each fragment. Zero if it was dropped
+ * @param capacity The nodes the list holds
+ */
+static void checkNodes(const vector<uint32_t> &tiles,
+                       const vector<uint32_t> &nodes, size_t capacity) {
+  vector<uint32_t> owners(capacity, NO_TILE);
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i] == 0) {
+      continue;
+    }
+
+    CHECK(nodes[i] >= FRAGMENT_PAGE_SIZE);
+    CHECK(nodes[i] < capacity);
+
+    if (nodes[i] < capacity) {
+      CHECK(owners[nodes[i]] == NO_TILE);
+      owners[nodes[i]] = tiles[i];
+    }
+  }
+
+  for (size_t page = 0; page < capacity; page += FRAGMENT_PAGE_SIZE) {
+    uint32_t owner = NO_TILE;
+
+    for (size_t i = page; i < std::min(page + FRAGMENT_PAGE_SIZE, capacity);
+         i++) {
+      if (owner == NO_TILE) {
+        owner = owners[i];
+      }
+
+      CHECK(owners[i] == NO_TILE || owners[i] == owner);
+    }
+  }
+}
+
+// With the bound as the capacity, every fragment gets a node
+static void testBound(const Frame &frame) {
+  size_t capacity = PageAllocator::getNodeBound(frame.tiles.size(), TILES);
+  auto allocator = PageAllocator::create(TILES);
+  allocator->reset(capacity);
+
+  vector<uint32_t> nodes;
+  for (uint32_t tile : frame.tiles) {
+    nodes.push_back(allocator->allocate(tile));
+  }
+
+  checkNodes(frame.tiles, nodes, capacity);
+  CHECK(count(nodes.begin(), nodes.end(), 0u) == 0);
+  CHECK(allocator->getPageCount() == frame.pages);
+  CHECK(allocator->getFallbacks() == 0);
+  CHECK(allocator->getDropped() == 0);
+}
+
+// Many threads at once still hand out every node once
+static void testThreads(const Frame &frame) {
+  size_t capacity = PageAllocator::getNodeBound(frame.tiles.size(), TILES);
+  auto allocator = PageAllocator::create(TILES);
+
+  for (int run = 0; run < 20; run++) {
+    allocator->reset(capacity);
+
+    vector<uint32_t> nodes(frame.tiles.size());
+    vector<thread> threads;
+
+    for (size_t t = 0; t < THREADS; t++) {
+      threads.emplace_back([&, t]() {
+        for (size_t i = t; i < frame.tiles.size(); i += THREADS) {
+          nodes[i] = allocator->allocate(frame.tiles[i]);
+        }
+      });
+    }
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    checkNodes(frame.tiles, nodes, capacity);
+
+    // Only the extra pages of fallbacks can push pages past the bound
+    size_t dropped = count(nodes.begin(), nodes.end(), 0u);
+    CHECK(dropped == allocator->getDropped());
+    CHECK(dropped <= allocator->getFallbacks() * FRAGMENT_PAGE_SIZE);
+    CHECK(allocator->getPageCount() ==
+          frame.pages + allocator->getFallbacks());
+  }
+}
+
+// Fragments whose page was pushed out of the ring take pages of their own
+static void testRingWrap() {
+  auto allocator = PageAllocator::create(1);
+
+  // One page more than the ring holds, so the last page takes the first
+  // page's entry before the first page's fragments look for it
+  size_t fragments = (FRAGMENT_PAGE_RING + 1) * FRAGMENT_PAGE_SIZE;
+  size_t capacity = PageAllocator::getNodeBound(fragments, 1,
+                                                FRAGMENT_PAGE_SIZE);
+  allocator->reset(capacity);
+
+  vector<uint32_t> slots;
+  for (size_t i = 0; i < fragments; i++) {
+    slots.push_back(allocator->claim(0));
+  }
+
+  vector<uint32_t> nodes;
+  for (uint32_t slot : slots) {
+    nodes.push_back(allocator->find(0, slot));
+  }
+
+  checkNodes(vector<uint32_t>(fragments, 0), nodes, capacity);
+  CHECK(count(nodes.begin(), nodes.end(), 0u) == 0);
+  CHECK(allocator->getFallbacks() == FRAGMENT_PAGE_SIZE);
+  CHECK(allocator->getDropped() == 0);
+
+  // The fallbacks start their pages
+  for (size_t i = 0; i < FRAGMENT_PAGE_SIZE; i++) {
+    CHECK(nodes[i] % FRAGMENT_PAGE_SIZE == 0);
+  }
+}
+
+// Without enough room, the fragments that don't fit are counted
+static void testOverflow(const Frame &frame) {
+  size_t capacity = frame.tiles.size() / 2;
+  auto allocator = PageAllocator::create(TILES);
+  allocator->reset(capacity);
+
+  vector<uint32_t> nodes;
+  for (uint32_t tile : frame.tiles) {
+    nodes.push_back(allocator->allocate(tile));
+  }
+
+  checkNodes(frame.tiles, nodes, capacity);
+
+  size_t dropped = count(nodes.begin(), nodes.end(), 0u);
+  CHECK(dropped > 0);
+  CHECK(dropped == allocator->getDropped());
+  CHECK(allocator->getFallbacks() == 0);
+
+  // Room for nothing drops everything
+  allocator->reset(FRAGMENT_PAGE_SIZE);
+  CHECK(allocator->allocate(0) == 0);
+  CHECK(allocator->getDropped() == 1);
+}
+
+int main() {
+  Frame frame = makeFrame();
+
+  testBound(frame);
+  testThreads(frame);
+  testRingWrap();
+  testOverflow(frame);
+
+  return finish();
+}
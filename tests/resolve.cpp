@@ -0,0 +1,121 @@
+#include "rendering/resolve.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace std;
+using namespace glm;
+
+// How close two colors have to be to count as the same
+#define TOLERANCE 1e-5f
+
+/* Returns if two colors are within a distance in every channel
+ * @param a The first color
+ * @param b The second color
+ * @param distance The largest difference allowed
+ * @returns If the colors are close
+ */
+static bool isClose(const vec3 &a, const vec3 &b, float distance) {
+  vec3 difference = abs(a - b);
+  return difference.x <= distance && difference.y <= distance &&
+         difference.z <= distance;
+}
+
+/* Returns the final color of a pixel
+ * @param result The composited fragments
+ * @param opaque The opaque color behind them
+ * @returns The color
+ */
+static vec3 getFinal(const ResolveResult &result, const vec3 &opaque) {
+  return result.color + result.transmittance * opaque;
+}
+
+// Lists worked out by hand
+static void testFixed() {
+  // Nothing lets everything through
+  auto empty = resolveBackToFront({});
+  CHECK(empty.color == vec3(0.0f));
+  CHECK(empty.transmittance == 1.0f);
+
+  // An opaque fragment hides what is behind
+  auto opaque = resolveBackToFront({{vec4(0.2f, 0.4f, 0.6f, 1.0f), 0.5f}});
+  CHECK(isClose(opaque.color, vec3(0.2f, 0.4f, 0.6f), TOLERANCE));
+  CHECK(opaque.transmittance == 0.0f);
+
+  // Red at half opacity in front of blue at half opacity. The list is out
+  // of order, which the resolve has to sort
+  vector<ResolveFragment> pair = {{vec4(0.0f, 0.0f, 1.0f, 0.5f), 0.8f},
+                                  {vec4(1.0f, 0.0f, 0.0f, 0.5f), 0.2f}};
+
+  auto back = resolveBackToFront(pair);
+  CHECK(isClose(back.color, vec3(0.5f, 0.0f, 0.25f), TOLERANCE));
+  CHECK(fabsf(back.transmittance - 0.25f) < TOLERANCE);
+
+  auto front = resolveFrontToBack(pair, 0.0f);
+  CHECK(isClose(front.color, back.color, TOLERANCE));
+  CHECK(fabsf(front.transmittance - back.transmittance) < TOLERANCE);
+  CHECK(front.skipped == 0);
+
+  // Fragments at the same depth keep their list order, so the first one
+  // is in front
+  vector<ResolveFragment> tied = {{vec4(1.0f, 0.0f, 0.0f, 0.5f), 0.5f},
+                                  {vec4(0.0f, 1.0f, 0.0f, 0.5f), 0.5f}};
+
+  CHECK(isClose(resolveBackToFront(tied).color, vec3(0.5f, 0.25f, 0.0f),
+                TOLERANCE));
+  CHECK(isClose(resolveFrontToBack(tied, 0.0f).color, vec3(0.5f, 0.25f, 0.0f),
+                TOLERANCE));
+
+  // Front to back stops at the first opaque fragment
+  vector<ResolveFragment> covered = {{vec4(1.0f, 1.0f, 1.0f, 1.0f), 0.1f},
+                                     {vec4(1.0f, 0.0f, 0.0f, 0.5f), 0.3f},
+                                     {vec4(0.0f, 1.0f, 0.0f, 0.5f), 0.6f}};
+
+  auto stopped = resolveFrontToBack(covered, 1.0f / 255.0f);
+  CHECK(stopped.skipped == 2);
+  CHECK(isClose(stopped.color, vec3(1.0f), TOLERANCE));
+}
+
+// Front to back is within epsilon of back to front in every channel,
+// whatever the opaque color is
+static void testRandom() {
+  mt19937 random(9);
+  uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  size_t skipped = 0;
+
+  for (int list = 0; list < 2000; list++) {
+    vector<ResolveFragment> fragments(1 + random() % 48);
+
+    for (auto &fragment : fragments) {
+      fragment.color = vec4(unit(random), unit(random), unit(random),
+                            0.05f + 0.9f * unit(random));
+      fragment.depth = unit(random);
+    }
+
+    auto reference = resolveBackToFront(fragments);
+
+    for (float epsilon : {0.0f, 1.0f / 255.0f, 0.01f, 0.05f}) {
+      auto result = resolveFrontToBack(fragments, epsilon);
+      skipped += result.skipped;
+
+      for (vec3 opaque : {vec3(0.0f), vec3(1.0f), vec3(0.0f, 1.0f, 0.5f)}) {
+        CHECK(isClose(getFinal(result, opaque), getFinal(reference, opaque),
+                      epsilon + TOLERANCE));
+      }
+    }
+  }
+
+  // Long lists are dense enough to stop early
+  CHECK(skipped > 0);
+}
+
+int main() {
+  testFixed();
+  testRandom();
+
+  return finish();
+}